@@ -0,0 +1,46 @@
+#include "AllocCounter.h"
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+
+static std::atomic<long long> allocationCount(0);
+static std::atomic<long long> allocatedBytes(0);
+static thread_local long long threadAllocationCount = 0;
+
+long long getAllocationCount() { return allocationCount.load(std::memory_order_relaxed); }
+long long getAllocatedBytes() { return allocatedBytes.load(std::memory_order_relaxed); }
+long long getThreadAllocationCount() { return threadAllocationCount; }
+
+static void* countedAlloc(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	allocatedBytes.fetch_add((long long)size, std::memory_order_relaxed);
+	threadAllocationCount++;
+	return malloc(size == 0 ? 1 : size);
+}
+
+// replacements of the global allocation functions, every new and std container goes through these
+
+void* operator new(size_t size)
+{
+	void* p = countedAlloc(size);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size)
+{
+	void* p = countedAlloc(size);
+	if (p == NULL) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return countedAlloc(size); }
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
@@ -0,0 +1,11 @@
+#pragma once
+
+// counts heap allocations made through the global operator new (replaced in AllocCounter.cpp)
+// used to report allocations per frame and to check that the steady state loop doesn't allocate
+
+// allocations of every thread since start
+long long getAllocationCount();
+long long getAllocatedBytes();
+
+// allocations made by the calling thread since it started
+long long getThreadAllocationCount();
@@ -0,0 +1,1584 @@
+#define _USE_MATH_DEFINES
+#include "Benchmark.h"
+#include "AllocCounter.h"
+#include "BodyStore.h"
+#include "FrustumCuller.h"
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include "MinorBodyCatalog.h"
+#include "NBodySystem.h"
+#include "OrbitAnimator.h"
+#include "OrbitSystem.h"
+#include "RandomRange.h"
+#include "RenderQueue.h"
+#include "SceneCompiler.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "SceneGraph.h"
+#include "SceneSetup.h"
+#include "SimdMath.h"
+#include "SpkEphemeris.h"
+#include "SphereBvh.h"
+#include "TransformKernel.h"
+#include "UpdateScheduler.h"
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// seconds since first call
+static double benchmarkTime()
+{
+	static auto start = chrono::steady_clock::now();
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// text scene, a sun with planets and moons listed before their planets (compiler reorders them)
+static void generateSceneText(int bodyCount, ostream& text)
+{
+	int planetCount = bodyCount / 10;
+	text << "mesh sphere sphere.obj\ntexture earth day.jpg clouds.jpg night.jpg\n";
+	text << "constant sun 696340 inf inf 0 0 7.25\nconstant body 6371 365 365 10 5 23\n";
+	text << "body sun - sun sphere earth static light\nbody p0 sun body sphere earth reference\n";
+	for (int i = 1; i < bodyCount - 1; i++)
+	{
+		if (i < planetCount) text << "body p" << i << " sun body sphere earth margin=" << randomRange(1.f, 20.f) << "\n";
+		else text << "body m" << i << " p" << rand() % planetCount << " body sphere earth scale=0.2 margin=1\n";
+	}
+}
+
+bool runBenchmarks()
+{
+	bool passed = true;
+	cout << "Benchmarks (" << SimdMath::getInstructionSet() << ")\n";
+	benchmarkOrbitUpdate(100000);
+	passed &= benchmarkKeplerSolver(1000000);
+	benchmarkTransforms(100000);
+	passed &= benchmarkFrameAllocations(10000, 1000);
+	passed &= benchmarkJobScaling(100000);
+	passed &= benchmarkSceneLoad(1000000);
+	passed &= benchmarkSceneSetup(10000);
+	passed &= benchmarkSceneSetup(100000);
+	passed &= benchmarkSceneSetup(1000000);
+	passed &= benchmarkBodyStore(1000000);
+	passed &= benchmarkBvh(100000);
+	passed &= benchmarkUpdateScheduler(100000, 16384);
+	passed &= benchmarkUpdateScheduler(1000000, 24576);
+	passed &= benchmarkNBody(100000);
+	passed &= benchmarkEphemeris(1000);
+	passed &= benchmarkCatalogImport(1300000);
+	return passed;
+}
+
+void benchmarkOrbitUpdate(int bodyCount)
+{
+	const double minDuration = 1.0;		// seconds per measured variant
+	const double tick = 1.0 / 120.0;
+	srand(1);
+
+	vector<OrbitAnimator> animators;
+	OrbitSystem orbits;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		float delay = randomRange(1.f, 86400.f);
+		float days = randomRange(0.01f, 400.f);
+		float oval = randomRange(1.f, 1.5f);
+		float radius = randomRange(1.f, 1000.f);
+		float tilt = randomRange(0.f, 30.f);
+		float spin = randomRange(0.f, 360.f);
+		float angle = randomRange(0.f, 360.f);
+
+		animators.push_back(OrbitAnimator(delay, days, spin, angle, oval, radius, tilt));
+		int idx = orbits.addBody(delay, days, oval, radius, tilt);
+		orbits.setSpinAngle(idx, spin);
+		orbits.setOrbitAngle(idx, angle);
+	}
+
+	// one OrbitAnimator per body, scalar sin/cos
+	double simulationSeconds = 0.0;
+	double checksum = 0.0;
+	long long updates = 0;
+	double start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		simulationSeconds += tick;
+		for (int i = 0; i < bodyCount; i++)
+		{
+			animators[i].evaluate(simulationSeconds);
+		}
+		checksum += animators[bodyCount - 1].getOrbitPosition()[0];
+		updates += bodyCount;
+	}
+	double scalarRate = updates / (benchmarkTime() - start);
+
+	// structure of arrays, simd sin/cos
+	simulationSeconds = 0.0;
+	updates = 0;
+	start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		simulationSeconds += tick;
+		orbits.evaluate(simulationSeconds);
+		checksum += orbits.getPositions()[bodyCount - 1].x;
+		updates += bodyCount;
+	}
+	double batchRate = updates / (benchmarkTime() - start);
+
+	// both implementations must agree
+	float maxError = 0.f;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		animators[i].evaluate(simulationSeconds);
+		glm::vec3 expected = animators[i].getOrbitPosition();
+		glm::vec3 actual = orbits.getPositions()[i];
+		for (int k = 0; k < 3; k++)
+		{
+			float error = fabsf(expected[k] - actual[k]) / animators[i].getOrbitRadius();
+			if (error > maxError) maxError = error;
+		}
+	}
+
+	cout << "Orbit Update (" << bodyCount << " bodies, single thread)\n";
+	cout << "  OrbitAnimator: " << scalarRate / 1e6 << "M bodies/s\n";
+	cout << "  OrbitSystem:   " << batchRate / 1e6 << "M bodies/s (x" << batchRate / scalarRate << ")\n";
+	cout << "  max relative position difference: " << maxError << " (checksum " << checksum << ")\n";
+}
+
+// eccentric anomaly in double precision, newton steps until they stop changing it
+static double solveKeplerReference(double meanAnomaly, double eccentricity)
+{
+	double e = eccentricity < 0.8 ? meanAnomaly : (meanAnomaly < 0.0 ? -M_PI : M_PI);
+	for (int k = 0; k < 100; k++)
+	{
+		double step = (e - eccentricity * sin(e) - meanAnomaly) / (1.0 - eccentricity * cos(e));
+		e -= step;
+		if (fabs(step) < 1e-15) break;
+	}
+	return e;
+}
+
+bool benchmarkKeplerSolver(int solveCount)
+{
+	const double minDuration = 1.0;
+	const int width = SimdMath::WIDTH;
+	srand(1);
+
+	// mean anomalies in [-pi,pi], a quarter of them close to periapsis where high eccentricities
+	// converge slowest, eccentricities up to 0.99
+	int padded = (solveCount + width - 1) / width * width;
+	vector<float> meanAnomalies(padded), eccentricities(padded), sines(padded), cosines(padded);
+	for (int i = 0; i < padded; i++)
+	{
+		float m = randomRange((float)-M_PI, (float)M_PI);
+		meanAnomalies[i] = i % 4 == 0 ? m * 1e-3f : m;
+		eccentricities[i] = i % 8 == 0 ? 0.99f : randomRange(0.f, 0.99f);
+	}
+
+	// simd solver
+	long long solves = 0;
+	double start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		for (int i = 0; i < padded; i += width)
+		{
+#if defined(SIMD_AVX2)
+			__m256 s, c;
+			SimdMath::kepler8(_mm256_loadu_ps(&meanAnomalies[i]), _mm256_loadu_ps(&eccentricities[i]), s, c);
+			_mm256_storeu_ps(&sines[i], s);
+			_mm256_storeu_ps(&cosines[i], c);
+#else
+			__m128 s, c;
+			SimdMath::kepler4(_mm_loadu_ps(&meanAnomalies[i]), _mm_loadu_ps(&eccentricities[i]), s, c);
+			_mm_storeu_ps(&sines[i], s);
+			_mm_storeu_ps(&cosines[i], c);
+#endif
+		}
+		solves += padded;
+	}
+	double simdRate = solves / (benchmarkTime() - start);
+
+	// scalar reference, then the error of the simd results against it
+	vector<double> anomalies(solveCount);
+	start = benchmarkTime();
+	for (int i = 0; i < solveCount; i++)
+	{
+		anomalies[i] = solveKeplerReference(meanAnomalies[i], eccentricities[i]);
+	}
+	double referenceRate = solveCount / (benchmarkTime() - start);
+
+	double checksum = 0.0;
+	float maxError = 0.f;
+	for (int i = 0; i < solveCount; i++)
+	{
+		float error = (float)max(fabs(sines[i] - sin(anomalies[i])), fabs(cosines[i] - cos(anomalies[i])));
+		if (error > maxError) maxError = error;
+		checksum += anomalies[i];
+	}
+
+	// errors are relative to the semi major axis, 1e-5 is well below a pixel for any orbit on screen
+	bool passed = maxError < 1e-5f;
+	cout << "Kepler Solver (" << solveCount << " orbits, e up to 0.99, single thread)\n";
+	cout << "  double newton: " << referenceRate / 1e6 << "M solves/s (checksum " << checksum << ")\n";
+	cout << "  simd halley:   " << simdRate / 1e6 << "M solves/s, " << SimdMath::KEPLER_ITERATIONS << " steps (x"
+		<< simdRate / referenceRate << ")\n";
+	cout << "  max sin/cos error: " << maxError << (passed ? "\n" : " FAILED\n");
+	return passed;
+}
+
+void benchmarkTransforms(int bodyCount)
+{
+	const double minDuration = 1.0;
+	srand(1);
+
+	vector<float> parentsRotation(bodyCount), ascendingNode(bodyCount), tilt(bodyCount), spin(bodyCount), scale(bodyCount);
+	vector<glm::vec3> parentOffset(bodyCount), position(bodyCount);
+	for (int i = 0; i < bodyCount; i++)
+	{
+		parentsRotation[i] = randomRange(-180.f, 180.f);
+		ascendingNode[i] = randomRange(-180.f, 180.f);
+		tilt[i] = randomRange(0.f, 180.f);
+		spin[i] = randomRange(0.f, 360.f);
+		scale[i] = randomRange(1.f, 1000.f);
+		parentOffset[i] = glm::vec3(randomRange(-1e4f, 1e4f), randomRange(-1e3f, 1e3f), randomRange(-1e4f, 1e4f));
+		position[i] = glm::vec3(randomRange(-1e3f, 1e3f), randomRange(-1e2f, 1e2f), randomRange(-1e3f, 1e3f));
+	}
+	vector<glm::mat4> expected(bodyCount);
+	vector<glm::mat4> world(bodyCount);
+	vector<glm::vec3> worldPosition(bodyCount);
+
+	// chained glm rotate, translate and scale
+	long long updates = 0;
+	double start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		for (int i = 0; i < bodyCount; i++)
+		{
+			expected[i] = composeTransform(parentsRotation[i], parentOffset[i], ascendingNode[i], position[i], tilt[i], spin[i], scale[i]);
+		}
+		updates += bodyCount;
+	}
+	double chainRate = updates / (benchmarkTime() - start);
+
+	// closed form kernel
+	TransformBatch batch;
+	batch.count = bodyCount;
+	batch.parentsRotation = parentsRotation.data();
+	batch.ascendingNode = ascendingNode.data();
+	batch.tilt = tilt.data();
+	batch.spin = spin.data();
+	batch.scale = scale.data();
+	batch.parentOffset = parentOffset.data();
+	batch.position = position.data();
+	batch.world = world.data();
+	batch.worldPosition = worldPosition.data();
+	updates = 0;
+	start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		composeTransforms(batch);
+		updates += bodyCount;
+	}
+	double kernelRate = updates / (benchmarkTime() - start);
+
+	// rotation error relative to scale, translation error relative to distance
+	float maxRotationError = 0.f;
+	float maxTranslationError = 0.f;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			for (int r = 0; r < 3; r++)
+			{
+				float error = fabsf(world[i][c][r] - expected[i][c][r]) / scale[i];
+				if (error > maxRotationError) maxRotationError = error;
+			}
+		}
+		float distance = glm::length(parentOffset[i]) + glm::length(position[i]);
+		float error = glm::length(worldPosition[i] - glm::vec3(expected[i][3])) / distance;
+		if (error > maxTranslationError) maxTranslationError = error;
+	}
+
+	cout << "Model Matrix Composition (" << bodyCount << " bodies, single thread)\n";
+	cout << "  glm chain:  " << chainRate / 1e6 << "M matrices/s\n";
+	cout << "  kernel:     " << kernelRate / 1e6 << "M matrices/s (x" << kernelRate / chainRate << ")\n";
+	cout << "  max relative difference: rotation " << maxRotationError << ", translation " << maxTranslationError << "\n";
+}
+
+// cpu side of a frame in the same stages as the main loop (animate, transform, cull, submit)
+// without any gl calls: orbit components set the local transforms, the flat culler drops bodies
+// outside the view, instances are collected by the instance batcher and written to memory that
+// stands in for the mapped stream buffer, the reference body gets a packet
+// built either as a sun, planets around it and moons around random planets, or from a scene file
+// set up like the application
+struct SyntheticScene
+{
+	int bodyCount = 0;
+	vector<RenderedBody> bodies;
+	vector<BodyConst> constants;
+	OrbitSystem orbits;
+	SceneGraph graph;
+	BodyStore store;
+	FrustumCuller culler;
+	InstanceBatcher batcher;
+	RenderQueue queue;
+	vector<InstanceData> stream;
+	glm::mat4 projection;
+	glm::mat4 view;
+	glm::vec3 cameraPosition;
+	double simulationSeconds = 0.0;
+	double stageTimes[4] = { 0.0, 0.0, 0.0, 0.0 };		// animate, transform, cull, submit
+
+	void build(int bodyCount)
+	{
+		this->bodyCount = bodyCount;
+		srand(1);
+		vector<int> parents(bodyCount);
+		for (int i = 0; i < bodyCount; i++)
+		{
+			parents[i] = i == 0 ? -1 : (i < bodyCount / 10 ? 0 : 1 + rand() % (bodyCount / 10));
+			orbits.addBody(randomRange(10.f, 1000.f), randomRange(1.f, 100.f), 1.f, randomRange(1.f, 100.f), 0.f);
+		}
+		graph.build(parents);
+		for (int i = 0; i < bodyCount; i++)
+		{
+			graph.setConstants(i, 0.f, randomRange(0.f, 360.f), randomRange(0.f, 30.f), 1.f);
+		}
+
+		// every body animated and instanced, four meshes
+		bodies.assign(bodyCount, RenderedBody());
+		for (int i = 0; i < bodyCount; i++)
+		{
+			bodies[i].animatorIdx = i;
+			bodies[i].VAOIdx = i % 4;
+		}
+		buildComponents(4, -1, -1, 1.f);
+
+		cameraPosition = glm::vec3(0.f, 50.f, 200.f);
+		projection = glm::perspective(glm::radians(45.f), 1.6f, 10.f, 400000.f);
+		view = glm::lookAt(cameraPosition, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	}
+
+	void build(SceneFile& scene)
+	{
+		SceneSettings settings;
+		setupScene(scene, settings, bodies, constants, graph, orbits);
+		bodyCount = (int)bodies.size();
+		if (scene.getLightBody() != -1) graph.setLocal(scene.getLightBody(), glm::vec3(0.f), 0.f);
+		buildComponents(scene.getMeshCount(), scene.getReferenceBody(), scene.getLightBody(), settings.sphereObjectRadius);
+
+		// default camera distance from the sun, far planets fall behind the far plane like in the application
+		cameraPosition = glm::vec3(0.f, 20000.f, 60000.f);
+		projection = glm::perspective(glm::radians(45.f), 1.6f, 10.f, 400000.f);
+		view = glm::lookAt(cameraPosition, glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+	}
+
+	// same components as the application without gpu culling, one batch per mesh
+	void buildComponents(int meshCount, int packetBody, int lightBody, float objectRadius)
+	{
+		for (int m = 0; m < meshCount; m++) batcher.addBatch(1 + m, 0);
+		vector<int> batchSizes(meshCount, 0);
+		for (int i = 0; i < bodyCount; i++)
+		{
+			const RenderedBody& rb = bodies[i];
+			uint32_t mask = BodyStore::maskOf(COMPONENT_BOUNDS);
+			if (rb.animatorIdx != -1) mask |= BodyStore::maskOf(COMPONENT_ORBIT);
+			mask |= BodyStore::maskOf(i == packetBody ? COMPONENT_PACKET : COMPONENT_INSTANCE);
+
+			int body = store.addBody(mask);
+			store.get<BoundsComponent>(body).radius = rb.scale * objectRadius;
+			if (rb.animatorIdx != -1) store.get<OrbitComponent>(body).animatorIdx = rb.animatorIdx;
+			if (store.has(body, COMPONENT_PACKET))
+			{
+				PacketComponent& packet = store.get<PacketComponent>(body);
+				packet.VAOIdx = rb.VAOIdx;
+				packet.textureIdx = rb.textureIdx;
+				packet.transparent = rb.transparent;
+			}
+			else
+			{
+				InstanceComponent& instance = store.get<InstanceComponent>(body);
+				instance.batchIdx = rb.VAOIdx;
+				instance.textureLayer = rb.textureIdx;
+				instance.flags = i == lightBody ? InstanceBatcher::FLAG_UNLIT : 0;
+				batchSizes[rb.VAOIdx]++;
+			}
+		}
+		for (int b = 0; b < meshCount; b++) batcher.reserve(b, batchSizes[b]);
+		stream.resize(bodyCount);
+		culler.resize(bodyCount);
+		queue.reserve(bodyCount);
+	}
+
+	// jobs may be NULL (single thread)
+	void frame(JobSystem* jobs)
+	{
+		auto parallelFor = [jobs](int count, int grain, const auto& body)
+		{
+			if (jobs != NULL) jobs->parallelFor(count, grain, body);
+			else body(0, count);
+		};
+
+		double start = benchmarkTime();
+		simulationSeconds += 1.0 / 120.0;
+		orbits.evaluate(simulationSeconds, jobs);
+		const glm::vec3* orbitPositions = orbits.getPositions();
+		const float* spinAngles = orbits.getSpinAngles();
+		store.forEach(BodyStore::maskOf(COMPONENT_ORBIT), [&](BodyArchetype& archetype)
+		{
+			const int* rows = archetype.getBodies();
+			const OrbitComponent* orbitRows = archetype.column<OrbitComponent>();
+			parallelFor(archetype.getCount(), 1024, [&](int begin, int end)
+			{
+				for (int r = begin; r < end; r++)
+				{
+					int animatorIdx = orbitRows[r].animatorIdx;
+					graph.setLocal(rows[r], orbitPositions[animatorIdx], spinAngles[animatorIdx]);
+				}
+			});
+		});
+		double animated = benchmarkTime();
+
+		graph.update(jobs);
+		const glm::mat4* models = graph.getWorlds();
+		const glm::vec3* positions = graph.getWorldPositions();
+		double transformed = benchmarkTime();
+
+		store.forEach(BodyStore::maskOf(COMPONENT_BOUNDS), [&](BodyArchetype& archetype)
+		{
+			const int* rows = archetype.getBodies();
+			const BoundsComponent* bounds = archetype.column<BoundsComponent>();
+			parallelFor(archetype.getCount(), 1024, [&](int begin, int end)
+			{
+				for (int r = begin; r < end; r++) culler.setSphere(rows[r], positions[rows[r]], bounds[r].radius);
+			});
+		});
+		culler.setFrustum(projection, view);
+		culler.cull(jobs);
+		double culled = benchmarkTime();
+
+		// instances per batch and the reference body packet, instance data written into the
+		// stream and one instanced packet per batch, then the queue is sorted
+		queue.clear();
+		batcher.begin();
+		store.forEach(BodyStore::maskOf(COMPONENT_INSTANCE), [&](BodyArchetype& archetype)
+		{
+			const int* rows = archetype.getBodies();
+			const InstanceComponent* instances = archetype.column<InstanceComponent>();
+			batcher.addParallel(archetype.getCount(), [&](int begin, int end, const auto& add)
+			{
+				for (int r = begin; r < end; r++)
+				{
+					int i = rows[r];
+					if (!culler.isVisible(i)) continue;
+					add(instances[r].batchIdx, models[i], instances[r].textureLayer, instances[r].flags, glm::length(positions[i] - cameraPosition));
+				}
+			}, jobs);
+		});
+		store.forEach(BodyStore::maskOf(COMPONENT_PACKET), [&](BodyArchetype& archetype)
+		{
+			const int* rows = archetype.getBodies();
+			const PacketComponent* packets = archetype.column<PacketComponent>();
+			for (int r = 0; r < archetype.getCount(); r++)
+			{
+				int i = rows[r];
+				if (!culler.isVisible(i)) continue;
+				DrawPacket packet;
+				packet.VAO = 1 + packets[r].VAOIdx;
+				packet.textureCount = 3;
+				packet.model = models[i];
+				queue.push(packet, glm::length(positions[i] - cameraPosition), packets[r].transparent);
+			}
+		});
+		batcher.write(queue, 0, stream.data(), jobs);
+		queue.sort();
+		double submitted = benchmarkTime();
+
+		stageTimes[0] += animated - start;
+		stageTimes[1] += transformed - animated;
+		stageTimes[2] += culled - transformed;
+		stageTimes[3] += submitted - culled;
+	}
+};
+
+bool benchmarkFrameAllocations(int bodyCount, int frameCount)
+{
+	SyntheticScene scene;
+	scene.build(bodyCount);
+
+	// first frames grow the containers to their steady state capacity
+	for (int i = 0; i < 10; i++) scene.frame(NULL);
+
+	long long allocationStart = getThreadAllocationCount();
+	double start = benchmarkTime();
+	for (int i = 0; i < frameCount; i++) scene.frame(NULL);
+	double elapsed = benchmarkTime() - start;
+	long long allocations = getThreadAllocationCount() - allocationStart;
+
+	cout << "Frame Update (" << bodyCount << " bodies, " << frameCount << " frames)\n";
+	cout << "  " << elapsed / frameCount * 1000.0 << "ms/frame, visible " << scene.culler.getVisibleCount() << "\n";
+	cout << "  heap allocations: " << allocations << (allocations == 0 ? " (ok)" : " (FAILED, expected 0)") << "\n";
+	return allocations == 0;
+}
+
+bool benchmarkJobScaling(int bodyCount, int maxThreads)
+{
+	const double minDuration = 1.0;		// seconds per thread count
+	if (maxThreads <= 0) maxThreads = (int)thread::hardware_concurrency();
+	if (maxThreads <= 0) maxThreads = 1;
+
+	SyntheticScene scene;
+	scene.build(bodyCount);
+	JobSystem jobs;
+	bool passed = true;
+	double singleThreadTime = 0.0;
+	int singleThreadVisible = 0;
+
+	cout << "Job System Scaling (" << bodyCount << " bodies, " << thread::hardware_concurrency() << " hardware threads)\n";
+	for (int threads = 1; threads <= maxThreads; threads++)
+	{
+		jobs.start(threads);
+
+		// same simulation time for every thread count so the results can be compared
+		scene.simulationSeconds = 0.0;
+		for (int i = 0; i < 10; i++) scene.frame(&jobs);
+		int visible = scene.culler.getVisibleCount();
+
+		// every thread counts towards the global allocation count
+		long long allocationStart = getAllocationCount();
+		int frames = 0;
+		double start = benchmarkTime();
+		while (benchmarkTime() - start < minDuration)
+		{
+			scene.frame(&jobs);
+			frames++;
+		}
+		double frameTime = (benchmarkTime() - start) / frames;
+		long long allocations = getAllocationCount() - allocationStart;
+		jobs.stop();
+
+		if (threads == 1)
+		{
+			singleThreadTime = frameTime;
+			singleThreadVisible = visible;
+		}
+		bool ok = visible == singleThreadVisible && allocations == 0;
+		passed &= ok;
+		cout << "  " << threads << " thread" << (threads > 1 ? "s: " : ":  ") << frameTime * 1000.0 << "ms/frame (x"
+			<< singleThreadTime / frameTime << "), visible " << visible << ", heap allocations " << allocations
+			<< (ok ? "" : " (FAILED)") << "\n";
+	}
+	return passed;
+}
+
+bool benchmarkSceneLoad(int bodyCount)
+{
+	const char* path = "benchmark.scene.bin";
+	srand(1);
+
+	stringstream text;
+	generateSceneText(bodyCount, text);
+
+	double start = benchmarkTime();
+	vector<char> binary = SceneCompiler().compile(text, "benchmark");
+	double compileTime = benchmarkTime() - start;
+	{
+		ofstream out(path, ios::binary | ios::trunc);
+		out.write(binary.data(), binary.size());
+	}
+
+	// map, check every index and walk the hierarchy once
+	const int loadCount = 10;
+	double loadTime = 0.0;
+	double walkTime = 0.0;
+	long long checksum = 0;
+	bool passed = true;
+	for (int i = 0; i < loadCount; i++)
+	{
+		SceneFile scene;
+		start = benchmarkTime();
+		try
+		{
+			scene.load(path);
+		}
+		catch (const std::exception& e)
+		{
+			cout << "  " << e.what() << "\n";
+			passed = false;
+			break;
+		}
+		double loaded = benchmarkTime();
+		const SceneBody* bodies = scene.getBodies();
+		for (int b = 0; b < scene.getBodyCount(); b++)
+		{
+			checksum += bodies[b].parent;
+		}
+		double walked = benchmarkTime();
+		loadTime += loaded - start;
+		walkTime += walked - loaded;
+		passed &= scene.getBodyCount() == bodyCount;
+	}
+	remove(path);
+
+	cout << "Scene File (" << bodyCount << " bodies, " << binary.size() / (1024 * 1024) << "MB compiled)\n";
+	cout << "  compile text: " << compileTime * 1000.0 << "ms\n";
+	cout << "  load: " << loadTime / loadCount * 1000.0 << "ms, walk bodies: " << walkTime / loadCount * 1000.0
+		<< "ms (checksum " << checksum << ")" << (passed ? "" : " (FAILED)") << "\n";
+	return passed;
+}
+
+bool benchmarkSceneSetup(int bodyCount)
+{
+	srand(1);
+	stringstream text;
+	generateSceneText(bodyCount, text);
+	vector<char> binary = SceneCompiler().compile(text, "benchmark");
+	SceneFile scene;
+	scene.load(binary.data(), binary.size());
+
+	SceneSettings settings;
+	vector<RenderedBody> bodies;
+	vector<BodyConst> constants;
+	SceneGraph graph;
+	OrbitSystem orbits;
+	double start = benchmarkTime();
+	setupScene(scene, settings, bodies, constants, graph, orbits);
+	double setupTime = benchmarkTime() - start;
+
+	// previous layout, every body searched backwards for the last body with the same parent,
+	// only run where it finishes in reasonable time and checked against the linear pass
+	bool passed = orbits.getBodyCount() == bodyCount - 1;
+	double scanTime = -1.0;
+	if (bodyCount <= 100000)
+	{
+		vector<float> orbitRadius(bodyCount, 0.f);
+		start = benchmarkTime();
+		for (int i = 0; i < bodyCount; i++)
+		{
+			int parent = bodies[i].orbitParentIdx;
+			if (parent == -1) continue;
+			int preIdx = -1;
+			for (int j = i - 1; j > -1; j--)
+			{
+				if (bodies[j].orbitParentIdx == parent)
+				{
+					preIdx = j;
+					break;
+				}
+			}
+			float margin = bodies[i].distanceMargin * settings.distanceModifier;
+			float radius = bodies[i].scale * settings.sphereObjectRadius;
+			if (preIdx == -1) orbitRadius[i] = bodies[parent].scale * settings.sphereObjectRadius + radius + margin;
+			else orbitRadius[i] = orbitRadius[preIdx] + bodies[preIdx].scale * settings.sphereObjectRadius + radius + margin;
+		}
+		scanTime = benchmarkTime() - start;
+		for (int i = 0; i < bodyCount; i++)
+		{
+			passed &= orbitRadius[i] == bodies[i].orbitRadius;
+		}
+	}
+
+	cout << "Scene Setup (" << bodyCount << " bodies)\n";
+	cout << "  linear passes: " << setupTime * 1000.0 << "ms" << (passed ? "" : " (FAILED)") << "\n";
+	if (scanTime >= 0.0) cout << "  sibling scan orbit layout alone: " << scanTime * 1000.0 << "ms\n";
+	return passed;
+}
+
+bool benchmarkBodyStore(int bodyCount)
+{
+	const double minDuration = 1.0;
+	srand(1);
+
+	// body struct layout before the component store, every per frame field next to the configuration
+	struct WideBody
+	{
+		glm::vec3 position = glm::vec3(0.f);
+		glm::vec3 finalPosition = glm::vec3(0.f);
+		float rotation = 0.f;
+		bool randomSpinAngle = true;
+		float parentsAscendingNodeSum = 0.f;
+		float allInclinationSum = 0.f;
+		float scale = 1.f;
+		float scaleModifier = 1.f;
+		float distanceMargin = 0.f;
+		float orbitRadius = 0.f;
+		float ovalRatio = 1.f;
+		int bodyConstantIdx = -1;
+		int animatorIdx = -1;
+		int orbitParentIdx = -1;
+		int VAOIdx = -1;
+		int textureIdx = -1;
+		int textureLayer = 0;
+		bool modelViewed = true;
+		bool transparent = false;
+	};
+
+	// a static tenth of the bodies, the rest animated and instanced
+	vector<WideBody> wide(bodyCount);
+	BodyStore store;
+	vector<float> meshRadius = { 1.f, 2.f, 3.f, 4.f };
+	int animatorCount = 0;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		WideBody& body = wide[i];
+		body.animatorIdx = i % 10 == 0 ? -1 : animatorCount++;
+		body.scale = randomRange(0.1f, 10.f);
+		body.VAOIdx = rand() % (int)meshRadius.size();
+
+		uint32_t mask = BodyStore::maskOf(COMPONENT_BOUNDS) | BodyStore::maskOf(COMPONENT_INSTANCE);
+		if (body.animatorIdx != -1) mask |= BodyStore::maskOf(COMPONENT_ORBIT);
+		int idx = store.addBody(mask);
+		store.get<BoundsComponent>(idx).radius = body.scale * meshRadius[body.VAOIdx];
+		if (body.animatorIdx != -1) store.get<OrbitComponent>(idx).animatorIdx = body.animatorIdx;
+	}
+	vector<glm::vec3> statePositions(animatorCount);
+	vector<float> stateRotations(animatorCount);
+	for (int i = 0; i < animatorCount; i++)
+	{
+		statePositions[i] = glm::vec3(randomRange(-100.f, 100.f), 0.f, randomRange(-100.f, 100.f));
+		stateRotations[i] = randomRange(0.f, 360.f);
+	}
+	vector<glm::vec4> locals(bodyCount);		// stands in for the scene graph local state
+	vector<glm::vec3> worldPositions(bodyCount, glm::vec3(1.f));
+	vector<glm::vec4> spheres(bodyCount);		// stands in for the culler
+
+	// animation and culling input sweeps over the wide structs
+	double checksum = 0.0;
+	int frames = 0;
+	double start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		for (int i = 0; i < bodyCount; i++)
+		{
+			WideBody& body = wide[i];
+			if (body.animatorIdx == -1) continue;
+			body.position = statePositions[body.animatorIdx];
+			body.rotation = stateRotations[body.animatorIdx];
+			locals[i] = glm::vec4(body.position, body.rotation);
+		}
+		for (int i = 0; i < bodyCount; i++)
+		{
+			WideBody& body = wide[i];
+			body.finalPosition = worldPositions[i];
+			spheres[i] = glm::vec4(worldPositions[i], body.scale * meshRadius[body.VAOIdx]);
+		}
+		checksum += spheres[bodyCount - 1].w;
+		frames++;
+	}
+	double wideTime = (benchmarkTime() - start) / frames;
+	vector<glm::vec4> wideSpheres = spheres;
+	vector<glm::vec4> wideLocals = locals;
+
+	// same sweeps over the component columns
+	frames = 0;
+	start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		store.forEach(BodyStore::maskOf(COMPONENT_ORBIT), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const OrbitComponent* orbits = archetype.column<OrbitComponent>();
+			for (int r = 0; r < archetype.getCount(); r++)
+			{
+				int animatorIdx = orbits[r].animatorIdx;
+				locals[bodies[r]] = glm::vec4(statePositions[animatorIdx], stateRotations[animatorIdx]);
+			}
+		});
+		store.forEach(BodyStore::maskOf(COMPONENT_BOUNDS), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const BoundsComponent* bounds = archetype.column<BoundsComponent>();
+			for (int r = 0; r < archetype.getCount(); r++)
+			{
+				spheres[bodies[r]] = glm::vec4(worldPositions[bodies[r]], bounds[r].radius);
+			}
+		});
+		checksum += spheres[bodyCount - 1].w;
+		frames++;
+	}
+	double storeTime = (benchmarkTime() - start) / frames;
+	bool passed = spheres == wideSpheres && locals == wideLocals;
+
+	cout << "Body Storage (" << bodyCount << " bodies, " << store.getArchetypeCount() << " archetypes, single thread)\n";
+	cout << "  body structs (" << sizeof(WideBody) << " bytes each): " << wideTime * 1000.0 << "ms/frame\n";
+	cout << "  component columns: " << storeTime * 1000.0 << "ms/frame (x" << wideTime / storeTime << ")"
+		<< (passed ? "" : " (FAILED)") << " (checksum " << checksum << ")\n";
+	return passed;
+}
+
+bool benchmarkBvh(int bodyCount)
+{
+	const double minDuration = 1.0;
+	const int queryCount = 1000;
+	const int k = 8;
+
+	SyntheticScene scene;
+	scene.build(bodyCount);
+	for (int i = 0; i < 10; i++) scene.frame(NULL);
+	vector<float> radius(bodyCount);
+	for (int i = 0; i < bodyCount; i++) radius[i] = randomRange(0.5f, 5.f);
+
+	SphereBvh bvh;
+	FrustumCuller culler;
+	bvh.resize(bodyCount);
+	culler.resize(bodyCount);
+	auto setSpheres = [&]()
+	{
+		const glm::vec3* positions = scene.graph.getWorldPositions();
+		for (int i = 0; i < bodyCount; i++)
+		{
+			bvh.setSphere(i, positions[i], radius[i]);
+			culler.setSphere(i, positions[i], radius[i]);
+		}
+	};
+	setSpheres();
+	double start = benchmarkTime();
+	bvh.build();
+	double buildTime = benchmarkTime() - start;
+
+	// moving bodies, refit and both culling paths every frame, hierarchical culling must agree
+	JobSystem jobs;
+	jobs.start();
+	double refitTime = 0.0;
+	double parallelRefitTime = 0.0;
+	double bruteCullTime = 0.0;
+	double bvhCullTime = 0.0;
+	vector<unsigned char> bruteVisible(bodyCount);
+	int mismatches = 0;
+	int frames = 0;
+	int rebuildStart = bvh.getRebuildCount();
+	double benchmarkStart = benchmarkTime();
+	while (benchmarkTime() - benchmarkStart < minDuration * 2.0)
+	{
+		scene.frame(NULL);
+		setSpheres();
+		culler.setFrustum(scene.projection, scene.view);
+
+		start = benchmarkTime();
+		if (frames % 2 == 0) bvh.refit();
+		else bvh.refit(&jobs);
+		double refitted = benchmarkTime();
+		culler.cull();
+		double bruteCulled = benchmarkTime();
+		for (int i = 0; i < bodyCount; i++) bruteVisible[i] = culler.isVisible(i);
+		double bvhStart = benchmarkTime();
+		culler.cull(bvh);
+		double bvhCulled = benchmarkTime();
+
+		if (frames % 2 == 0) refitTime += refitted - start;
+		else parallelRefitTime += refitted - start;
+		bruteCullTime += bruteCulled - refitted;
+		bvhCullTime += bvhCulled - bvhStart;
+		for (int i = 0; i < bodyCount; i++) mismatches += bruteVisible[i] != (unsigned char)culler.isVisible(i);
+		frames++;
+	}
+	jobs.stop();
+	int rebuilds = bvh.getRebuildCount() - rebuildStart;
+
+	// queries against brute force over every sphere
+	const glm::vec3* positions = scene.graph.getWorldPositions();
+	auto surfaceDistance = [&](const glm::vec3& point, int i)
+	{
+		return fmaxf(glm::length(point - positions[i]) - radius[i], 0.f);
+	};
+	vector<glm::vec3> points(queryCount);
+	vector<glm::vec3> directions(queryCount);
+	for (int q = 0; q < queryCount; q++)
+	{
+		points[q] = glm::vec3(randomRange(-200.f, 200.f), randomRange(-50.f, 50.f), randomRange(-200.f, 200.f));
+		directions[q] = glm::normalize(positions[rand() % bodyCount] - points[q]);
+	}
+	int queryErrors = 0;
+	long long checksum = 0;
+	vector<int> result;
+	result.reserve(bodyCount);
+
+	start = benchmarkTime();
+	for (int q = 0; q < queryCount; q++) checksum += bvh.raycast(points[q], directions[q]);
+	double rayTime = benchmarkTime() - start;
+	start = benchmarkTime();
+	for (int q = 0; q < queryCount; q++)
+	{
+		bvh.nearest(points[q], k, result);
+		checksum += result[0];
+	}
+	double nearestTime = benchmarkTime() - start;
+	start = benchmarkTime();
+	for (int q = 0; q < queryCount; q++)
+	{
+		bvh.overlap(points[q], 20.f, result);
+		checksum += result.size();
+	}
+	double overlapTime = benchmarkTime() - start;
+
+	start = benchmarkTime();
+	vector<float> distances(bodyCount);
+	for (int q = 0; q < queryCount; q++)
+	{
+		// closest ray hit
+		float best = INFINITY;
+		for (int i = 0; i < bodyCount; i++)
+		{
+			glm::vec3 offset = points[q] - positions[i];
+			float b = glm::dot(offset, directions[q]);
+			float c = glm::dot(offset, offset) - radius[i] * radius[i];
+			glm::vec3 perpendicular = offset - b * directions[q];
+			float discriminant = radius[i] * radius[i] - glm::dot(perpendicular, perpendicular);
+			if (discriminant < 0.f) continue;
+			float t = c <= 0.f ? 0.f : -b - sqrtf(discriminant);
+			if (t >= 0.f && t < best) best = t;
+		}
+		float hit = INFINITY;
+		bvh.raycast(points[q], directions[q], NULL, &hit);
+		queryErrors += hit != best;
+
+		// k nearest distances
+		for (int i = 0; i < bodyCount; i++) distances[i] = surfaceDistance(points[q], i);
+		partial_sort(distances.begin(), distances.begin() + k, distances.end());
+		bvh.nearest(points[q], k, result);
+		for (int j = 0; j < k; j++) queryErrors += surfaceDistance(points[q], result[j]) != distances[j];
+
+		// spheres within radius
+		int inRange = 0;
+		for (int i = 0; i < bodyCount; i++)
+		{
+			float reach = 20.f + radius[i];
+			glm::vec3 offset = points[q] - positions[i];
+			inRange += glm::dot(offset, offset) <= reach * reach;
+		}
+		bvh.overlap(points[q], 20.f, result);
+		queryErrors += (int)result.size() != inRange;
+	}
+	double bruteQueryTime = benchmarkTime() - start;
+
+	bool passed = mismatches == 0 && queryErrors == 0;
+	cout << "Bounding Volume Hierarchy (" << bodyCount << " moving bodies, " << frames << " frames)\n";
+	cout << "  build: " << buildTime * 1000.0 << "ms, rebuilt " << rebuilds << " times\n";
+	cout << "  refit: " << refitTime / ((frames + 1) / 2) * 1000.0 << "ms/frame single thread, "
+		<< parallelRefitTime / (frames / 2) * 1000.0 << "ms/frame job system\n";
+	cout << "  cull: " << bruteCullTime / frames * 1000.0 << "ms/frame every sphere, " << bvhCullTime / frames * 1000.0
+		<< "ms/frame hierarchical, " << mismatches << " differences" << (mismatches == 0 ? "" : " (FAILED)") << "\n";
+	cout << "  " << queryCount << " queries: ray " << rayTime * 1000.0 << "ms, " << k << " nearest " << nearestTime * 1000.0
+		<< "ms, radius " << overlapTime * 1000.0 << "ms (brute force all three " << bruteQueryTime * 1000.0 << "ms), "
+		<< queryErrors << " wrong" << (queryErrors == 0 ? "" : " (FAILED)") << " (checksum " << checksum << ")\n";
+	return passed;
+}
+
+bool benchmarkUpdateScheduler(int bodyCount, int budget)
+{
+	const double minDuration = 1.0;
+	const double tick = 1.0 / 120.0;
+	const float maxErrorFraction = 0.002f;
+	srand(1);
+
+	// orbits from seconds to a day, seen from 100 to 100k units away, a third of them off screen
+	OrbitSystem scheduled;
+	OrbitSystem reference;
+	UpdateScheduler scheduler;
+	scheduler.resize(bodyCount);
+	scheduler.setTickSeconds(tick);
+	scheduler.setBudget(budget);
+	scheduler.setMaxError(0.5f, maxErrorFraction);
+	float projectionScale = UpdateScheduler::getProjectionScale(45.f, 800);
+	vector<float> pixelsPerUnit(bodyCount);
+	vector<float> bodyRadius(bodyCount);
+	for (int i = 0; i < bodyCount; i++)
+	{
+		float delay = expf(randomRange(logf(2.f), logf(86400.f)));
+		float days = randomRange(0.01f, 400.f);
+		float oval = randomRange(1.f, 1.5f);
+		float radius = randomRange(1.f, 1000.f);
+		float tilt = randomRange(0.f, 30.f);
+		float spin = randomRange(0.f, 360.f);
+		float angle = randomRange(0.f, 360.f);
+		for (OrbitSystem* orbits : { &scheduled, &reference })
+		{
+			orbits->addBody(delay, days, oval, radius, tilt);
+			orbits->setSpinAngle(i, spin);
+			orbits->setOrbitAngle(i, angle);
+		}
+		bodyRadius[i] = randomRange(0.5f, 5.f);
+		scheduler.setBodyRadius(i, bodyRadius[i]);
+		pixelsPerUnit[i] = rand() % 3 == 0 ? 0.f : projectionScale / randomRange(100.f, 100000.f);
+		scheduler.setView(i, pixelsPerUnit[i]);
+	}
+
+	// every body evaluated every tick
+	double simulationSeconds = 0.0;
+	double checksum = 0.0;
+	int ticks = 0;
+	double start = benchmarkTime();
+	while (benchmarkTime() - start < minDuration)
+	{
+		simulationSeconds += tick;
+		reference.evaluate(simulationSeconds);
+		checksum += reference.getPositions()[bodyCount - 1].x;
+		ticks++;
+	}
+	double exactTime = (benchmarkTime() - start) / ticks;
+
+	// same time span scheduled, the first tick tiers and evaluates every body
+	simulationSeconds = 0.0;
+	scheduled.evaluate(simulationSeconds);
+	long long tickIdx = 0;
+	simulationSeconds += tick;
+	scheduled.evaluateScheduled(simulationSeconds, scheduler.schedule(scheduled, tickIdx++));
+	double scheduleTime = 0.0;
+	double evaluateTime = 0.0;
+	int maxExact = 0;
+	long long exactSum = 0;
+	for (int t = 0; t < ticks; t++)
+	{
+		simulationSeconds += tick;
+		start = benchmarkTime();
+		const vector<int>& exact = scheduler.schedule(scheduled, tickIdx++);
+		double evaluateStart = benchmarkTime();
+		scheduled.evaluateScheduled(simulationSeconds, exact);
+		evaluateTime += benchmarkTime() - evaluateStart;
+		scheduleTime += evaluateStart - start;
+		maxExact = max(maxExact, (int)exact.size());
+		exactSum += exact.size();
+		checksum += scheduled.getPositions()[bodyCount - 1].x;
+	}
+	scheduleTime /= ticks;
+	evaluateTime /= ticks;
+
+	// extrapolation error, drift grows with the square of the period so slowing tiers down to meet
+	// the budget raises the orbit bound by 4 per tier, on screen bodies have to stay within their
+	// pixel error (up to 8 times for bodies smaller than a pixel), 4 times that per tier they were
+	// slowed down, which the scheduler caps at MAX_VISIBLE_SLOWDOWN
+	reference.evaluate(simulationSeconds);
+	int slowdown = max(scheduler.getSlowdown(), scheduler.getVisibleSlowdown());
+	float bound = maxErrorFraction * (float)(1 << (2 * slowdown)) * 1.05f + 1e-5f;
+	float maxError = 0.f;
+	float maxPixelError = 0.f;
+	float maxPixelRatio = 0.f;		// error over the pixel error allowed for the body
+	for (int i = 0; i < bodyCount; i++)
+	{
+		float error = glm::length(scheduled.getPositions()[i] - reference.getPositions()[i]);
+		maxError = max(maxError, error / reference.getOrbitRadius(i));
+		if (pixelsPerUnit[i] <= 0.f) continue;
+		float sizePixels = bodyRadius[i] * pixelsPerUnit[i];
+		float allowed = 0.5f * min(max(1.f / sizePixels, 1.f), 8.f);
+		maxPixelError = max(maxPixelError, error * pixelsPerUnit[i]);
+		maxPixelRatio = max(maxPixelRatio, error * pixelsPerUnit[i] / allowed);
+	}
+	float pixelBound = 1.05f * (float)(1 << (2 * scheduler.getVisibleSlowdown()));
+	float pixelCeiling = 1.05f * (float)(1 << (2 * UpdateScheduler::MAX_VISIBLE_SLOWDOWN));
+	bool pixelsOk = maxPixelRatio <= pixelBound && maxPixelRatio <= pixelCeiling;
+	bool passed = maxError <= bound && maxExact <= budget + UpdateScheduler::RETIER_PER_TICK && pixelsOk;
+
+	cout << "Update Scheduler (" << bodyCount << " bodies, budget " << budget << " exact evaluations/tick, single thread)\n";
+	cout << "  every body exact: " << exactTime * 1000.0 << "ms/tick (the application schedules from " 
+		<< UpdateScheduler::MIN_BODIES << " bodies, " << (bodyCount >= UpdateScheduler::MIN_BODIES ? "on" : "off") << " here)\n";
+	cout << "  scheduled: " << (scheduleTime + evaluateTime) * 1000.0 << "ms/tick (x" << exactTime / (scheduleTime + evaluateTime)
+		<< ", scheduling " << scheduleTime * 1000.0 << "ms), exact " << exactSum / ticks << "/tick, max " << maxExact
+		<< (maxExact <= budget + UpdateScheduler::RETIER_PER_TICK ? "" : " (FAILED)") << "\n";
+	cout << "  tiers:";
+	for (int k = 0; k <= UpdateScheduler::MAX_TIER; k++) cout << " " << scheduler.getTierCount(k);
+	cout << ", slowed down by " << scheduler.getSlowdown() << " off screen, " << scheduler.getVisibleSlowdown() << " on screen\n";
+	cout << "  max error: " << maxError << " of the orbit radius (bound " << bound << ")" << (maxError <= bound ? "" : " (FAILED)")
+		<< ", " << maxPixelError << " pixels on screen, " << maxPixelRatio << " of the allowed pixel error (bound "
+		<< pixelBound << ", ceiling " << pixelCeiling << ")" << (pixelsOk ? "" : " (FAILED)") << " (checksum " << checksum << ")\n";
+	return passed;
+}
+
+bool benchmarkNBody(int particleCount)
+{
+	const double minDuration = 1.0;
+	const int sampleCount = 2000;
+	const float openingAngle = 0.5f;
+	srand(1);
+
+	// self gravitating clouds, denser towards the center, no attractors
+	auto makeCloud = [](NBodySystem& cloud, int count, float theta)
+	{
+		cloud.reserve(count);
+		for (int i = 0; i < count; i++)
+		{
+			glm::vec3 direction = glm::normalize(glm::vec3(randomRange(-1.f, 1.f), randomRange(-1.f, 1.f), randomRange(-1.f, 1.f)) + 1e-6f);
+			float r = 100.f * powf(randomRange(0.f, 1.f), 1.5f);
+			cloud.addParticle(direction * r, glm::vec3(0.f), 1.f / count);
+		}
+		cloud.setSoftening(0.01f);
+		cloud.setOpeningAngle(theta);
+	};
+	NBodySystem cloud;
+	makeCloud(cloud, particleCount, openingAngle);
+
+	JobSystem jobs;
+	jobs.start();
+	auto timeForces = [&](NBodySystem& system)
+	{
+		int evaluations = 0;
+		double start = benchmarkTime();
+		while (benchmarkTime() - start < minDuration || evaluations < 2)
+		{
+			system.computeForces(&jobs);
+			evaluations++;
+		}
+		return (benchmarkTime() - start) / evaluations;
+	};
+	double treeTime = timeForces(cloud);
+
+	// direct sum with the same simd kernel (theta 0 opens every cell), n^2 so it is measured on a
+	// smaller cloud and scaled up by the number of pairs
+	int directCount = min(particleCount, 10000);
+	NBodySystem directCloud;
+	makeCloud(directCloud, directCount, 0.f);
+	double directTime = timeForces(directCloud) * ((double)particleCount * particleCount) / ((double)directCount * directCount);
+
+	// accuracy against a double precision sum on evenly spread samples
+	vector<glm::vec3> direct(sampleCount);
+	for (int s = 0; s < sampleCount; s++) direct[s] = cloud.getDirectAcceleration((int)((long long)s * particleCount / sampleCount));
+
+	double squaredError = 0.0;
+	float maxError = 0.f;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		glm::vec3 tree = cloud.getAcceleration((int)((long long)s * particleCount / sampleCount));
+		float error = glm::length(tree - direct[s]) / glm::length(direct[s]);
+		squaredError += error * error;
+		maxError = max(maxError, error);
+	}
+	float rmsError = (float)sqrt(squaredError / sampleCount);
+
+	// steady state steps must not allocate
+	for (int i = 0; i < 2; i++) cloud.step(1e-3, &jobs);
+	long long allocationStart = getThreadAllocationCount();
+	for (int i = 0; i < 2; i++) cloud.step(1e-3, &jobs);
+	long long allocations = getThreadAllocationCount() - allocationStart;
+	int threadCount = jobs.getThreadCount();
+	jobs.stop();
+
+	// energy of an eccentric ring of light particles around a fixed attractor over 10 inner orbits
+	const int ringCount = 256;
+	const double dt = 0.01;
+	double drift[2];
+	for (int k = 0; k < 2; k++)
+	{
+		NBodySystem ring;
+		ring.addAttractor(-1, glm::mat3(1.f), 1.f);
+		for (int i = 0; i < ringCount; i++)
+		{
+			float r = randomRange(1.f, 2.f);
+			float angle = randomRange(0.f, 2.f * (float)M_PI);
+			glm::vec3 position = glm::vec3(cosf(angle), randomRange(-0.01f, 0.01f), sinf(angle)) * r;
+			glm::vec3 velocity = glm::vec3(-sinf(angle), 0.f, cosf(angle)) * (0.9f / sqrtf(r));
+			ring.addParticle(position, velocity, 1e-6f);
+		}
+		ring.setOpeningAngle(openingAngle);
+		ring.setSoftening(0.05f);
+		ring.setIntegrator(k == 0 ? NBodySystem::LEAPFROG : NBodySystem::YOSHIDA4);
+		ring.computeForces();
+		double e0 = ring.getEnergy();
+		drift[k] = 0.0;
+		for (int n = 0; n < (int)(20.0 * M_PI / dt); n++)
+		{
+			ring.step(dt);
+			drift[k] = max(drift[k], fabs((ring.getEnergy() - e0) / e0));
+		}
+	}
+
+	// monopoles at theta 0.5 stay well within a percent, symplectic steps don't drift
+	bool passed = rmsError < 0.01f && allocations == 0 && drift[0] < 1e-4 && drift[1] < 1e-5;
+	cout << "N-Body Gravity (" << particleCount << " particles, theta " << openingAngle << ", "
+		<< threadCount << " threads)\n";
+	cout << "  barnes hut: " << treeTime * 1000.0 << "ms per force evaluation (" << particleCount / treeTime / 1e6
+		<< "M particles/s), " << cloud.getNodeCount() << " nodes, "
+		<< (double)cloud.getInteractionCount() / particleCount << " interactions per particle\n";
+	cout << "  direct O(n^2): " << directTime * 1000.0 << "ms per force evaluation (" << particleCount / directTime / 1e6
+		<< "M particles/s, scaled from " << directCount << " particles) (x" << directTime / treeTime << ")\n";
+	cout << "  acceleration error: rms " << rmsError * 100.f << "%, max " << maxError * 100.f << "%"
+		<< (rmsError < 0.01f ? "\n" : " (FAILED)\n");
+	cout << "  energy drift over 10 orbits, dt " << dt << ": leapfrog " << drift[0] << ", yoshida " << drift[1]
+		<< (drift[0] < 1e-4 && drift[1] < 1e-5 ? "\n" : " (FAILED)\n");
+	cout << "  heap allocations per step: " << allocations << (allocations == 0 ? " (ok)" : " (FAILED, expected 0)") << "\n";
+	return passed;
+}
+
+// circular orbit for a generated spk kernel, ecliptic km
+struct SpkTestOrbit
+{
+	double radius;
+	double rate;			// radians per second
+	double inclination;		// radians
+	double phase;
+};
+
+static glm::dvec3 spkTestPosition(const SpkTestOrbit& orbit, double seconds)
+{
+	double angle = orbit.phase + orbit.rate * seconds;
+	return orbit.radius * glm::dvec3(cos(angle), sin(angle) * cos(orbit.inclination), sin(angle) * sin(orbit.inclination));
+}
+
+// DAF/SPK file with one type 2 segment per orbit, covering [0, span] with chebyshev records fit at
+// the chebyshev nodes, orbit 0 is target 10 around the barycenter and orbit k is target 1000 + k
+// around it, odd targets are stored in the J2000 equator frame
+static void writeSpkKernel(const vector<SpkTestOrbit>& orbits, double span, double interval, int coefficientCount, vector<double>& out)
+{
+	const double obliquity = 84381.448 / 3600.0 * (M_PI / 180.0);
+	int recordCount = (int)ceil(span / interval);
+	struct Summary { double start, end; int32_t ints[6]; };
+	vector<Summary> summaries;
+
+	// file record, then the segments
+	out.assign(128, 0.0);
+	vector<glm::dvec3> values(coefficientCount);
+	for (int s = 0; s < orbits.size(); s++)
+	{
+		bool equatorial = s % 2 == 1;
+		int first = (int)out.size() + 1;
+		for (int r = 0; r < recordCount; r++)
+		{
+			double radius = interval * 0.5;
+			double mid = r * interval + radius;
+			for (int m = 0; m < coefficientCount; m++)
+			{
+				glm::dvec3 p = spkTestPosition(orbits[s], mid + radius * cos(M_PI * (m + 0.5) / coefficientCount));
+				if (equatorial) p = glm::dvec3(p.x, cos(obliquity) * p.y - sin(obliquity) * p.z, sin(obliquity) * p.y + cos(obliquity) * p.z);
+				values[m] = p;
+			}
+			out.push_back(mid);
+			out.push_back(radius);
+			for (int axis = 0; axis < 3; axis++)
+			{
+				for (int k = 0; k < coefficientCount; k++)
+				{
+					double c = 0.0;
+					for (int m = 0; m < coefficientCount; m++) c += values[m][axis] * cos(M_PI * k * (m + 0.5) / coefficientCount);
+					out.push_back(c * (k == 0 ? 1.0 : 2.0) / coefficientCount);
+				}
+			}
+		}
+		out.push_back(0.0);
+		out.push_back(interval);
+		out.push_back(2.0 + 3.0 * coefficientCount);
+		out.push_back(recordCount);
+		Summary summary = { 0.0, span, { s == 0 ? 10 : 1000 + s, s == 0 ? 0 : 10, equatorial ? 1 : 17, 2, first, (int32_t)out.size() } };
+		summaries.push_back(summary);
+	}
+
+	// summary records of 25 summaries, each followed by an empty name record
+	out.resize((out.size() + 127) / 128 * 128, 0.0);
+	int firstSummaryRecord = (int)out.size() / 128 + 1;
+	for (int n = 0; n < summaries.size(); n += 25)
+	{
+		int count = min(25, (int)summaries.size() - n);
+		size_t word = out.size();
+		int record = (int)word / 128 + 1;
+		out.resize(word + 256, 0.0);
+		out[word] = n + 25 < summaries.size() ? record + 2 : 0.0;
+		out[word + 1] = n == 0 ? 0.0 : record - 2;
+		out[word + 2] = count;
+		for (int i = 0; i < count; i++)
+		{
+			out[word + 3 + i * 5] = summaries[n + i].start;
+			out[word + 4 + i * 5] = summaries[n + i].end;
+			memcpy(&out[word + 5 + i * 5], summaries[n + i].ints, sizeof(summaries[n + i].ints));
+		}
+	}
+
+	char* file = (char*)out.data();
+	uint16_t one = 1;
+	int32_t header[5] = { 2, 6 };
+	memcpy(file, "DAF/SPK ", 8);
+	memcpy(file + 8, header, 8);
+	memcpy(file + 16, "benchmark kernel", 16);
+	header[0] = firstSummaryRecord;
+	header[1] = (int32_t)out.size() / 128 - 1;
+	header[2] = (int32_t)out.size() + 1;
+	memcpy(file + 76, header, 12);
+	memcpy(file + 88, *(const char*)&one == 1 ? "LTL-IEEE" : "BIG-IEEE", 8);
+}
+
+bool benchmarkEphemeris(int bodyCount)
+{
+	const double minDuration = 1.0;
+	const double day = 86400.0;
+	const double span = 400.0 * day;
+	const int sampleCount = 10000;
+	srand(1);
+
+	// planets and moons from 10 to 1000 days per orbit, 4 day records of degree 12 like the DE kernels' inner planets
+	vector<SpkTestOrbit> orbits(bodyCount + 1);
+	for (int i = 0; i <= bodyCount; i++)
+	{
+		orbits[i].radius = i == 0 ? 1e6 : expf(randomRange(logf(1e5f), logf(5e9f)));
+		orbits[i].rate = 2.0 * M_PI / ((i == 0 ? 4000.0 : expf(randomRange(logf(10.f), logf(1000.f)))) * day);
+		orbits[i].inclination = randomRange(0.f, 0.5f);
+		orbits[i].phase = randomRange(0.f, 2.f * (float)M_PI);
+	}
+	vector<double> kernel;
+	writeSpkKernel(orbits, span, 4.0 * day, 13, kernel);
+
+	SpkEphemeris ephemeris;
+	double loadStart = benchmarkTime();
+	ephemeris.load(kernel.data(), kernel.size() * sizeof(double));
+	double loadTime = benchmarkTime() - loadStart;
+	for (int i = 1; i <= bodyCount; i++) ephemeris.addBody(1000 + i, 10, i - 1, glm::dmat3(1.0));
+	ephemeris.setTimeScale(day);
+
+	// one simulation second per day (the records change every 4 evaluations), then random times
+	auto timeEvaluate = [&](bool sequential)
+	{
+		int evaluations = 0;
+		double start = benchmarkTime();
+		while (benchmarkTime() - start < minDuration)
+		{
+			for (int n = 0; n < 64; n++, evaluations++)
+			{
+				ephemeris.evaluate(sequential ? evaluations % 400 : randomRange(0.f, 400.f));
+			}
+		}
+		return (benchmarkTime() - start) / evaluations;
+	};
+	double sequentialTime = timeEvaluate(true);
+	double randomTime = timeEvaluate(false);
+
+	long long allocationStart = getThreadAllocationCount();
+	for (int n = 0; n < 400; n++) ephemeris.evaluate(n * 0.999);
+	long long allocations = getThreadAllocationCount() - allocationStart;
+
+	// positions relative to the orbit radius, in double and through the float position source
+	double maxError = 0.0;
+	double maxSourceError = 0.0;
+	for (int s = 0; s < sampleCount; s++)
+	{
+		int i = 1 + rand() % bodyCount;
+		double seconds = randomRange(0.f, 1.f) * span;
+		glm::dvec3 expected = spkTestPosition(orbits[i], seconds);
+		maxError = max(maxError, glm::length(ephemeris.getPosition(1000 + i, 10, seconds) - expected) / orbits[i].radius);
+		ephemeris.evaluate(seconds / day);
+		glm::dvec3 source = glm::dvec3(ephemeris.getPositions()[i - 1]);
+		maxSourceError = max(maxSourceError, glm::length(source - expected) / orbits[i].radius);
+	}
+
+	bool passed = maxError < 1e-9 && maxSourceError < 1e-6 && allocations == 0;
+	cout << "SPK Ephemeris (" << bodyCount << " bodies around a moving sun, " << kernel.size() * sizeof(double) / (1024 * 1024)
+		<< "MB kernel, " << ephemeris.getSegmentCount() << " segments)\n";
+	cout << "  load: " << loadTime * 1000.0 << "ms (summaries only)\n";
+	cout << "  evaluate: " << sequentialTime * 1e6 << "us per time step (" << bodyCount / sequentialTime / 1e6
+		<< "M bodies/s), random times " << randomTime * 1e6 << "us (" << bodyCount / randomTime / 1e6 << "M bodies/s)\n";
+	cout << "  max error: " << maxError << " of the orbit radius, " << maxSourceError << " as float"
+		<< (maxError < 1e-9 && maxSourceError < 1e-6 ? "\n" : " (FAILED)\n");
+	cout << "  heap allocations per evaluation: " << allocations << (allocations == 0 ? " (ok)" : " (FAILED, expected 0)") << "\n";
+	return passed;
+}
+
+// MPCORB.DAT like text: header, numbered bodies, a blank line and every 10000th line cut short,
+// the expected values are read back from the written fields
+struct CatalogTestBody
+{
+	double a;
+	double h;		// NaN if blank
+	double e;
+	double m;
+	double n;
+	int number;		// designation
+};
+
+static void writeCatalogText(int lineCount, string& text, vector<CatalogTestBody>& written)
+{
+	text = "MINOR PLANET CENTER ORBIT DATABASE (MPCORB)\n\nDes'n     H     G   Epoch     M        Peri.      Node       Incl.       e            n           a\n"
+		"----------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------------\n";
+	text.reserve(text.size() + (size_t)lineCount * 203);
+	written.clear();
+	char line[256];
+	for (int i = 0; i < lineCount; i++)
+	{
+		if (i == lineCount / 2) text += "\n";
+		float a = expf(randomRange(logf(0.8f), logf(60.f)));
+		float h = randomRange(3.f, 25.f);
+		float e = randomRange(0.f, 0.4f);
+		float m = randomRange(0.f, 360.f);
+		float n = 0.98560767f / powf(a, 1.5f);
+		char hField[8];
+		if (i % 20 == 7) strcpy(hField, "     ");
+		else snprintf(hField, sizeof(hField), "%5.2f", h);
+		int length = snprintf(line, sizeof(line), "%07d %5s  0.15 K239D %9.5f  %9.5f  %9.5f  %9.5f  %9.7f %11.8f %11.7f  0 MPO000000  1234  10 1993-2023 0.60 M-v 3Ek MPCLINUX   0000      (%d) Test             20230913",
+			i + 1, hField, m, randomRange(0.f, 360.f), randomRange(0.f, 360.f), randomRange(0.f, 30.f), e, n, a, i + 1);
+		if (i % 10000 == 9999) length = 60;
+		text.append(line, length);
+		text += "\n";
+		if (length < 103) continue;
+
+		CatalogTestBody body;
+		body.a = strtod(line + 92, NULL);
+		body.h = i % 20 == 7 ? NAN : strtod(line + 8, NULL);
+		body.e = strtod(line + 70, NULL);
+		body.m = strtod(line + 26, NULL);
+		body.n = strtod(line + 80, NULL);
+		body.number = i + 1;
+		written.push_back(body);
+	}
+}
+
+bool benchmarkCatalogImport(int lineCount)
+{
+	const double minDuration = 1.0;
+	srand(1);
+
+	string text;
+	vector<CatalogTestBody> written;
+	writeCatalogText(lineCount, text, written);
+
+	// main belt bodies brighter than H 18
+	CatalogFilter filter;
+	filter.minSemiMajorAxis = 2.1f;
+	filter.maxSemiMajorAxis = 3.3f;
+	filter.maxMagnitude = 18.f;
+	auto passing = [&filter](const vector<CatalogTestBody>& bodies, vector<int>& indices)
+	{
+		indices.clear();
+		for (int i = 0; i < bodies.size(); i++)
+		{
+			const CatalogTestBody& b = bodies[i];
+			if (b.a >= filter.minSemiMajorAxis && b.a <= filter.maxSemiMajorAxis && b.h <= filter.maxMagnitude) indices.push_back(i);
+		}
+	};
+	vector<int> expected;
+	passing(written, expected);
+
+	// fastest of repeated imports, single threaded and on every hardware thread
+	int threadCount = (int)thread::hardware_concurrency();
+	if (threadCount <= 0) threadCount = 1;
+	JobSystem jobs;
+	MinorBodyCatalog catalog;
+	auto timeImport = [&](JobSystem* importJobs)
+	{
+		double best = 1e30;
+		double start = benchmarkTime();
+		while (benchmarkTime() - start < minDuration)
+		{
+			double importStart = benchmarkTime();
+			catalog.load(text.data(), text.size(), filter, importJobs);
+			best = min(best, benchmarkTime() - importStart);
+		}
+		return best;
+	};
+	double singleTime = timeImport(NULL);
+	jobs.start(threadCount);
+	double parallelTime = timeImport(&jobs);
+	jobs.stop();
+
+	// counts and values of the parallel import against the written fields
+	bool countsOk = catalog.getCount() == (int)expected.size() && catalog.getLineCount() == (int)written.size()
+		&& catalog.getSkippedCount() == lineCount - (int)written.size();
+	int valueErrors = 0;
+	for (int i = 0; countsOk && i < catalog.getCount(); i++)
+	{
+		const CatalogTestBody& b = written[expected[i]];
+		char designation[16];
+		snprintf(designation, sizeof(designation), "%07d", b.number);
+		bool ok = catalog.getSemiMajorAxes()[i] == (float)b.a && catalog.getMagnitudes()[i] == (float)b.h
+			&& catalog.getEccentricities()[i] == (float)b.e && catalog.getMeanAnomalies()[i] == (float)b.m
+			&& catalog.getMeanMotions()[i] == (float)b.n && strcmp(catalog.getDesignation(i), designation) == 0;
+		if (!ok) valueErrors++;
+	}
+
+	// a catalog line of a scene, asteroids between the two planets around their periods
+	const char* catalogPath = "benchmark.mpcorb";
+	string sceneCatalog;
+	vector<CatalogTestBody> sceneWritten;
+	vector<int> sceneExpected;
+	writeCatalogText(20000, sceneCatalog, sceneWritten);
+	passing(sceneWritten, sceneExpected);
+	ofstream(catalogPath, ios::binary).write(sceneCatalog.data(), sceneCatalog.size());
+	stringstream sceneText;
+	sceneText << "mesh sphere sphere.obj\ntexture earth day.jpg clouds.jpg night.jpg\n";
+	sceneText << "constant sun 696340 inf inf 0 0 7.25\nconstant earth 6371 365.25 365.25 0 0 23\n";
+	sceneText << "constant mars 3390 687 668 0 0 25\nconstant jupiter 69911 4331 10476 0 0 3\n";
+	sceneText << "body sun - sun sphere earth static light\nbody earth sun earth sphere earth reference\n";
+	sceneText << "body mars sun mars sphere earth margin=1\nbody jupiter sun jupiter sphere earth margin=1\n";
+	sceneText << "catalog " << catalogPath << " sun sphere earth minA=2.1 maxA=3.3 maxH=18\n";
+	vector<char> binary = SceneCompiler().compile(sceneText, "benchmark");
+	remove(catalogPath);
+	SceneFile scene;
+	scene.load(binary.data(), binary.size());
+	vector<RenderedBody> bodies;
+	vector<BodyConst> constants;
+	SceneGraph graph;
+	OrbitSystem orbits;
+	setupScene(scene, SceneSettings(), bodies, constants, graph, orbits);
+	int sceneCatalogCount = 0;
+	int layoutErrors = 0;
+	for (int i = 0; i < (int)bodies.size(); i++)
+	{
+		if (!bodies[i].periodOrbit) continue;
+		sceneCatalogCount++;
+		if (!(bodies[i].orbitRadius > bodies[2].orbitRadius && bodies[i].orbitRadius < bodies[3].orbitRadius)) layoutErrors++;
+	}
+
+	bool passed = countsOk && valueErrors == 0 && sceneCatalogCount == (int)sceneExpected.size() && layoutErrors == 0;
+	double megabytes = text.size() / (1024.0 * 1024.0);
+	cout << "Catalog Import (" << lineCount << " MPCORB lines, " << (int)megabytes << "MB, " << catalog.getCount()
+		<< " bodies pass a=[2.1,3.3] H<=18)\n";
+	cout << "  1 thread:  " << singleTime * 1000.0 << "ms (" << megabytes / singleTime << "MB/s)\n";
+	cout << "  " << threadCount << " thread" << (threadCount > 1 ? "s: " : ":  ") << parallelTime * 1000.0 << "ms (x"
+		<< singleTime / parallelTime << ")\n";
+	cout << "  counts " << (countsOk ? "ok" : "FAILED") << ", value mismatches: " << valueErrors << ", scene catalog bodies "
+		<< sceneCatalogCount << " (expected " << sceneExpected.size() << "), between mars and jupiter: "
+		<< sceneCatalogCount - layoutErrors << (passed ? "" : " (FAILED)") << "\n";
+	return passed;
+}
+
+bool benchmarkSceneScaling(int maxBodyCount, int threadCount)
+{
+	const double minDuration = 0.5;		// seconds of frames per scene size
+	JobSystem jobs;
+	jobs.start(threadCount);
+	bool passed = true;
+
+	cout << "Scene Scaling (generated scenes, depth 2, 4 moons per planet, " << jobs.getThreadCount() << " threads)\n";
+	char line[160];
+	snprintf(line, sizeof(line), "  %-9s %9s %11s %13s %8s %11s %9s %8s\n", "bodies", "setup ms", "animate ms",
+		"transform ms", "cull ms", "submit ms", "frame ms", "visible");
+	cout << line;
+	for (int bodyCount = 100; bodyCount <= maxBodyCount; bodyCount *= 10)
+	{
+		GeneratorSettings settings;
+		settings.bodyCount = bodyCount;
+		double start = benchmarkTime();
+		vector<char> binary = SceneGenerator().generate(settings);
+		SceneFile file;
+		file.load(binary.data(), binary.size());
+		SyntheticScene* scene = new SyntheticScene();		// large members, keep them off the stack
+		scene->build(file);
+		double setupTime = benchmarkTime() - start;
+
+		// warm up to the steady state capacity, then the frames must not allocate
+		for (int i = 0; i < 3; i++) scene->frame(&jobs);
+		for (int s = 0; s < 4; s++) scene->stageTimes[s] = 0.0;
+		long long allocationStart = getAllocationCount();
+		int frames = 0;
+		start = benchmarkTime();
+		while (frames < 5 || benchmarkTime() - start < minDuration)
+		{
+			scene->frame(&jobs);
+			frames++;
+		}
+		long long allocations = getAllocationCount() - allocationStart;
+		bool ok = allocations == 0 && scene->bodyCount == bodyCount;
+		passed &= ok;
+
+		double* stage = scene->stageTimes;
+		snprintf(line, sizeof(line), "  %-9d %9.2f %11.3f %13.3f %8.3f %11.3f %9.3f %8d", bodyCount, setupTime * 1000.0,
+			stage[0] / frames * 1000.0, stage[1] / frames * 1000.0, stage[2] / frames * 1000.0, stage[3] / frames * 1000.0,
+			(stage[0] + stage[1] + stage[2] + stage[3]) / frames * 1000.0, scene->culler.getVisibleCount());
+		cout << line;
+		if (allocations != 0) cout << " (FAILED, " << allocations << " heap allocations)";
+		cout << "\n";
+		delete scene;
+	}
+	jobs.stop();
+	return passed;
+}
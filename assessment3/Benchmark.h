@@ -0,0 +1,24 @@
+#pragma once
+
+// headless performance measurements ("--benchmark"), results are printed to stdout
+// returns false if a check failed (e.g. the frame update allocated)
+bool runBenchmarks();
+
+// individual benchmarks
+void benchmarkOrbitUpdate(int bodyCount);
+bool benchmarkKeplerSolver(int solveCount);		// simd against a double precision newton solver, error checked
+void benchmarkTransforms(int bodyCount);
+bool benchmarkFrameAllocations(int bodyCount, int frameCount);
+bool benchmarkJobScaling(int bodyCount, int maxThreads = 0);		// 1 to maxThreads (0 = hardware threads)
+bool benchmarkSceneLoad(int bodyCount);
+bool benchmarkSceneSetup(int bodyCount);		// 10% planets, the rest moons of random planets
+bool benchmarkBodyStore(int bodyCount);
+bool benchmarkBvh(int bodyCount);		// refit, culling and queries checked against brute force
+bool benchmarkUpdateScheduler(int bodyCount, int budget);		// scheduled against exact evaluation, error and budget checked
+bool benchmarkNBody(int particleCount);		// barnes hut against direct force sums, accuracy, energy drift and allocations checked
+bool benchmarkEphemeris(int bodyCount);		// generated spk kernel against the orbits it was fit to, error and allocations checked
+bool benchmarkCatalogImport(int lineCount);		// generated MPCORB text, 1 thread against all, filtered counts, values and scene layout checked
+
+// generated scenes from 100 to maxBodyCount bodies ("--benchmark-scaling"), setup and the cost of
+// every frame stage (animate, transform, cull, submit) per size, fails if a frame allocates
+bool benchmarkSceneScaling(int maxBodyCount, int threadCount = 0);
@@ -0,0 +1,66 @@
+#include "BodyStore.h"
+
+// bytes per row of every component column
+static const size_t componentSize[COMPONENT_COUNT] =
+{
+	sizeof(OrbitComponent),
+	sizeof(BoundsComponent),
+	sizeof(InstanceComponent),
+	sizeof(PacketComponent),
+	sizeof(GpuComponent)
+};
+
+BodyArchetype::BodyArchetype(uint32_t mask)
+{
+	this->mask = mask;
+}
+
+uint32_t BodyArchetype::getMask() { return mask; }
+int BodyArchetype::getCount() { return (int)bodies.size(); }
+const int* BodyArchetype::getBodies() { return bodies.data(); }
+
+int BodyArchetype::addRow(int body)
+{
+	int row = (int)bodies.size();
+	bodies.push_back(body);
+	for (int c = 0; c < COMPONENT_COUNT; c++)
+	{
+		if (mask & BodyStore::maskOf(c)) columns[c].resize((row + 1) * componentSize[c], 0);
+	}
+	return row;
+}
+
+int BodyStore::addBody(uint32_t mask)
+{
+	Location location;
+	location.archetype = findArchetype(mask);
+	location.row = archetypes[location.archetype].addRow((int)locations.size());
+	locations.push_back(location);
+	return (int)locations.size() - 1;
+}
+
+void BodyStore::clear()
+{
+	archetypes.clear();
+	locations.clear();
+}
+
+int BodyStore::getBodyCount() { return (int)locations.size(); }
+
+bool BodyStore::has(int body, int component)
+{
+	return (archetypes[locations[body].archetype].getMask() & maskOf(component)) != 0;
+}
+
+int BodyStore::getArchetypeCount() { return (int)archetypes.size(); }
+BodyArchetype& BodyStore::getArchetype(int idx) { return archetypes[idx]; }
+
+int BodyStore::findArchetype(uint32_t mask)
+{
+	for (int a = 0; a < archetypes.size(); a++)
+	{
+		if (archetypes[a].getMask() == mask) return a;
+	}
+	archetypes.push_back(BodyArchetype(mask));
+	return (int)archetypes.size() - 1;
+}
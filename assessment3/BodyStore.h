@@ -0,0 +1,139 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+// body components, a body has any combination of them and every archetype (set of components)
+// keeps one contiguous array per component, so a system only streams through the columns it uses
+// new body kinds are new combinations (or a new component) instead of wider structs
+
+// orbit animated body, position and spin come from the orbit system
+struct OrbitComponent
+{
+	int animatorIdx;
+};
+
+// bounding sphere of the scaled mesh for culling
+struct BoundsComponent
+{
+	float radius;
+};
+
+// drawn through the instance batcher
+struct InstanceComponent
+{
+	int batchIdx;
+	int textureLayer;
+	int flags;				// InstanceBatcher::FLAG_*
+};
+
+// drawn with its own packet and program (earth's day, cloud and night shader)
+struct PacketComponent
+{
+	int VAOIdx;
+	int textureIdx;
+	bool transparent;
+};
+
+// culled and drawn by the gpu
+struct GpuComponent
+{
+	int objectIdx;
+};
+
+enum BodyComponent
+{
+	COMPONENT_ORBIT,
+	COMPONENT_BOUNDS,
+	COMPONENT_INSTANCE,
+	COMPONENT_PACKET,
+	COMPONENT_GPU,
+	COMPONENT_COUNT
+};
+
+// component id of a component struct
+template<typename T> struct ComponentOf;
+template<> struct ComponentOf<OrbitComponent> { static const int id = COMPONENT_ORBIT; };
+template<> struct ComponentOf<BoundsComponent> { static const int id = COMPONENT_BOUNDS; };
+template<> struct ComponentOf<InstanceComponent> { static const int id = COMPONENT_INSTANCE; };
+template<> struct ComponentOf<PacketComponent> { static const int id = COMPONENT_PACKET; };
+template<> struct ComponentOf<GpuComponent> { static const int id = COMPONENT_GPU; };
+
+// all bodies with the same set of components, one row per body
+class BodyArchetype
+{
+public:
+
+	BodyArchetype(uint32_t mask);
+
+	uint32_t getMask();
+	int getCount();
+
+	// body index of every row
+	const int* getBodies();
+
+	// column of a component, only valid if the archetype has it
+	template<typename T>
+	T* column() { return (T*)columns[ComponentOf<T>::id].data(); }
+
+private:
+
+	friend class BodyStore;
+
+	uint32_t mask;
+	std::vector<int> bodies;
+	std::vector<char> columns[COMPONENT_COUNT];		// raw rows, empty for missing components
+
+	int addRow(int body);
+};
+
+// archetype storage of every body, bodies are numbered in the order they are added so the index
+// matches the scene graph, culler and RenderedBody index
+class BodyStore
+{
+public:
+
+	static uint32_t maskOf(int component) { return 1u << component; }
+
+	// add a body with a set of components (zero initialized), returns its index
+	int addBody(uint32_t mask);
+	void clear();
+
+	int getBodyCount();
+	bool has(int body, int component);
+
+	// component of a body, only valid if the body has it
+	template<typename T>
+	T& get(int body)
+	{
+		Location& location = locations[body];
+		return archetypes[location.archetype].column<T>()[location.row];
+	}
+
+	int getArchetypeCount();
+	BodyArchetype& getArchetype(int idx);
+
+	// function(archetype) for every archetype that has all components of mask
+	template<typename Function>
+	void forEach(uint32_t mask, const Function& function)
+	{
+		for (int a = 0; a < archetypes.size(); a++)
+		{
+			if ((archetypes[a].getMask() & mask) == mask && archetypes[a].getCount() > 0) function(archetypes[a]);
+		}
+	}
+
+private:
+
+	struct Location
+	{
+		int archetype;
+		int row;
+	};
+
+	std::vector<BodyArchetype> archetypes;
+	std::vector<Location> locations;		// indexed by body
+
+	int findArchetype(uint32_t mask);
+};
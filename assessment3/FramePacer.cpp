@@ -0,0 +1,172 @@
+#include "FramePacer.h"
+
+// before glad so APIENTRY comes from windows.h
+#ifdef _WIN32
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <chrono>
+#include <math.h>
+#include <thread>
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+	if (timerPeriodRaised) timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::init(PacingMode mode, float targetFPS)
+{
+#ifdef _WIN32
+	// default scheduler tick is ~15.6ms, ask for 1ms so sleeping is usable for pacing
+	if (!timerPeriodRaised) timerPeriodRaised = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+	setTargetFPS(targetFPS);
+	setMode(mode);
+	lastFrameStart = glfwGetTime();
+	nextDeadline = lastFrameStart;
+}
+
+void FramePacer::setMode(PacingMode newMode)
+{
+	mode = newMode;
+	switch (mode)
+	{
+	case PacingMode::VSYNC:
+		glfwSwapInterval(1);
+		break;
+	case PacingMode::ADAPTIVE_VSYNC:
+		if (glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+		{
+			glfwSwapInterval(-1);
+		}
+		else
+		{
+			glfwSwapInterval(1);
+		}
+		break;
+	case PacingMode::CAPPED:
+	case PacingMode::UNCAPPED:
+		glfwSwapInterval(0);
+		break;
+	}
+	nextDeadline = glfwGetTime();
+	resetStats();
+}
+
+PacingMode FramePacer::getMode()
+{
+	return mode;
+}
+
+const char* FramePacer::getModeName()
+{
+	switch (mode)
+	{
+	case PacingMode::CAPPED: return "Capped";
+	case PacingMode::VSYNC: return "VSync";
+	case PacingMode::ADAPTIVE_VSYNC: return "Adaptive VSync";
+	case PacingMode::UNCAPPED: return "Uncapped";
+	}
+	return "";
+}
+
+void FramePacer::cycleMode()
+{
+	setMode((PacingMode)(((int)mode + 1) % 4));
+}
+
+void FramePacer::setTargetFPS(float fps)
+{
+	period = 1.0 / fps;
+}
+
+void FramePacer::waitForNextFrame()
+{
+	if (mode == PacingMode::CAPPED)
+	{
+		nextDeadline += period;
+		double now = glfwGetTime();
+
+		// more than a frame behind (e.g. window dragged), restart schedule instead of bursting
+		if (now - nextDeadline > period) nextDeadline = now;
+		else preciseSleepUntil(nextDeadline);
+	}
+
+	double frameStart = glfwGetTime();
+	recordFrame(frameStart - lastFrameStart);
+	lastFrameStart = frameStart;
+}
+
+void FramePacer::resync()
+{
+	lastFrameStart = glfwGetTime();
+	nextDeadline = lastFrameStart;
+}
+
+void FramePacer::preciseSleepUntil(double deadline)
+{
+	// sleep in 1ms requests while the worst expected oversleep still fits
+	double now = glfwGetTime();
+	while (deadline - now > sleepEstimate)
+	{
+		double start = now;
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		now = glfwGetTime();
+
+		double observed = now - start;
+		sleepCount++;
+		double delta = observed - sleepMean;
+		sleepMean += delta / sleepCount;
+		sleepM2 += delta * (observed - sleepMean);
+		sleepEstimate = sleepMean + sqrt(sleepM2 / (sleepCount - 1));
+	}
+
+	// spin the rest
+	while (glfwGetTime() < deadline)
+	{
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::recordFrame(double interval)
+{
+	double ms = interval * 1000.0;
+	frameCount++;
+	double delta = ms - frameMean;
+	frameMean += delta / frameCount;
+	frameM2 += delta * (ms - frameMean);
+	if (ms > frameMax) frameMax = ms;
+}
+
+int FramePacer::getFrameCount()
+{
+	return frameCount;
+}
+
+double FramePacer::getAverageFrameTime()
+{
+	return frameMean;
+}
+
+double FramePacer::getFrameTimeJitter()
+{
+	return frameCount > 1 ? sqrt(frameM2 / (frameCount - 1)) : 0.0;
+}
+
+double FramePacer::getMaxFrameTime()
+{
+	return frameMax;
+}
+
+void FramePacer::resetStats()
+{
+	frameCount = 0;
+	frameMean = 0.0;
+	frameM2 = 0.0;
+	frameMax = 0.0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+enum class PacingMode
+{
+	CAPPED,				// sleep until the next 1 / targetFPS deadline, no vsync
+	VSYNC,				// swap interval 1
+	ADAPTIVE_VSYNC,		// swap interval -1, tears instead of halving fps when late (falls back to vsync)
+	UNCAPPED,			// swap interval 0, no waiting
+};
+
+// decides when the next frame starts
+// capped mode sleeps most of the remaining frame time and only spins for the last
+// part, the spin window is estimated from how long the os actually sleeps
+class FramePacer
+{
+public:
+
+	~FramePacer();
+
+	void init(PacingMode mode, float targetFPS);
+
+	// apply swap interval of mode (needs current context)
+	void setMode(PacingMode mode);
+	PacingMode getMode();
+	const char* getModeName();
+
+	// capped -> vsync -> adaptive vsync -> uncapped -> capped
+	void cycleMode();
+
+	void setTargetFPS(float fps);
+
+	// block until the next frame should start (only capped mode waits here, vsync
+	// modes wait in glfwSwapBuffers), call once at the start of every frame
+	void waitForNextFrame();
+
+	// restart the schedule after the loop was idle (on demand rendering) so the idle
+	// gap neither triggers catch up frames nor counts as a frame interval
+	void resync();
+
+	// frame interval statistics since last resetStats, in milliseconds
+	int getFrameCount();
+	double getAverageFrameTime();
+	double getFrameTimeJitter();	// standard deviation of frame intervals
+	double getMaxFrameTime();
+	void resetStats();
+
+private:
+
+	PacingMode mode = PacingMode::CAPPED;
+	double period = 1.0 / 144.0;
+	double nextDeadline = 0.0;
+	double lastFrameStart = 0.0;
+	bool timerPeriodRaised = false;		// 1ms os timer period requested by init, released by the destructor
+
+	// running estimate of a 1ms sleep request (Welford)
+	double sleepEstimate = 0.005;
+	double sleepMean = 0.005;
+	double sleepM2 = 0.0;
+	long long sleepCount = 1;
+
+	// frame interval statistics (Welford)
+	int frameCount = 0;
+	double frameMean = 0.0;
+	double frameM2 = 0.0;
+	double frameMax = 0.0;
+
+	void preciseSleepUntil(double deadline);
+	void recordFrame(double interval);
+};
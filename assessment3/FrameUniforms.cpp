@@ -0,0 +1,69 @@
+#include "FrameUniforms.h"
+#include <string.h>
+
+static_assert(sizeof(LightingStd140) == 80, "LightingStd140 must match std140 layout");
+static_assert(sizeof(CameraBlock) == 144, "CameraBlock must match std140 layout");
+static_assert(sizeof(LightsBlock) == 176, "LightsBlock must match std140 layout");
+
+void FrameUniforms::init()
+{
+	// bound ranges must start at a multiple of this
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+
+	lightsBlock = LightsBlock{};
+
+	// sun
+	LightingStd140& sun = lightsBlock.light[0];
+	sun.color = glm::vec3(1.f, 1.f, 1.f);
+	sun.ambientStrength = 0.15f;
+	sun.specularStrength = 0.3f;
+	sun.shininess = 16.f;
+	sun.constant = 1.0f;
+	sun.linear = 0.000000014f;
+	sun.quadratic = 0.00000000007f;
+
+	// player torch
+	LightingStd140& torch = lightsBlock.light[1];
+	torch.color = glm::vec3(1.f, 1.f, 1.f);
+	torch.ambientStrength = 0.f;
+	torch.specularStrength = 0.3f;
+	torch.shininess = 16.f;
+	torch.constant = 1.0f;
+	torch.linear = 0.0000005f;
+	torch.quadratic = 0.000000015f;
+	torch.phi = 25.f;
+	torch.gamma = 35.f;
+}
+
+void FrameUniforms::bindProgram(unsigned int shaderProgram)
+{
+	// a program may not use every block (e.g. the sky shader has no lighting)
+	unsigned int cameraIdx = glGetUniformBlockIndex(shaderProgram, "Camera");
+	if (cameraIdx != GL_INVALID_INDEX) glUniformBlockBinding(shaderProgram, cameraIdx, CAMERA_BINDING);
+
+	unsigned int lightsIdx = glGetUniformBlockIndex(shaderProgram, "Lights");
+	if (lightsIdx != GL_INVALID_INDEX) glUniformBlockBinding(shaderProgram, lightsIdx, LIGHTS_BINDING);
+}
+
+void FrameUniforms::update(const glm::mat4& view, const glm::mat4& projection, GeneralCamera& cam, const glm::vec3& lightPos, bool torch,
+	StreamBuffer& stream)
+{
+	glm::vec3 camPos = cam.getPosition();
+
+	cameraBlock.view = view;
+	cameraBlock.projection = projection;
+	cameraBlock.camPos = glm::vec4(camPos, 1.f);
+
+	lightsBlock.light[0].position = lightPos;
+	lightsBlock.light[1].position = camPos;
+	lightsBlock.light[1].direction = cam.getFront();
+	lightsBlock.torchLight = torch;
+
+	StreamAllocation camera = stream.allocate(sizeof(CameraBlock), uniformAlignment);
+	memcpy(camera.data, &cameraBlock, sizeof(CameraBlock));
+	glBindBufferRange(GL_UNIFORM_BUFFER, CAMERA_BINDING, camera.buffer, camera.offset, camera.size);
+
+	StreamAllocation lights = stream.allocate(sizeof(LightsBlock), uniformAlignment);
+	memcpy(lights.data, &lightsBlock, sizeof(LightsBlock));
+	glBindBufferRange(GL_UNIFORM_BUFFER, LIGHTS_BINDING, lights.buffer, lights.offset, lights.size);
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include "GeneralCamera.h"
+#include "StreamBuffer.h"
+
+// std140 mirror of "Lighting" struct declared in the shaders
+// vec3 followed by a float is packed into a single 16 byte slot
+struct LightingStd140
+{
+	glm::vec3 position;
+	float ambientStrength;
+	glm::vec3 direction;
+	float specularStrength;
+	glm::vec3 color;
+	float shininess;
+
+	// attenuation
+	float constant;
+	float linear;
+	float quadratic;
+
+	// spot light
+	float phi;		// inner cone
+	float gamma;	// outer cone
+	float padding[3];
+};
+
+// std140 mirror of "Camera" uniform block
+struct CameraBlock
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec4 camPos;
+};
+
+// std140 mirror of "Lights" uniform block
+struct LightsBlock
+{
+	LightingStd140 light[2];
+	int torchLight;
+	int padding[3];
+};
+
+// per frame camera and lighting data shared by every lit shader program
+// written once per frame into the frame stream buffer, bound as ranges to fixed binding points
+class FrameUniforms
+{
+public:
+
+	static const unsigned int CAMERA_BINDING = 0;
+	static const unsigned int LIGHTS_BINDING = 1;
+
+	// set light constants
+	void init();
+
+	// link program uniform blocks to the fixed binding points (call once per program)
+	void bindProgram(unsigned int shaderProgram);
+
+	// write camera and light data of the current frame into stream and bind it
+	void update(const glm::mat4& view, const glm::mat4& projection, GeneralCamera& cam, const glm::vec3& lightPos, bool torch,
+		StreamBuffer& stream);
+
+private:
+	int uniformAlignment = 256;
+	CameraBlock cameraBlock;
+	LightsBlock lightsBlock;
+};
@@ -0,0 +1,133 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+#include "SphereBvh.h"
+#include <emmintrin.h>
+#include <math.h>
+
+void FrustumCuller::setFrustum(const glm::mat4& projection, const glm::mat4& view)
+{
+	// gribb / hartmann, planes are sums and differences of the rows of the clip matrix
+	// glm is column major, m[column][row]
+	glm::mat4 m = projection * view;
+	glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[0] = row3 + row0;	// left
+	planes[1] = row3 - row0;	// right
+	planes[2] = row3 + row1;	// bottom
+	planes[3] = row3 - row1;	// top
+	planes[4] = row3 + row2;	// near
+	planes[5] = row3 - row2;	// far
+
+	// normalise so plane distance can be compared with sphere radius
+	for (int i = 0; i < 6; i++)
+	{
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+	}
+}
+
+const glm::vec4* FrustumCuller::getPlanes()
+{
+	return planes;
+}
+
+void FrustumCuller::resize(int count)
+{
+	this->count = count;
+	int padded = (count + 3) & ~3;
+	centerX.assign(padded, 0.f);
+	centerY.assign(padded, 0.f);
+	centerZ.assign(padded, 0.f);
+	radius.assign(padded, 0.f);
+	visible.assign(count, 1);
+	visibleCount = count;
+}
+
+void FrustumCuller::setSphere(int index, const glm::vec3& center, float radius)
+{
+	centerX[index] = center.x;
+	centerY[index] = center.y;
+	centerZ[index] = center.z;
+	this->radius[index] = radius;
+}
+
+int FrustumCuller::cull(JobSystem* jobs)
+{
+	if (jobs == NULL)
+	{
+		visibleCount = cullRange(0, count);
+		return visibleCount;
+	}
+
+	// ranges start on separate cache lines of the visible flags
+	std::atomic<int> visibleSum{ 0 };
+	jobs->parallelFor(count, 4096, 64, [this, &visibleSum](int begin, int end)
+	{
+		visibleSum.fetch_add(cullRange(begin, end), std::memory_order_relaxed);
+	});
+	visibleCount = visibleSum.load();
+	return visibleCount;
+}
+
+int FrustumCuller::cull(SphereBvh& bvh, JobSystem* jobs)
+{
+	visibleCount = bvh.cullFrustum(planes, visible.data(), jobs);
+	return visibleCount;
+}
+
+int FrustumCuller::cullRange(int begin, int end)
+{
+	int visibleInRange = 0;
+
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128 cx = _mm_loadu_ps(&centerX[i]);
+		__m128 cy = _mm_loadu_ps(&centerY[i]);
+		__m128 cz = _mm_loadu_ps(&centerZ[i]);
+		__m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&radius[i]));
+
+		// lane stays set while the sphere is not completely behind any plane
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 d = _mm_set1_ps(planes[p].w);
+			d = _mm_add_ps(d, _mm_mul_ps(cx, _mm_set1_ps(planes[p].x)));
+			d = _mm_add_ps(d, _mm_mul_ps(cy, _mm_set1_ps(planes[p].y)));
+			d = _mm_add_ps(d, _mm_mul_ps(cz, _mm_set1_ps(planes[p].z)));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(d, negRadius));
+		}
+
+		int mask = _mm_movemask_ps(inside);
+		int lanes = end - i < 4 ? end - i : 4;
+		for (int j = 0; j < lanes; j++)
+		{
+			visible[i + j] = (mask >> j) & 1;
+			visibleInRange += visible[i + j];
+		}
+	}
+
+	return visibleInRange;
+}
+
+bool FrustumCuller::isVisible(int index)
+{
+	return visible[index] != 0;
+}
+
+int FrustumCuller::getVisibleCount()
+{
+	return visibleCount;
+}
+
+float FrustumCuller::computeMeshRadius(const std::vector<float>& vertices, int stride)
+{
+	float maxSquared = 0.f;
+	for (size_t i = 0; i + 2 < vertices.size(); i += stride)
+	{
+		float squared = vertices[i] * vertices[i] + vertices[i + 1] * vertices[i + 1] + vertices[i + 2] * vertices[i + 2];
+		if (squared > maxSquared) maxSquared = squared;
+	}
+	return sqrtf(maxSquared);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+class SphereBvh;
+
+// view frustum culling of bounding spheres
+// spheres are stored as structure of arrays and tested 4 at a time with SSE
+class FrustumCuller
+{
+public:
+
+	// extract the 6 normalised frustum planes from projection * view
+	void setFrustum(const glm::mat4& projection, const glm::mat4& view);
+
+	// planes of last setFrustum (left, right, bottom, top, near, far)
+	const glm::vec4* getPlanes();
+
+	// number of spheres tested by cull()
+	void resize(int count);
+	void setSphere(int index, const glm::vec3& center, float radius);
+
+	// test every sphere against all planes, returns number of visible spheres
+	// ranges of spheres are tested in parallel if a job system is given
+	int cull(JobSystem* jobs = NULL);
+
+	// same result for the spheres of a bvh (sized like resize), subtrees are accepted or
+	// rejected at once instead of testing every sphere
+	int cull(SphereBvh& bvh, JobSystem* jobs = NULL);
+
+	bool isVisible(int index);
+	int getVisibleCount();
+
+	// radius of the smallest origin centered sphere enclosing all vertex positions
+	// (position must be the first 3 floats of every vertex)
+	static float computeMeshRadius(const std::vector<float>& vertices, int stride);
+
+private:
+
+	// plane equation a*x + b*y + c*z + d, normal points inside
+	glm::vec4 planes[6];
+
+	// bounding spheres padded to multiple of 4
+	int count = 0;
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	std::vector<unsigned char> visible;
+	int visibleCount = 0;
+
+	// test [begin,end), begin is a multiple of 4, returns visible spheres in range
+	int cullRange(int begin, int end);
+};
@@ -0,0 +1,44 @@
+#include "GLExtensions.h"
+#include <string.h>
+
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = NULL;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = NULL;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = NULL;
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = NULL;
+
+bool loadGLExtensions(GLADloadproc load)
+{
+	// some drivers hand out pointers for unsupported functions, check version first
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	if (major < 4 || (major == 4 && minor < 3)) return false;
+
+	glext_glDispatchCompute = (PFNGLDISPATCHCOMPUTEPROC)load("glDispatchCompute");
+	glext_glMemoryBarrier = (PFNGLMEMORYBARRIERPROC)load("glMemoryBarrier");
+	glext_glMultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+
+	return glext_glDispatchCompute != NULL
+		&& glext_glMemoryBarrier != NULL
+		&& glext_glMultiDrawElementsIndirect != NULL;
+}
+
+bool loadBufferStorage(GLADloadproc load)
+{
+	GLint major = 0, minor = 0;
+	glGetIntegerv(GL_MAJOR_VERSION, &major);
+	glGetIntegerv(GL_MINOR_VERSION, &minor);
+	bool supported = major > 4 || (major == 4 && minor >= 4);
+
+	GLint extensionCount = 0;
+	glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+	for (int i = 0; i < extensionCount && !supported; i++)
+	{
+		const char* name = (const char*)glGetStringi(GL_EXTENSIONS, i);
+		supported = strcmp(name, "GL_ARB_buffer_storage") == 0;
+	}
+	if (!supported) return false;
+
+	glext_glBufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+	return glext_glBufferStorage != NULL;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <glad/glad.h>
+
+// the bundled glad only loads OpenGL 3.3 core, entry points and enums of newer
+// versions used by the optional GPU driven path are loaded here at runtime
+
+// enums
+#define GL_COMPUTE_SHADER					0x91B9
+#define GL_SHADER_STORAGE_BUFFER			0x90D2
+#define GL_DRAW_INDIRECT_BUFFER				0x8F3F
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT	0x00000001
+#define GL_SHADER_STORAGE_BARRIER_BIT		0x00002000
+#define GL_COMMAND_BARRIER_BIT				0x00000040
+#define GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT	0x90DF
+#define GL_MAP_PERSISTENT_BIT				0x0040
+#define GL_MAP_COHERENT_BIT					0x0080
+
+// function types
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+
+// function pointers
+extern PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute;
+extern PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier;
+extern PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect;
+extern PFNGLBUFFERSTORAGEPROC glext_glBufferStorage;
+
+#define glDispatchCompute glext_glDispatchCompute
+#define glMemoryBarrier glext_glMemoryBarrier
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+#define glBufferStorage glext_glBufferStorage
+
+// load entry points of the current context (call after gladLoadGLLoader)
+// returns true if the context is OpenGL 4.3 or above and every function was found
+bool loadGLExtensions(GLADloadproc load);
+
+// immutable buffer storage for persistent mapping, core in OpenGL 4.4 and also
+// exposed by GL_ARB_buffer_storage on most 3.3 drivers
+bool loadBufferStorage(GLADloadproc load);
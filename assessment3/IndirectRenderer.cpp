@@ -0,0 +1,209 @@
+#include "IndirectRenderer.h"
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <string>
+#include <string.h>
+#include <unordered_map>
+
+int IndirectRenderer::addMesh(const std::vector<float>& meshVertices)
+{
+	const int stride = 8;
+
+	Mesh mesh;
+	mesh.firstIndex = (GLuint)indices.size();
+	mesh.baseVertex = (GLint)(vertices.size() / stride);
+
+	// identical vertices (all 8 floats) share one index
+	std::unordered_map<std::string, GLuint> unique;
+	GLuint vertexCount = 0;
+	for (size_t i = 0; i + stride <= meshVertices.size(); i += stride)
+	{
+		std::string key((const char*)&meshVertices[i], stride * sizeof(float));
+		auto found = unique.find(key);
+		if (found != unique.end())
+		{
+			indices.push_back(found->second);
+			continue;
+		}
+		unique[key] = vertexCount;
+		indices.push_back(vertexCount);
+		vertices.insert(vertices.end(), meshVertices.begin() + i, meshVertices.begin() + i + stride);
+		vertexCount++;
+	}
+
+	mesh.indexCount = (GLuint)indices.size() - mesh.firstIndex;
+	meshes.push_back(mesh);
+	return (int)meshes.size() - 1;
+}
+
+int IndirectRenderer::addObject(int meshIdx, float boundingRadius, int textureArrayIdx, int textureLayer, int flags)
+{
+	IndirectObject object;
+	object.bounds = glm::vec4(0.f, 0.f, 0.f, boundingRadius);
+	object.info = glm::ivec4(meshIdx, textureLayer, flags, textureArrayIdx);
+	objects.push_back(object);
+	transforms.push_back(glm::mat4(1.f));
+	return (int)objects.size() - 1;
+}
+
+void IndirectRenderer::build(unsigned int cullProgram, unsigned int drawProgram, const std::vector<unsigned int>& textureArrays)
+{
+	this->cullProgram = cullProgram;
+	this->drawProgram = drawProgram;
+	this->textureArrays = textureArrays;
+	planesLocation = glGetUniformLocation(cullProgram, "planes");
+	objectCountLocation = glGetUniformLocation(cullProgram, "objectCount");
+	glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+
+	// one command per used texture array and mesh pair, sorted by array so every array draws
+	// a contiguous range, objects are grouped by command in the visible buffer and each command
+	// owns the range [baseInstance, baseInstance + its objects)
+	int pairCount = (int)(textureArrays.size() * meshes.size());
+	std::vector<GLuint> pairObjectCount(pairCount, 0);
+	for (int i = 0; i < objects.size(); i++)
+	{
+		pairObjectCount[objects[i].info.w * meshes.size() + objects[i].info.x]++;
+	}
+	std::vector<int> pairCommand(pairCount, -1);
+	commandTemplate.clear();
+	arrayFirstCommand.assign(1, 0);
+	GLuint baseInstance = 0;
+	for (int pair = 0; pair < pairCount; pair++)
+	{
+		int mesh = pair % (int)meshes.size();
+		if (pairObjectCount[pair] > 0)
+		{
+			pairCommand[pair] = (int)commandTemplate.size();
+			DrawElementsIndirectCommand command;
+			command.count = meshes[mesh].indexCount;
+			command.instanceCount = 0;
+			command.firstIndex = meshes[mesh].firstIndex;
+			command.baseVertex = meshes[mesh].baseVertex;
+			command.baseInstance = baseInstance;
+			commandTemplate.push_back(command);
+			baseInstance += pairObjectCount[pair];
+		}
+		if (mesh == meshes.size() - 1) arrayFirstCommand.push_back((int)commandTemplate.size());
+	}
+
+	// the cull shader appends objects to their command
+	for (int i = 0; i < objects.size(); i++)
+	{
+		objects[i].info.x = pairCommand[objects[i].info.w * meshes.size() + objects[i].info.x];
+	}
+
+	// shared mesh buffers
+	glGenVertexArrays(1, &VAO);
+	glBindVertexArray(VAO);
+
+	glGenBuffers(1, &VBO);
+	glBindBuffer(GL_ARRAY_BUFFER, VBO);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(5 * sizeof(float)));
+
+	glGenBuffers(1, &EBO);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+
+	// visible object index per instance, instanced attributes honour baseInstance
+	// so every command reads its own range (gl_InstanceID would restart at 0)
+	glGenBuffers(1, &visibleBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, visibleBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (objects.size() + 1) * sizeof(GLuint), NULL, GL_DYNAMIC_COPY);
+	glEnableVertexAttribArray(3);
+	glVertexAttribIPointer(3, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+	glVertexAttribDivisor(3, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// static shader storage, transforms and commands are streamed every frame
+	glGenBuffers(1, &objectSSBO);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, objectSSBO);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, (objects.size() + 1) * sizeof(IndirectObject), objects.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// mesh data is on the gpu now
+	vertices.clear();
+	vertices.shrink_to_fit();
+	indices.clear();
+	indices.shrink_to_fit();
+}
+
+void IndirectRenderer::setTransform(int objectIdx, const glm::mat4& model)
+{
+	transforms[objectIdx] = model;
+}
+
+void IndirectRenderer::upload(StreamBuffer& stream)
+{
+	if (objects.empty()) return;
+
+	transformRange = stream.allocate(transforms.size() * sizeof(glm::mat4), storageAlignment);
+	memcpy(transformRange.data, transforms.data(), transformRange.size);
+
+	// commands with zero instances, the cull pass counts them up
+	commandRange = stream.allocate(commandTemplate.size() * sizeof(DrawElementsIndirectCommand), storageAlignment);
+	memcpy(commandRange.data, commandTemplate.data(), commandRange.size);
+}
+
+void IndirectRenderer::draw(const glm::vec4* planes)
+{
+	if (objects.empty()) return;
+
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, TRANSFORMS_BINDING, transformRange.buffer, transformRange.offset, transformRange.size);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, OBJECTS_BINDING, objectSSBO);
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, COMMANDS_BINDING, commandRange.buffer, commandRange.offset, commandRange.size);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBLE_BINDING, visibleBuffer);
+
+	// cull pass, one invocation per object
+	glUseProgram(cullProgram);
+	glUniform4fv(planesLocation, 6, glm::value_ptr(planes[0]));
+	glUniform1ui(objectCountLocation, (GLuint)objects.size());
+	glDispatchCompute(((GLuint)objects.size() + 63) / 64, 1, 1);
+
+	// commands and visible indices are read as indirect and vertex data
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+
+	// draw pass, one multi draw per texture array
+	glUseProgram(drawProgram);
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandRange.buffer);
+	for (int a = 0; a < textureArrays.size(); a++)
+	{
+		int first = arrayFirstCommand[a];
+		int count = arrayFirstCommand[a + 1] - first;
+		if (count == 0) continue;
+
+		glBindTexture(GL_TEXTURE_2D_ARRAY, textureArrays[a]);
+		size_t offset = commandRange.offset + first * sizeof(DrawElementsIndirectCommand);
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, count, 0);
+	}
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+}
+
+int IndirectRenderer::getObjectCount()
+{
+	return (int)objects.size();
+}
+
+int IndirectRenderer::getMeshCount()
+{
+	return (int)meshes.size();
+}
+
+int IndirectRenderer::getMultiDrawCount()
+{
+	int count = 0;
+	for (int a = 0; a + 1 < arrayFirstCommand.size(); a++)
+	{
+		if (arrayFirstCommand[a + 1] > arrayFirstCommand[a]) count++;
+	}
+	return count;
+}
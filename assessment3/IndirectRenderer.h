@@ -0,0 +1,102 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include "GLExtensions.h"
+#include "StreamBuffer.h"
+
+// per object data read by the cull and draw shaders (std430, binding 1)
+struct IndirectObject
+{
+	glm::vec4 bounds;	// xyz: local sphere center, w: local sphere radius
+	glm::ivec4 info;	// x: draw command index, y: texture layer, z: flags, w: texture array index
+};
+static_assert(sizeof(IndirectObject) == 32, "IndirectObject must match std430 layout");
+
+// matches the layout expected by glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// GPU driven rendering (OpenGL 4.3)
+// every mesh lives in one shared vertex and index buffer, a compute shader culls the
+// objects against the view frustum and fills one indirect command per mesh and texture
+// array, then the commands of each array are drawn by one glMultiDrawElementsIndirect
+class IndirectRenderer
+{
+public:
+
+	// shader flags (same as InstanceBatcher)
+	static const int FLAG_UNLIT = 1;
+
+	// shader storage binding points
+	static const int TRANSFORMS_BINDING = 0;
+	static const int OBJECTS_BINDING = 1;
+	static const int COMMANDS_BINDING = 2;
+	static const int VISIBLE_BINDING = 3;
+
+	// add a mesh from expanded triangle vertices (pos 3, uv 2, normal 3)
+	// duplicated vertices are merged and indexed, returns mesh index
+	int addMesh(const std::vector<float>& vertices);
+
+	// add an object drawn with a mesh and a layer of a texture array (index into the arrays
+	// given to build), returns object index used by setTransform()
+	int addObject(int meshIdx, float boundingRadius, int textureArrayIdx, int textureLayer, int flags);
+
+	// upload meshes and objects, call once after every mesh and object is added
+	void build(unsigned int cullProgram, unsigned int drawProgram, const std::vector<unsigned int>& textureArrays);
+
+	void setTransform(int objectIdx, const glm::mat4& model);
+
+	// write this frame's transforms and reset commands into stream (before stream flush)
+	void upload(StreamBuffer& stream);
+
+	// cull all objects on the gpu against the given 6 planes and draw the visible ones
+	void draw(const glm::vec4* planes);
+
+	int getObjectCount();
+	int getMeshCount();
+	int getMultiDrawCount();		// texture arrays with objects, one multi draw each
+
+private:
+
+	struct Mesh
+	{
+		GLuint firstIndex;
+		GLuint indexCount;
+		GLint baseVertex;
+	};
+
+	// cpu side data
+	std::vector<float> vertices;
+	std::vector<GLuint> indices;
+	std::vector<Mesh> meshes;
+	std::vector<IndirectObject> objects;
+	std::vector<glm::mat4> transforms;
+	std::vector<DrawElementsIndirectCommand> commandTemplate;	// instanceCount 0, reset every frame
+	std::vector<int> arrayFirstCommand;							// commands sorted by texture array, + end
+
+	// gl objects
+	unsigned int VAO = 0;
+	unsigned int VBO = 0;
+	unsigned int EBO = 0;
+	unsigned int objectSSBO = 0;
+	unsigned int visibleBuffer = 0;		// visible object indices, also an instanced vertex attribute
+
+	// this frame's stream ranges
+	StreamAllocation transformRange;
+	StreamAllocation commandRange;
+	int storageAlignment = 256;
+
+	unsigned int cullProgram = 0;
+	unsigned int drawProgram = 0;
+	std::vector<unsigned int> textureArrays;
+	int planesLocation = -1;
+	int objectCountLocation = -1;
+};
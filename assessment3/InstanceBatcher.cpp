@@ -0,0 +1,312 @@
+#include "InstanceBatcher.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cstddef>
+
+int InstanceBatcher::addMesh(unsigned int VAO, int vertexCount, const std::vector<GLuint>& textures, bool transparent)
+{
+	std::vector<unsigned int> arrays;
+	Mesh mesh;
+	buildTextureArrays(textures, arrays, mesh.textureBatches, mesh.textureLayers);
+
+	// instance attribute pointers are vertex array state, so every further batch of the mesh reads
+	// the same vertices through a copy of its vertex array
+	int firstBatch = (int)batches.size();
+	for (int i = 0; i < arrays.size(); i++)
+	{
+		MeshBatch batch;
+		batch.VAO = i == 0 ? VAO : copyVertexArray(VAO);
+		batch.vertexCount = vertexCount;
+		batch.transparent = transparent;
+		batch.textureArray = arrays[i];
+		setupInstanceAttributes(batch);
+		batches.push_back(batch);
+	}
+	for (int i = 0; i < mesh.textureBatches.size(); i++)
+	{
+		mesh.textureBatches[i] += firstBatch;
+	}
+
+	meshes.push_back(mesh);
+	return (int)meshes.size() - 1;
+}
+
+int InstanceBatcher::addBatch(unsigned int VAO, int vertexCount, bool transparent)
+{
+	MeshBatch batch;
+	batch.VAO = VAO;
+	batch.vertexCount = vertexCount;
+	batch.transparent = transparent;
+	batches.push_back(batch);
+	return (int)batches.size() - 1;
+}
+
+void InstanceBatcher::getTextureSlot(int meshIdx, int textureIdx, int& batchIdx, int& textureLayer)
+{
+	batchIdx = meshes[meshIdx].textureBatches[textureIdx];
+	textureLayer = meshes[meshIdx].textureLayers[textureIdx];
+}
+
+unsigned int InstanceBatcher::copyVertexArray(unsigned int VAO)
+{
+	// per vertex attributes 0 to 2 (position, uv, normal)
+	struct Attribute
+	{
+		GLint enabled, buffer, size, type, normalized, stride;
+		void* pointer;
+	};
+	Attribute attributes[3];
+	glBindVertexArray(VAO);
+	for (int i = 0; i < 3; i++)
+	{
+		Attribute& a = attributes[i];
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &a.enabled);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &a.buffer);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_SIZE, &a.size);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_TYPE, &a.type);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_NORMALIZED, &a.normalized);
+		glGetVertexAttribiv(i, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &a.stride);
+		glGetVertexAttribPointerv(i, GL_VERTEX_ATTRIB_ARRAY_POINTER, &a.pointer);
+	}
+
+	unsigned int copy;
+	glGenVertexArrays(1, &copy);
+	glBindVertexArray(copy);
+	for (int i = 0; i < 3; i++)
+	{
+		const Attribute& a = attributes[i];
+		if (!a.enabled) continue;
+		glBindBuffer(GL_ARRAY_BUFFER, a.buffer);
+		glVertexAttribPointer(i, a.size, a.type, (GLboolean)a.normalized, a.stride, a.pointer);
+		glEnableVertexAttribArray(i);
+	}
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	return copy;
+}
+
+void InstanceBatcher::setupInstanceAttributes(MeshBatch& batch)
+{
+	glBindVertexArray(batch.VAO);
+
+	// mat4 takes 4 consecutive vec4 attribute slots, then texture layer and flags
+	for (int i = 3; i <= 7; i++)
+	{
+		glEnableVertexAttribArray(i);
+		glVertexAttribDivisor(i, 1);
+	}
+
+	glBindVertexArray(0);
+}
+
+void InstanceBatcher::bindInstanceData(MeshBatch& batch, const StreamAllocation& allocation)
+{
+	glBindVertexArray(batch.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, allocation.buffer);
+
+	for (int i = 0; i < 4; i++)
+	{
+		glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+			(void*)(allocation.offset + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+	}
+
+	// texture layer and flags as integers
+	glVertexAttribIPointer(7, 2, GL_INT, sizeof(InstanceData), (void*)(allocation.offset + offsetof(InstanceData, textureLayer)));
+
+	glBindVertexArray(0);
+}
+
+void InstanceBatcher::buildTextureArrays(const std::vector<GLuint>& textures, std::vector<unsigned int>& arrays,
+	std::vector<int>& arrayOf, std::vector<int>& layerOf, int maxWidth, int maxHeight)
+{
+	// layer size of every texture, halved until it fits the limit
+	std::vector<glm::ivec2> sizes(textures.size());
+	for (int i = 0; i < textures.size(); i++)
+	{
+		int w, h;
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+		while ((maxWidth > 0 && w > maxWidth) || (maxHeight > 0 && h > maxHeight))
+		{
+			w = std::max(w / 2, 1);
+			h = std::max(h / 2, 1);
+		}
+		sizes[i] = glm::ivec2(w, h);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// one array per distinct size, in order of first use
+	arrays.clear();
+	arrayOf.assign(textures.size(), -1);
+	layerOf.assign(textures.size(), 0);
+	std::vector<GLuint> layers;
+	for (int i = 0; i < textures.size(); i++)
+	{
+		if (arrayOf[i] != -1) continue;
+		layers.clear();
+		for (int j = i; j < textures.size(); j++)
+		{
+			if (arrayOf[j] != -1 || sizes[j] != sizes[i]) continue;
+			arrayOf[j] = (int)arrays.size();
+			layerOf[j] = (int)layers.size();
+			layers.push_back(textures[j]);
+		}
+		arrays.push_back(buildTextureArray(layers, sizes[i].x, sizes[i].y));
+	}
+}
+
+unsigned int InstanceBatcher::buildTextureArray(const std::vector<GLuint>& textures, int width, int height)
+{
+	unsigned int textureArray;
+	glGenTextures(1, &textureArray);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+	glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (int)textures.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+	// copy every texture into its layer on the gpu
+	unsigned int readFBO, drawFBO;
+	glGenFramebuffers(1, &readFBO);
+	glGenFramebuffers(1, &drawFBO);
+	for (int i = 0; i < textures.size(); i++)
+	{
+		int w, h;
+		glBindTexture(GL_TEXTURE_2D, textures[i]);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+		glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+		glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textures[i], 0);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFBO);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, textureArray, 0, i);
+		glBlitFramebuffer(0, 0, w, h, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+	}
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteFramebuffers(1, &readFBO);
+	glDeleteFramebuffers(1, &drawFBO);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, textureArray);
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return textureArray;
+}
+
+void InstanceBatcher::reserve(int batchIdx, int instanceCount)
+{
+	batches[batchIdx].instances.reserve(instanceCount);
+}
+
+void InstanceBatcher::begin()
+{
+	for (int i = 0; i < batches.size(); i++)
+	{
+		batches[i].instances.clear();
+	}
+}
+
+void InstanceBatcher::add(int batchIdx, const glm::mat4& model, int textureLayer, int flags, float viewDepth)
+{
+	Instance instance;
+	instance.data.model = model;
+	instance.data.textureLayer = textureLayer;
+	instance.data.flags = flags;
+	instance.viewDepth = viewDepth;
+	batches[batchIdx].instances.push_back(instance);
+}
+
+int InstanceBatcher::getInstanceCount()
+{
+	int count = 0;
+	for (int i = 0; i < batches.size(); i++)
+	{
+		count += (int)batches[i].instances.size();
+	}
+	return count;
+}
+
+void InstanceBatcher::flush(RenderQueue& queue, unsigned int shaderProgram, StreamBuffer& stream, JobSystem* jobs)
+{
+	for (int i = 0; i < batches.size(); i++)
+	{
+		MeshBatch& batch = batches[i];
+		int count = (int)batch.instances.size();
+		if (count == 0) continue;
+
+		// written straight into this frame's stream region
+		StreamAllocation allocation = stream.allocate(count * sizeof(InstanceData));
+		float depth = writeBatch(batch, (InstanceData*)allocation.data, jobs);
+		bindInstanceData(batch, allocation);
+		pushBatch(queue, batch, shaderProgram, depth);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBatcher::write(RenderQueue& queue, unsigned int shaderProgram, InstanceData* out, JobSystem* jobs)
+{
+	for (int i = 0; i < batches.size(); i++)
+	{
+		MeshBatch& batch = batches[i];
+		int count = (int)batch.instances.size();
+		if (count == 0) continue;
+
+		float depth = writeBatch(batch, out, jobs);
+		pushBatch(queue, batch, shaderProgram, depth);
+		out += count;
+	}
+}
+
+float InstanceBatcher::writeBatch(MeshBatch& batch, InstanceData* out, JobSystem* jobs)
+{
+	int count = (int)batch.instances.size();
+
+	// blended instances inside one draw are drawn in buffer order, keep them back to front
+	if (batch.transparent)
+	{
+		std::sort(batch.instances.begin(), batch.instances.end(),
+			[](const Instance& a, const Instance& b) { return a.viewDepth > b.viewDepth; });
+	}
+
+	float nearest = batch.instances[0].viewDepth;
+	float farthest = batch.instances[0].viewDepth;
+	for (int j = 0; j < count; j++)
+	{
+		nearest = std::min(nearest, batch.instances[j].viewDepth);
+		farthest = std::max(farthest, batch.instances[j].viewDepth);
+	}
+	const Instance* instances = batch.instances.data();
+	auto copy = [instances, out](int begin, int end)
+	{
+		for (int j = begin; j < end; j++) out[j] = instances[j].data;
+	};
+	if (jobs != NULL)
+	{
+		jobs->parallelFor(count, 4096, copy);
+	}
+	else
+	{
+		copy(0, count);
+	}
+	return batch.transparent ? farthest : nearest;
+}
+
+void InstanceBatcher::pushBatch(RenderQueue& queue, const MeshBatch& batch, unsigned int shaderProgram, float depth)
+{
+	DrawPacket packet;
+	packet.shaderProgram = shaderProgram;
+	packet.VAO = batch.VAO;
+	packet.textureTarget = GL_TEXTURE_2D_ARRAY;
+	packet.textures[0] = batch.textureArray;
+	packet.count = batch.vertexCount;
+	packet.instanceCount = (int)batch.instances.size();
+	queue.push(packet, depth, batch.transparent);
+}
+
+int InstanceBatcher::getBatchCount()
+{
+	return (int)batches.size();
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <vector>
+#include "JobSystem.h"
+#include "RenderQueue.h"
+#include "StreamBuffer.h"
+
+// per instance vertex attributes (locations 3 to 7 of instanced shader)
+struct InstanceData
+{
+	glm::mat4 model;		// locations 3,4,5,6
+	int textureLayer;		// location 7.x, layer in the mesh texture array
+	int flags;				// location 7.y, see InstanceBatcher flags
+};
+
+// groups bodies that share a mesh and a texture size so each group is drawn with a single
+// instanced draw call (one per mesh unless its textures differ in size)
+class InstanceBatcher
+{
+public:
+
+	// shader flags
+	static const int FLAG_UNLIT = 1;	// emissive, skip lighting (e.g. sun)
+
+	// register a mesh, its textures are copied into texture arrays (one layer each, see
+	// buildTextureArrays) and every array is one batch of the mesh
+	// returns mesh index used by getTextureSlot()
+	int addMesh(unsigned int VAO, int vertexCount, const std::vector<GLuint>& textures, bool transparent = false);
+
+	// batch without instance attributes or textures, only for headless use of add() and write()
+	// (benchmarks), returns batch index
+	int addBatch(unsigned int VAO, int vertexCount, bool transparent = false);
+
+	// batch and layer of an instance of a mesh drawn with its texture textureIdx (index into the
+	// textures given to addMesh)
+	void getTextureSlot(int meshIdx, int textureIdx, int& batchIdx, int& textureLayer);
+
+	// preallocate instances of a batch so add() never allocates
+	void reserve(int batchIdx, int instanceCount);
+
+	// clear instances of previous frame
+	void begin();
+
+	// queue one instance of a mesh, viewDepth is the distance to the camera
+	void add(int batchIdx, const glm::mat4& model, int textureLayer, int flags, float viewDepth);
+
+	// queue instances of items [0, count) in parallel, visit(begin, end, add) calls
+	// add(batchIdx, model, textureLayer, flags, viewDepth) for the instances of its items
+	// items are split into fixed ranges that are visited twice, first counting their instances per
+	// batch, then writing them at the prefix sum of the earlier ranges, so the instances end up in
+	// the same order as serial adds and nothing is allocated (visit has to add the same both times)
+	template<typename Visit>
+	void addParallel(int count, const Visit& visit, JobSystem* jobs = NULL);
+
+	// instances queued since begin()
+	int getInstanceCount();
+
+	// write instance data into stream and push one packet per non empty mesh into the queue
+	// large batches are copied in parallel if a job system is given, gl calls stay on this thread
+	void flush(RenderQueue& queue, unsigned int shaderProgram, StreamBuffer& stream, JobSystem* jobs = NULL);
+
+	// same as flush without gl calls, instance data of the non empty batches is written one after
+	// another into out (getInstanceCount() elements)
+	void write(RenderQueue& queue, unsigned int shaderProgram, InstanceData* out, JobSystem* jobs = NULL);
+
+	int getBatchCount();
+
+	// blit 2D textures into texture arrays, textures of the same size share an array so no layer
+	// is scaled up, textures larger than maxWidth x maxHeight (if given) are halved until they fit
+	// arrays gets one array per distinct size, arrayOf and layerOf where every texture went
+	static void buildTextureArrays(const std::vector<GLuint>& textures, std::vector<unsigned int>& arrays,
+		std::vector<int>& arrayOf, std::vector<int>& layerOf, int maxWidth = 0, int maxHeight = 0);
+
+private:
+
+	struct Instance
+	{
+		InstanceData data;
+		float viewDepth;
+	};
+
+	struct MeshBatch
+	{
+		unsigned int VAO = 0;
+		int vertexCount = 0;
+		unsigned int textureArray = 0;
+		bool transparent = false;
+		std::vector<Instance> instances;
+	};
+
+	static const int MAX_RANGES = 64;
+
+	// batch and layer of every texture of a mesh
+	struct Mesh
+	{
+		std::vector<int> textureBatches;
+		std::vector<int> textureLayers;
+	};
+
+	std::vector<MeshBatch> batches;
+	std::vector<Mesh> meshes;
+	std::vector<int> rangeOffsets;		// per range and batch, instance count and then write position
+
+	// enable instance attributes of the mesh VAO
+	void setupInstanceAttributes(MeshBatch& batch);
+
+	// new VAO reading the same vertex buffers as attributes 0 to 2 of VAO
+	static unsigned int copyVertexArray(unsigned int VAO);
+
+	// one texture array from textures blitted to width x height
+	static unsigned int buildTextureArray(const std::vector<GLuint>& textures, int width, int height);
+
+	// point instance attributes at this frame's instance data
+	void bindInstanceData(MeshBatch& batch, const StreamAllocation& allocation);
+
+	// copy the instances of a non empty batch into out, returns its sort depth
+	float writeBatch(MeshBatch& batch, InstanceData* out, JobSystem* jobs);
+
+	// one instanced packet for the batch
+	void pushBatch(RenderQueue& queue, const MeshBatch& batch, unsigned int shaderProgram, float depth);
+};
+
+template<typename Visit>
+void InstanceBatcher::addParallel(int count, const Visit& visit, JobSystem* jobs)
+{
+	if (count <= 0) return;
+	int batchCount = (int)batches.size();
+	int threads = jobs != NULL ? jobs->getThreadCount() : 1;
+	int rangeCount = threads * 4 < MAX_RANGES ? threads * 4 : (int)MAX_RANGES;
+	if (threads <= 1 || rangeCount > count) rangeCount = 1;
+	int rangeSize = (count + rangeCount - 1) / rangeCount;
+	rangeOffsets.resize((size_t)MAX_RANGES * batchCount);		// same size every frame
+	int* offsets = rangeOffsets.data();
+
+	auto visitRanges = [&](bool write)
+	{
+		auto body = [&](int begin, int end)
+		{
+			for (int r = begin; r < end; r++)
+			{
+				int* rangeOffset = offsets + (size_t)r * batchCount;
+				int first = r * rangeSize;
+				int last = first + rangeSize < count ? first + rangeSize : count;
+				if (!write)
+				{
+					for (int b = 0; b < batchCount; b++) rangeOffset[b] = 0;
+					visit(first, last, [rangeOffset](int batchIdx, const glm::mat4&, int, int, float) { rangeOffset[batchIdx]++; });
+					continue;
+				}
+				MeshBatch* batchData = batches.data();
+				visit(first, last, [rangeOffset, batchData](int batchIdx, const glm::mat4& model, int textureLayer, int flags, float viewDepth)
+				{
+					Instance& instance = batchData[batchIdx].instances[rangeOffset[batchIdx]++];
+					instance.data.model = model;
+					instance.data.textureLayer = textureLayer;
+					instance.data.flags = flags;
+					instance.viewDepth = viewDepth;
+				});
+			}
+		};
+		if (jobs != NULL) jobs->parallelFor(rangeCount, 1, body);
+		else body(0, rangeCount);
+	};
+
+	// count, then turn the counts into write positions after the instances already queued
+	visitRanges(false);
+	for (int b = 0; b < batchCount; b++)
+	{
+		int offset = (int)batches[b].instances.size();
+		for (int r = 0; r < rangeCount; r++)
+		{
+			int& rangeOffset = offsets[(size_t)r * batchCount + b];
+			int rangeInstances = rangeOffset;
+			rangeOffset = offset;
+			offset += rangeInstances;
+		}
+		batches[b].instances.resize(offset);
+	}
+	visitRanges(true);
+}
@@ -0,0 +1,184 @@
+#include "JobSystem.h"
+#include <chrono>
+
+// queue owned by the current thread in the system it last used
+static thread_local const JobSystem* currentSystem = NULL;
+static thread_local int currentGeneration = 0;
+static thread_local int currentQueueIdx = 0;
+
+// start counts of every system, so a restarted system at the same address doesn't match
+static std::atomic<int> systemGenerations{ 0 };
+
+const int JobSystem::EXTERNAL_QUEUES;
+
+JobSystem::~JobSystem()
+{
+	stop();
+}
+
+void JobSystem::start(int threadCount)
+{
+	stop();
+	if (threadCount <= 0) threadCount = (int)std::thread::hardware_concurrency();
+	if (threadCount <= 0) threadCount = 1;
+
+	queues.clear();
+	for (int i = 0; i < threadCount + EXTERNAL_QUEUES; i++)
+	{
+		queues.push_back(std::unique_ptr<WorkQueue>(new WorkQueue()));
+	}
+	this->threadCount = threadCount;
+	generation = ++systemGenerations;
+	externalThreads = 0;
+	currentSystem = this;
+	currentGeneration = generation;
+	currentQueueIdx = 0;
+
+	running = true;
+	for (int i = 1; i < threadCount; i++)
+	{
+		workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+	}
+}
+
+void JobSystem::stop()
+{
+	if (!running) return;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	sleepCondition.notify_all();
+	for (int i = 0; i < workers.size(); i++)
+	{
+		workers[i].join();
+	}
+	workers.clear();
+
+	// nothing should be left, but never drop a job somebody waits for
+	while (runOne()) {}
+	queues.clear();
+}
+
+int JobSystem::getThreadCount()
+{
+	return running ? threadCount : 1;
+}
+
+void JobSystem::run(JobFunction function, void* data, int begin, int end, JobCounter* counter)
+{
+	Job job;
+	job.function = function;
+	job.data = data;
+	job.begin = begin;
+	job.end = end;
+	job.counter = counter;
+	counter->pending.fetch_add(1, std::memory_order_relaxed);
+
+	// a full queue (or stopped system) runs the job right away
+	if (!running || !push(getQueueIdx(), job))
+	{
+		execute(job);
+		return;
+	}
+	queuedJobs.fetch_add(1, std::memory_order_release);
+	sleepCondition.notify_one();
+}
+
+void JobSystem::wait(JobCounter* counter)
+{
+	while (counter->pending.load(std::memory_order_acquire) > 0)
+	{
+		if (!runOne()) std::this_thread::yield();
+	}
+}
+
+void JobSystem::workerLoop(int threadIdx)
+{
+	currentSystem = this;
+	currentGeneration = generation;
+	currentQueueIdx = threadIdx;
+
+	while (running)
+	{
+		if (runOne()) continue;
+
+		// nothing to steal, sleep until more jobs are queued (timeout covers a missed notify)
+		std::unique_lock<std::mutex> lock(sleepMutex);
+		sleepCondition.wait_for(lock, std::chrono::milliseconds(2),
+			[this]() { return queuedJobs.load(std::memory_order_acquire) > 0 || !running; });
+	}
+}
+
+bool JobSystem::push(int queueIdx, const Job& job)
+{
+	WorkQueue& queue = *queues[queueIdx];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tail - queue.head >= WorkQueue::CAPACITY) return false;
+	queue.jobs[queue.tail % WorkQueue::CAPACITY] = job;
+	queue.tail++;
+	return true;
+}
+
+bool JobSystem::pop(int queueIdx, Job& job)
+{
+	WorkQueue& queue = *queues[queueIdx];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tail == queue.head) return false;
+	queue.tail--;
+	job = queue.jobs[queue.tail % WorkQueue::CAPACITY];
+	if (queue.tail == queue.head)
+	{
+		queue.head = 0;
+		queue.tail = 0;
+	}
+	return true;
+}
+
+bool JobSystem::steal(int queueIdx, Job& job)
+{
+	WorkQueue& queue = *queues[queueIdx];
+	if (!queue.mutex.try_lock()) return false;		// busy queue, try the next one
+	bool stolen = queue.tail != queue.head;
+	if (stolen)
+	{
+		job = queue.jobs[queue.head % WorkQueue::CAPACITY];
+		queue.head++;
+	}
+	queue.mutex.unlock();
+	return stolen;
+}
+
+bool JobSystem::runOne()
+{
+	if (queues.empty()) return false;
+	int own = getQueueIdx();
+	Job job;
+	bool found = pop(own, job);
+	for (int i = 1; !found && i < queues.size(); i++)
+	{
+		found = steal((own + i) % queues.size(), job);
+	}
+	if (!found) return false;
+
+	queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	execute(job);
+	return true;
+}
+
+void JobSystem::execute(const Job& job)
+{
+	job.function(job.data, job.begin, job.end);
+	job.counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+int JobSystem::getQueueIdx()
+{
+	if (currentSystem != this || currentGeneration != generation)
+	{
+		currentSystem = this;
+		currentGeneration = generation;
+		currentQueueIdx = threadCount + externalThreads.fetch_add(1) % EXTERNAL_QUEUES;
+	}
+	return currentQueueIdx;
+}
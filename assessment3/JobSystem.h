@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// number of queued jobs that have not finished yet, wait() returns once it reaches zero
+// a stage that depends on another waits on the other stage's counter before queueing its own jobs
+struct JobCounter
+{
+	std::atomic<int> pending{ 0 };
+};
+
+// work stealing thread pool for the per frame cpu work (animation, transforms, culling, packets)
+// every thread owns a fixed size deque, it takes its own jobs newest first and steals the oldest
+// jobs of other threads when it runs dry, waiting threads run jobs instead of blocking
+// threads outside the pool (e.g. the simulation thread) that queue jobs claim one of a few extra
+// queues on their first job, more of them than EXTERNAL_QUEUES share them round robin
+// jobs are a function pointer and a range so queueing never allocates
+class JobSystem
+{
+public:
+
+	typedef void (*JobFunction)(void* data, int begin, int end);
+
+	static const int EXTERNAL_QUEUES = 4;		// queues for threads outside the pool
+
+	~JobSystem();
+
+	// threadCount includes the calling thread, 0 uses every hardware thread
+	void start(int threadCount = 0);
+	void stop();
+	int getThreadCount();
+
+	// queue function(data, begin, end), counter is incremented now and decremented when the job is done
+	void run(JobFunction function, void* data, int begin, int end, JobCounter* counter);
+
+	// run queued jobs on this thread until counter reaches zero
+	void wait(JobCounter* counter);
+
+	// body(begin, end) over [0, count) split into ranges of at least grainSize, returns when all are done
+	// small counts and a stopped system run inline on the calling thread
+	template<typename Body>
+	void parallelFor(int count, int grainSize, const Body& body);
+
+	// same, range boundaries are multiples of alignment (e.g. simd width)
+	template<typename Body>
+	void parallelFor(int count, int grainSize, int alignment, const Body& body);
+
+private:
+
+	struct Job
+	{
+		JobFunction function = NULL;
+		void* data = NULL;
+		int begin = 0;
+		int end = 0;
+		JobCounter* counter = NULL;
+	};
+
+	// ring buffer, owner pushes and pops at the tail, thieves take from the head
+	struct WorkQueue
+	{
+		static const int CAPACITY = 1024;
+		std::mutex mutex;
+		Job jobs[CAPACITY];
+		int head = 0;
+		int tail = 0;
+	};
+
+	// one per pool thread (0 is the starting thread), then the external queues
+	std::vector<std::unique_ptr<WorkQueue>> queues;
+	int threadCount = 1;
+	int generation = 0;								// start count, stale thread queue indices don't match it
+	std::atomic<int> externalThreads{ 0 };			// external queues claimed so far
+	std::vector<std::thread> workers;
+	std::atomic<bool> running{ false };
+	std::atomic<int> queuedJobs{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable sleepCondition;
+
+	void workerLoop(int threadIdx);
+	bool push(int queueIdx, const Job& job);
+	bool pop(int queueIdx, Job& job);
+	bool steal(int queueIdx, Job& job);
+	bool runOne();		// run one job from own queue or a stolen one, false if there was none
+	void execute(const Job& job);
+	int getQueueIdx();		// queue of the calling thread, claims an external one on first use
+
+	template<typename Body>
+	static void runBody(void* data, int begin, int end) { (*(const Body*)data)(begin, end); }
+};
+
+template<typename Body>
+void JobSystem::parallelFor(int count, int grainSize, const Body& body)
+{
+	parallelFor(count, grainSize, 1, body);
+}
+
+template<typename Body>
+void JobSystem::parallelFor(int count, int grainSize, int alignment, const Body& body)
+{
+	if (count <= 0) return;
+	int threads = getThreadCount();
+	if (threads <= 1 || count <= grainSize)
+	{
+		body(0, count);
+		return;
+	}
+
+	// a few ranges per thread so stealing can even out uneven ranges
+	int rangeCount = (count + grainSize - 1) / grainSize;
+	if (rangeCount > threads * 4) rangeCount = threads * 4;
+	int rangeSize = (count + rangeCount - 1) / rangeCount;
+	rangeSize = (rangeSize + alignment - 1) / alignment * alignment;
+
+	JobCounter counter;
+	for (int begin = rangeSize; begin < count; begin += rangeSize)
+	{
+		int end = begin + rangeSize < count ? begin + rangeSize : count;
+		run(&runBody<Body>, (void*)&body, begin, end, &counter);
+	}
+
+	// first range on this thread, the rest are picked up by the others meanwhile
+	body(0, rangeSize < count ? rangeSize : count);
+	wait(&counter);
+}
@@ -0,0 +1,96 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE) return false;
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+
+	mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		close();
+		return false;
+	}
+	data = MapViewOfFile((HANDLE)mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != NULL) UnmapViewOfFile(data);
+	if (mappingHandle != NULL) CloseHandle((HANDLE)mappingHandle);
+	if (fileHandle != NULL) CloseHandle((HANDLE)fileHandle);
+	data = NULL;
+	mappingHandle = NULL;
+	fileHandle = NULL;
+	size = 0;
+}
+
+#else
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+	int file = ::open(path.c_str(), O_RDONLY);
+	if (file == -1) return false;
+
+	struct stat fileStat;
+	if (fstat(file, &fileStat) != 0 || fileStat.st_size == 0)
+	{
+		::close(file);
+		return false;
+	}
+
+	// the mapping stays valid after the descriptor is closed
+	void* mapped = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+	::close(file);
+	if (mapped == MAP_FAILED) return false;
+	data = mapped;
+	size = (size_t)fileStat.st_size;
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data != NULL) munmap((void*)data, size);
+	data = NULL;
+	size = 0;
+}
+
+#endif
+
+const void* MappedFile::getData() { return data; }
+size_t MappedFile::getSize() { return size; }
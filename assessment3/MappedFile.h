@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// read only view of a whole file mapped into memory, pages are loaded by the os on first access
+class MappedFile
+{
+public:
+
+	MappedFile() {}
+	~MappedFile();
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	// returns false if the file can't be opened or mapped
+	bool open(const std::string& path);
+	void close();
+
+	const void* getData();
+	size_t getSize();
+
+private:
+
+	const void* data = NULL;
+	size_t size = 0;
+
+#ifdef _WIN32
+	void* fileHandle = NULL;
+	void* mappingHandle = NULL;
+#endif
+};
@@ -0,0 +1,344 @@
+#include "MinorBodyCatalog.h"
+#include "JobSystem.h"
+#include <stdexcept>
+#include <string.h>
+
+// 1 based columns of the MPCORB format
+static const int DESIGNATION_COLUMN = 1;
+static const int MAGNITUDE_COLUMN = 9;
+static const int EPOCH_COLUMN = 21;
+static const int MEAN_ANOMALY_COLUMN = 27;
+static const int PERIAPSIS_COLUMN = 38;
+static const int NODE_COLUMN = 49;
+static const int INCLINATION_COLUMN = 60;
+static const int ECCENTRICITY_COLUMN = 71;
+static const int MEAN_MOTION_COLUMN = 81;
+static const int SEMI_MAJOR_AXIS_COLUMN = 93;
+static const int LINE_LENGTH = 103;			// last column used
+
+const int MinorBodyCatalog::CHUNK_SIZE;
+const int MinorBodyCatalog::DESIGNATION_SIZE;
+
+void MinorBodyCatalog::load(const std::string& path, const CatalogFilter& filter, JobSystem* jobs)
+{
+	if (!file.open(path))
+	{
+		throw std::runtime_error("can't open catalog file " + path);
+	}
+	try
+	{
+		load((const char*)file.getData(), file.getSize(), filter, jobs);
+	}
+	catch (const std::runtime_error& e)
+	{
+		file.close();
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+void MinorBodyCatalog::load(const char* text, size_t size, const CatalogFilter& filter, JobSystem* jobs)
+{
+	// the MPCORB.DAT header ends with a line of dashes, element files without it start right away
+	size_t start = 0;
+	size_t headerEnd = size < 65536 ? size : 65536;
+	for (size_t i = 0; i + 10 <= headerEnd; i++)
+	{
+		if ((i == 0 || text[i - 1] == '\n') && memcmp(text + i, "----------", 10) == 0)
+		{
+			const char* newline = (const char*)memchr(text + i, '\n', size - i);
+			start = newline == NULL ? size : newline - text + 1;
+			break;
+		}
+	}
+
+	int chunkCount = (int)((size - start + CHUNK_SIZE - 1) / CHUNK_SIZE);
+	chunks.resize(chunkCount);
+	auto parseChunks = [&](int begin, int end)
+	{
+		for (int c = begin; c < end; c++)
+		{
+			size_t chunkBegin = start + (size_t)c * CHUNK_SIZE;
+			size_t chunkEnd = chunkBegin + CHUNK_SIZE < size ? chunkBegin + CHUNK_SIZE : size;
+			parseChunk(chunks[c], text, size, chunkBegin, chunkEnd, filter);
+		}
+	};
+	if (jobs != NULL) jobs->parallelFor(chunkCount, 1, parseChunks);
+	else parseChunks(0, chunkCount);
+
+	// prefix sum of the chunk counts, cut at the filter's count
+	count = 0;
+	lineCount = 0;
+	skippedCount = 0;
+	for (int c = 0; c < chunkCount; c++)
+	{
+		Chunk& chunk = chunks[c];
+		int kept = (int)chunk.elements.size();
+		if (filter.maxCount >= 0 && count + kept > filter.maxCount)
+		{
+			kept = filter.maxCount - count;
+			chunk.elements.resize(kept);
+		}
+		chunk.first = count;
+		count += kept;
+		lineCount += chunk.lineCount;
+		skippedCount += chunk.skippedCount;
+	}
+	if (lineCount == 0) throw std::runtime_error("catalog has no element lines");
+
+	designations.resize((size_t)count * DESIGNATION_SIZE);
+	magnitudes.resize(count);
+	semiMajorAxes.resize(count);
+	eccentricities.resize(count);
+	inclinations.resize(count);
+	ascendingNodes.resize(count);
+	periapsisArguments.resize(count);
+	meanAnomalies.resize(count);
+	meanMotions.resize(count);
+	epochs.resize(count);
+	auto copyChunks = [this](int begin, int end)
+	{
+		for (int c = begin; c < end; c++) copyChunk(chunks[c]);
+	};
+	if (jobs != NULL) jobs->parallelFor(chunkCount, 1, copyChunks);
+	else copyChunks(0, chunkCount);
+}
+
+void MinorBodyCatalog::parseChunk(Chunk& chunk, const char* text, size_t size, size_t begin, size_t end,
+	const CatalogFilter& filter)
+{
+	chunk.elements.clear();
+	chunk.lineCount = 0;
+	chunk.skippedCount = 0;
+
+	// first line starting at or after begin, the one crossing begin belongs to the previous chunk
+	size_t lineStart = begin;
+	if (lineStart > 0 && text[lineStart - 1] != '\n')
+	{
+		const char* newline = (const char*)memchr(text + lineStart, '\n', size - lineStart);
+		lineStart = newline == NULL ? size : newline - text + 1;
+	}
+
+	chunk.elements.reserve((end - begin) / (LINE_LENGTH + 1) + 1);
+	Elements elements;
+	while (lineStart < end)
+	{
+		const char* line = text + lineStart;
+		const char* newline = (const char*)memchr(line, '\n', size - lineStart);
+		size_t length = newline == NULL ? size - lineStart : newline - line;
+		lineStart += length + 1;
+		if (length > 0 && line[length - 1] == '\r') length--;
+
+		// blank lines separate the sections of MPCORB.DAT
+		size_t i = 0;
+		while (i < length && (line[i] == ' ' || line[i] == '\t')) i++;
+		if (i == length) continue;
+
+		bool passed = false;
+		if (!parseLine(line, length, filter, elements, passed))
+		{
+			chunk.skippedCount++;
+			continue;
+		}
+		chunk.lineCount++;
+		if (passed) chunk.elements.push_back(elements);
+	}
+}
+
+void MinorBodyCatalog::copyChunk(const Chunk& chunk)
+{
+	for (int i = 0; i < (int)chunk.elements.size(); i++)
+	{
+		const Elements& e = chunk.elements[i];
+		int idx = chunk.first + i;
+		memcpy(&designations[(size_t)idx * DESIGNATION_SIZE], e.designation, DESIGNATION_SIZE);
+		magnitudes[idx] = e.magnitude;
+		semiMajorAxes[idx] = e.semiMajorAxis;
+		eccentricities[idx] = e.eccentricity;
+		inclinations[idx] = e.inclination;
+		ascendingNodes[idx] = e.ascendingNode;
+		periapsisArguments[idx] = e.periapsisArgument;
+		meanAnomalies[idx] = e.meanAnomaly;
+		meanMotions[idx] = e.meanMotion;
+		epochs[idx] = e.epoch;
+	}
+}
+
+bool MinorBodyCatalog::parseLine(const char* line, size_t length, const CatalogFilter& filter, Elements& out, bool& passed)
+{
+	if (length < LINE_LENGTH) return false;
+
+	// filter fields first, the rest is only read for bodies that are kept
+	double a, h;
+	if (parseField(line + SEMI_MAJOR_AXIS_COLUMN - 1, 11, a) != 1 || !(a > 0.0)) return false;
+	int hResult = parseField(line + MAGNITUDE_COLUMN - 1, 5, h);
+	if (hResult == -1) return false;
+	passed = a >= filter.minSemiMajorAxis && a <= filter.maxSemiMajorAxis
+		&& (hResult == 1 ? h <= filter.maxMagnitude : filter.maxMagnitude == INFINITY);
+	if (!passed) return true;
+
+	double e, i, node, peri, m, n, epoch;
+	if (parseField(line + ECCENTRICITY_COLUMN - 1, 9, e) != 1 || e < 0.0
+		|| parseField(line + INCLINATION_COLUMN - 1, 9, i) != 1
+		|| parseField(line + NODE_COLUMN - 1, 9, node) != 1
+		|| parseField(line + PERIAPSIS_COLUMN - 1, 9, peri) != 1
+		|| parseField(line + MEAN_ANOMALY_COLUMN - 1, 9, m) != 1
+		|| parseField(line + MEAN_MOTION_COLUMN - 1, 11, n) != 1 || !(n > 0.0)
+		|| !parseEpoch(line + EPOCH_COLUMN - 1, epoch))
+	{
+		return false;
+	}
+	passed = e <= filter.maxEccentricity;
+
+	// designation without its trailing spaces
+	int d = 7;
+	while (d > 0 && line[DESIGNATION_COLUMN - 1 + d - 1] == ' ') d--;
+	memset(out.designation, 0, DESIGNATION_SIZE);
+	memcpy(out.designation, line + DESIGNATION_COLUMN - 1, d);
+
+	out.magnitude = hResult == 1 ? (float)h : NAN;
+	out.semiMajorAxis = (float)a;
+	out.eccentricity = (float)e;
+	out.inclination = (float)i;
+	out.ascendingNode = (float)node;
+	out.periapsisArgument = (float)peri;
+	out.meanAnomaly = (float)m;
+	out.meanMotion = (float)n;
+	out.epoch = (float)epoch;
+	return true;
+}
+
+int MinorBodyCatalog::parseField(const char* field, int width, double& value)
+{
+	static const double powers[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+		1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+	int i = 0;
+	while (i < width && field[i] == ' ') i++;
+	if (i == width) return 0;
+
+	bool negative = field[i] == '-';
+	if (field[i] == '-' || field[i] == '+') i++;
+
+	// digits into an integer mantissa, fields are narrower than its 18 digits
+	long long mantissa = 0;
+	int digits = 0;
+	int decimals = -1;
+	for (; i < width; i++)
+	{
+		char ch = field[i];
+		if (ch >= '0' && ch <= '9')
+		{
+			mantissa = mantissa * 10 + (ch - '0');
+			digits++;
+			if (decimals >= 0) decimals++;
+		}
+		else if (ch == '.' && decimals < 0) decimals = 0;
+		else break;
+	}
+	if (digits == 0 || digits > 18) return -1;
+	while (i < width && field[i] == ' ') i++;
+	if (i != width) return -1;
+
+	value = (double)mantissa / powers[decimals < 0 ? 0 : decimals];
+	if (negative) value = -value;
+	return 1;
+}
+
+bool MinorBodyCatalog::parseEpoch(const char* field, double& days)
+{
+	// century letter, two year digits, month and day as 1-9 then A...
+	auto packedDigit = [](char ch)
+	{
+		if (ch >= '1' && ch <= '9') return ch - '0';
+		if (ch >= 'A' && ch <= 'V') return ch - 'A' + 10;
+		return -1;
+	};
+	if (field[0] < 'I' || field[0] > 'L' || field[1] < '0' || field[1] > '9' || field[2] < '0' || field[2] > '9') return false;
+	int year = (field[0] - 'I' + 18) * 100 + (field[1] - '0') * 10 + (field[2] - '0');
+	int month = packedDigit(field[3]);
+	int day = packedDigit(field[4]);
+	if (month < 1 || month > 12 || day < 1 || day > 31) return false;
+
+	// days from 1970-01-01 of a proleptic gregorian date (h. hinnant's days_from_civil)
+	int y = month <= 2 ? year - 1 : year;
+	int era = (y >= 0 ? y : y - 399) / 400;
+	int yearOfEra = y - era * 400;
+	int dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+	int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+	long long civil = (long long)era * 146097 + dayOfEra - 719468;
+
+	// epochs are at 0h, J2000 is 2000-01-01 12h
+	days = (double)civil - 10957.5;
+	return true;
+}
+
+int MinorBodyCatalog::getCount()
+{
+	return count;
+}
+
+int MinorBodyCatalog::getLineCount()
+{
+	return lineCount;
+}
+
+int MinorBodyCatalog::getSkippedCount()
+{
+	return skippedCount;
+}
+
+const char* MinorBodyCatalog::getDesignation(int idx)
+{
+	return &designations[(size_t)idx * DESIGNATION_SIZE];
+}
+
+double MinorBodyCatalog::getMeanAnomaly(int idx, double days)
+{
+	double m = fmod(meanAnomalies[idx] + (double)meanMotions[idx] * (days - epochs[idx]), 360.0);
+	return m < 0.0 ? m + 360.0 : m;
+}
+
+const float* MinorBodyCatalog::getMagnitudes()
+{
+	return magnitudes.data();
+}
+
+const float* MinorBodyCatalog::getSemiMajorAxes()
+{
+	return semiMajorAxes.data();
+}
+
+const float* MinorBodyCatalog::getEccentricities()
+{
+	return eccentricities.data();
+}
+
+const float* MinorBodyCatalog::getInclinations()
+{
+	return inclinations.data();
+}
+
+const float* MinorBodyCatalog::getAscendingNodes()
+{
+	return ascendingNodes.data();
+}
+
+const float* MinorBodyCatalog::getPeriapsisArguments()
+{
+	return periapsisArguments.data();
+}
+
+const float* MinorBodyCatalog::getMeanAnomalies()
+{
+	return meanAnomalies.data();
+}
+
+const float* MinorBodyCatalog::getMeanMotions()
+{
+	return meanMotions.data();
+}
+
+const float* MinorBodyCatalog::getEpochs()
+{
+	return epochs.data();
+}
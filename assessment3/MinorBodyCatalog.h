@@ -0,0 +1,116 @@
+#pragma once
+
+#include <math.h>
+#include <stddef.h>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+class JobSystem;
+
+// bodies a catalog load keeps, checked while parsing so rejected lines only read the fields
+// of the checks (semi major axis first, then magnitude)
+struct CatalogFilter
+{
+	float minSemiMajorAxis = 0.f;			// au
+	float maxSemiMajorAxis = INFINITY;
+	float maxMagnitude = INFINITY;			// absolute magnitude H, bodies without one only pass without a limit
+	float maxEccentricity = 0.99f;			// the orbit solver converges up to 0.99
+	int maxCount = -1;						// first ones in file order, -1 = all
+};
+
+// orbital elements of minor bodies from a minor planet center catalog in the fixed width MPCORB
+// format (MPCORB.DAT, NEA.txt... one body per line, optional header ending with a line of dashes)
+// the file is memory mapped and split into chunks of a fixed size that are parsed in parallel, a
+// line belongs to the chunk it starts in, chunks parse into their own scratch and are copied into
+// the element arrays at their prefix sum afterwards, so the bodies keep the file order
+// elements are kept as structure of arrays by body index, angles in degrees (J2000 ecliptic),
+// epochs in days from J2000
+class MinorBodyCatalog
+{
+public:
+
+	static const int CHUNK_SIZE = 256 * 1024;		// bytes per parse job
+
+	// parse a catalog file, throws std::runtime_error if it is missing or has no element lines
+	void load(const std::string& path, const CatalogFilter& filter, JobSystem* jobs = NULL);
+
+	// parse catalog text in memory
+	void load(const char* text, size_t size, const CatalogFilter& filter, JobSystem* jobs = NULL);
+
+	int getCount();				// bodies that passed the filter
+	int getLineCount();			// element lines read, passed or not
+	int getSkippedCount();		// malformed lines, not counted as element lines
+
+	// packed designation (number or provisional designation, e.g. "00001", "K14A00A")
+	const char* getDesignation(int idx);
+
+	// mean anomaly at days from J2000, propagated with the mean motion
+	double getMeanAnomaly(int idx, double days);
+
+	const float* getMagnitudes();				// NaN if the line has none
+	const float* getSemiMajorAxes();			// au
+	const float* getEccentricities();
+	const float* getInclinations();
+	const float* getAscendingNodes();
+	const float* getPeriapsisArguments();
+	const float* getMeanAnomalies();			// at the epoch
+	const float* getMeanMotions();				// degrees per day
+	const float* getEpochs();
+
+private:
+
+	static const int DESIGNATION_SIZE = 8;
+
+	struct Elements
+	{
+		char designation[DESIGNATION_SIZE];
+		float magnitude;
+		float semiMajorAxis;
+		float eccentricity;
+		float inclination;
+		float ascendingNode;
+		float periapsisArgument;
+		float meanAnomaly;
+		float meanMotion;
+		float epoch;
+	};
+
+	struct Chunk
+	{
+		std::vector<Elements> elements;
+		int lineCount;
+		int skippedCount;
+		int first;					// body index of the first element
+	};
+
+	MappedFile file;
+	int count = 0;
+	int lineCount = 0;
+	int skippedCount = 0;
+
+	std::vector<char> designations;		// DESIGNATION_SIZE per body, null terminated
+	std::vector<float> magnitudes;
+	std::vector<float> semiMajorAxes;
+	std::vector<float> eccentricities;
+	std::vector<float> inclinations;
+	std::vector<float> ascendingNodes;
+	std::vector<float> periapsisArguments;
+	std::vector<float> meanAnomalies;
+	std::vector<float> meanMotions;
+	std::vector<float> epochs;
+
+	std::vector<Chunk> chunks;
+
+	void parseChunk(Chunk& chunk, const char* text, size_t size, size_t begin, size_t end, const CatalogFilter& filter);
+	void copyChunk(const Chunk& chunk);
+
+	// elements of one line, false if it is malformed, passed is false if the filter rejects it
+	static bool parseLine(const char* line, size_t length, const CatalogFilter& filter, Elements& out, bool& passed);
+
+	// fixed width decimal field, 1 = value, 0 = blank, -1 = malformed
+	static int parseField(const char* field, int width, double& value);
+
+	// packed epoch (e.g. "K239D" = 2023-09-13) in days from J2000, false if malformed
+	static bool parseEpoch(const char* field, double& days);
+};
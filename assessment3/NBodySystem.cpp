@@ -0,0 +1,632 @@
+#include "NBodySystem.h"
+#include "JobSystem.h"
+#include "OrbitSystem.h"
+#include "SimdMath.h"
+#include <algorithm>
+#include <math.h>
+
+const int NBodySystem::LEAF_SIZE;
+const int NBodySystem::MAX_DEPTH;
+const int NBodySystem::MAX_RANGES;
+const int NBodySystem::GROUP_SIZE;
+const int NBodySystem::LIST_SIZE;
+
+int NBodySystem::addParticle(const glm::vec3& position, const glm::vec3& velocity, float gm, int orbitIdx)
+{
+	int idx = count++;
+	bodies.push_back(glm::vec4(position, gm));
+	exactPositions.push_back(glm::dvec3(position));
+	velocities.push_back(glm::dvec3(velocity));
+	accelerations.push_back(glm::vec3(0.f));
+	potentials.push_back(0.f);
+	ids.push_back(idx);
+	slots.push_back(idx);
+	orbitIndices.push_back(orbitIdx);
+	positions.push_back(position);
+	forcesValid = false;
+	return idx;
+}
+
+void NBodySystem::clear()
+{
+	count = 0;
+	bodies.clear();
+	exactPositions.clear();
+	velocities.clear();
+	accelerations.clear();
+	potentials.clear();
+	ids.clear();
+	slots.clear();
+	orbitIndices.clear();
+	positions.clear();
+	nodes.clear();
+	groups.clear();
+	attractors.clear();
+	attractorPositions.clear();
+	forcesValid = false;
+}
+
+void NBodySystem::reserve(int particleCount)
+{
+	bodies.reserve(particleCount);
+	exactPositions.reserve(particleCount);
+	velocities.reserve(particleCount);
+	accelerations.reserve(particleCount);
+	potentials.reserve(particleCount);
+	ids.reserve(particleCount);
+	slots.reserve(particleCount);
+	orbitIndices.reserve(particleCount);
+	positions.reserve(particleCount);
+}
+
+int NBodySystem::getParticleCount() { return count; }
+int NBodySystem::getAttractorCount() { return (int)attractors.size(); }
+const glm::vec3* NBodySystem::getPositions() { return positions.data(); }
+glm::vec3 NBodySystem::getVelocity(int idx) { return glm::vec3(velocities[slots[idx]]); }
+glm::vec3 NBodySystem::getAcceleration(int idx) { return accelerations[slots[idx]]; }
+const int* NBodySystem::getOrbitIndices() { return orbitIndices.data(); }
+int NBodySystem::getNodeCount() { return (int)nodes.size(); }
+long long NBodySystem::getInteractionCount() { return interactions; }
+
+int NBodySystem::addAttractor(int orbitIdx, const glm::mat3& rotation, float gm)
+{
+	Attractor attractor;
+	attractor.orbitIdx = orbitIdx;
+	attractor.rotation = rotation;
+	attractor.gm = gm;
+	attractor.start = glm::vec3(0.f);
+	attractor.end = glm::vec3(0.f);
+	attractors.push_back(attractor);
+	attractorPositions.push_back(glm::vec4(0.f, 0.f, 0.f, gm));
+	forcesValid = false;
+	return (int)attractors.size() - 1;
+}
+
+void NBodySystem::syncAttractors(OrbitSystem& orbits)
+{
+	const glm::vec3* orbitPositions = orbits.getPositions();
+	for (int a = 0; a < attractors.size(); a++)
+	{
+		Attractor& attractor = attractors[a];
+		glm::vec3 position = attractor.orbitIdx == -1 ? glm::vec3(0.f) : attractor.rotation * orbitPositions[attractor.orbitIdx];
+		attractor.start = position;
+		attractor.end = position;
+	}
+	forcesValid = false;
+}
+
+void NBodySystem::setOpeningAngle(float theta)
+{
+	// a cell that contains the particle is always opened up to 1 (see buildNode)
+	openingAngle = std::min(std::max(theta, 0.f), 1.f);
+	forcesValid = false;
+}
+
+void NBodySystem::setSoftening(float length)
+{
+	softening2 = length * length;
+	forcesValid = false;
+}
+
+void NBodySystem::setIntegrator(Integrator integrator) { this->integrator = integrator; }
+
+const char* NBodySystem::getIntegratorName(Integrator integrator)
+{
+	return integrator == YOSHIDA4 ? "yoshida" : "leapfrog";
+}
+
+void NBodySystem::step(OrbitSystem& orbits, double seconds, JobSystem* jobs)
+{
+	const glm::vec3* orbitPositions = orbits.getPositions();
+	for (int a = 0; a < attractors.size(); a++)
+	{
+		Attractor& attractor = attractors[a];
+		attractor.start = attractor.end;
+		if (attractor.orbitIdx != -1) attractor.end = attractor.rotation * orbitPositions[attractor.orbitIdx];
+	}
+	integrate(seconds, jobs);
+}
+
+void NBodySystem::step(double seconds, JobSystem* jobs)
+{
+	for (int a = 0; a < attractors.size(); a++) attractors[a].start = attractors[a].end;
+	integrate(seconds, jobs);
+}
+
+void NBodySystem::integrate(double seconds, JobSystem* jobs)
+{
+	if (count == 0) return;
+	if (integrator == YOSHIDA4)
+	{
+		// w1, w0, w1 leapfrog steps, the middle one goes backwards
+		const double w1 = 1.3512071919596578;
+		const double w0 = -1.7024143839193153;
+		leapfrog(seconds * w1, 0.f, (float)w1, jobs);
+		leapfrog(seconds * w0, (float)w1, (float)(w1 + w0), jobs);
+		leapfrog(seconds * w1, (float)(w1 + w0), 1.f, jobs);
+	}
+	else
+	{
+		leapfrog(seconds, 0.f, 1.f, jobs);
+	}
+	writePositions(jobs);
+}
+
+void NBodySystem::leapfrog(double seconds, float startTime, float endTime, JobSystem* jobs)
+{
+	// kick drift kick, the closing kick's forces open the next step
+	if (!forcesValid)
+	{
+		attractorTime = startTime;
+		computeForces(jobs);
+	}
+
+	double halfStep = seconds * 0.5;
+	auto kickDrift = [this, halfStep, seconds](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			velocities[i] += glm::dvec3(accelerations[i]) * halfStep;
+			exactPositions[i] += velocities[i] * seconds;
+			bodies[i] = glm::vec4(glm::vec3(exactPositions[i]), bodies[i].w);
+		}
+	};
+	if (jobs != NULL) jobs->parallelFor(count, 4096, kickDrift);
+	else kickDrift(0, count);
+
+	attractorTime = endTime;
+	computeForces(jobs);
+
+	auto kick = [this, halfStep](int begin, int end)
+	{
+		for (int i = begin; i < end; i++) velocities[i] += glm::dvec3(accelerations[i]) * halfStep;
+	};
+	if (jobs != NULL) jobs->parallelFor(count, 4096, kick);
+	else kick(0, count);
+}
+
+void NBodySystem::computeForces(JobSystem* jobs)
+{
+	for (int a = 0; a < attractors.size(); a++)
+	{
+		const Attractor& attractor = attractors[a];
+		attractorPositions[a] = glm::vec4(attractor.start + (attractor.end - attractor.start) * attractorTime, attractor.gm);
+	}
+
+	buildTree(jobs);
+	interactions = 0;
+	int groupCount = (int)groups.size();
+	if (jobs != NULL) jobs->parallelFor(groupCount, 4, [this](int begin, int end) { walkGroups(begin, end); });
+	else walkGroups(0, groupCount);
+	forcesValid = true;
+}
+
+uint64_t NBodySystem::mortonCode(uint32_t x, uint32_t y, uint32_t z)
+{
+	// spread 21 bits to every third bit, x in bit 0, y in bit 1, z in bit 2
+	uint64_t v[3] = { x, y, z };
+	for (int k = 0; k < 3; k++)
+	{
+		uint64_t b = v[k] & 0x1fffff;
+		b = (b | b << 32) & 0x1f00000000ffffull;
+		b = (b | b << 16) & 0x1f0000ff0000ffull;
+		b = (b | b << 8) & 0x100f00f00f00f00full;
+		b = (b | b << 4) & 0x10c30c30c30c30c3ull;
+		b = (b | b << 2) & 0x1249249249249249ull;
+		v[k] = b;
+	}
+	return v[0] | v[1] << 1 | v[2] << 2;
+}
+
+void NBodySystem::buildTree(JobSystem* jobs)
+{
+	// reserved for the deepest tree the particles can make, so no build after the first grows it
+	// inner nodes hold more than LEAF_SIZE particles, so at most count / (LEAF_SIZE + 1) per depth
+	// (chains of single child cells included), plus at most one leaf per particle
+	nodes.clear();
+	nodes.reserve((size_t)count + (size_t)MAX_DEPTH * (count / (LEAF_SIZE + 1)) + 1);
+	if (count == 0) return;
+
+	// bounds, keys, sort and reorder are split into the same fixed particle ranges
+	int threads = jobs != NULL ? jobs->getThreadCount() : 1;
+	int rangeCount = std::min(threads * 4, MAX_RANGES);
+	if (threads <= 1 || rangeCount * 4096 > count) rangeCount = 1;
+	int rangeSize = (count + rangeCount - 1) / rangeCount;
+	auto forRanges = [jobs, rangeCount](const auto& range)
+	{
+		auto body = [&range](int begin, int end) { for (int r = begin; r < end; r++) range(r); };
+		if (rangeCount > 1) jobs->parallelFor(rangeCount, 1, body);
+		else body(0, rangeCount);
+	};
+	int edges[MAX_RANGES + 1];
+	for (int r = 0; r <= rangeCount; r++) edges[r] = std::min(r * rangeSize, count);
+
+	// bounding cube, merged from the bounds of every range
+	glm::vec3 rangeLo[MAX_RANGES], rangeHi[MAX_RANGES];
+	forRanges([&](int r)
+	{
+		glm::vec3 lo = glm::vec3(bodies[edges[r]]);
+		glm::vec3 hi = lo;
+		for (int i = edges[r] + 1; i < edges[r + 1]; i++)
+		{
+			lo = glm::min(lo, glm::vec3(bodies[i]));
+			hi = glm::max(hi, glm::vec3(bodies[i]));
+		}
+		rangeLo[r] = lo;
+		rangeHi[r] = hi;
+	});
+	glm::vec3 lo = rangeLo[0];
+	glm::vec3 hi = rangeHi[0];
+	for (int r = 1; r < rangeCount; r++)
+	{
+		lo = glm::min(lo, rangeLo[r]);
+		hi = glm::max(hi, rangeHi[r]);
+	}
+	glm::vec3 extent = hi - lo;
+	float size = std::max(std::max(extent.x, extent.y), extent.z);
+	size = size > 0.f ? size * 1.0001f : 1.f;
+
+	// particles are still sorted from the last build, so the sort mostly checks the order
+	// every range is sorted on its own, then neighbouring ranges are merged pairwise, keys are
+	// unique (slot) so the order is the same for any number of ranges
+	float toCell = (float)(1 << MAX_DEPTH) / size;
+	float lastCell = (float)((1 << MAX_DEPTH) - 1);
+	keys.resize(count);
+	mergedKeys.resize(count);
+	forRanges([&](int r)
+	{
+		for (int i = edges[r]; i < edges[r + 1]; i++)
+		{
+			glm::vec3 cell = glm::clamp((glm::vec3(bodies[i]) - lo) * toCell, 0.f, lastCell);
+			keys[i] = std::make_pair(mortonCode((uint32_t)cell.x, (uint32_t)cell.y, (uint32_t)cell.z), i);
+		}
+		std::sort(keys.begin() + edges[r], keys.begin() + edges[r + 1]);
+	});
+	for (int ranges = rangeCount; ranges > 1; ranges = (ranges + 1) / 2)
+	{
+		int pairs = (ranges + 1) / 2;
+		auto mergePairs = [&](int begin, int end)
+		{
+			for (int m = begin; m < end; m++)
+			{
+				int first = edges[2 * m];
+				int middle = edges[std::min(2 * m + 1, ranges)];
+				int last = edges[std::min(2 * m + 2, ranges)];
+				std::merge(keys.begin() + first, keys.begin() + middle, keys.begin() + middle, keys.begin() + last,
+					mergedKeys.begin() + first);
+			}
+		};
+		jobs->parallelFor(pairs, 1, mergePairs);
+		keys.swap(mergedKeys);
+		for (int m = 0; m < pairs; m++) edges[m] = edges[2 * m];
+		edges[pairs] = count;
+	}
+
+	sortedBodies.resize(count);
+	sortedExactPositions.resize(count);
+	sortedVelocities.resize(count);
+	sortedIds.resize(count);
+	auto reorder = [this](int begin, int end)
+	{
+		for (int i = begin; i < end; i++)
+		{
+			int from = keys[i].second;
+			sortedBodies[i] = bodies[from];
+			sortedExactPositions[i] = exactPositions[from];
+			sortedVelocities[i] = velocities[from];
+			sortedIds[i] = ids[from];
+		}
+	};
+	if (jobs != NULL) jobs->parallelFor(count, 4096, reorder);
+	else reorder(0, count);
+	bodies.swap(sortedBodies);
+	exactPositions.swap(sortedExactPositions);
+	velocities.swap(sortedVelocities);
+	ids.swap(sortedIds);
+	auto updateSlots = [this](int begin, int end)
+	{
+		for (int i = begin; i < end; i++) slots[ids[i]] = i;
+	};
+	if (jobs != NULL) jobs->parallelFor(count, 4096, updateSlots);
+	else updateSlots(0, count);
+
+	groups.clear();
+	buildNode(0, count, 0, lo, size, false);
+}
+
+int NBodySystem::buildNode(int first, int count, int depth, const glm::vec3& cellMin, float cellSize, bool grouped)
+{
+	int idx = (int)nodes.size();
+	nodes.push_back(Node());
+
+	// the largest cells of at most GROUP_SIZE particles (or leaves above it) share one walk
+	bool leaf = count <= LEAF_SIZE || depth == MAX_DEPTH;
+	if (!grouped && (count <= GROUP_SIZE || leaf))
+	{
+		groups.push_back(idx);
+		grouped = true;
+	}
+
+	if (!leaf)
+	{
+		// children are the runs of particles with the same 3 key bits below this depth
+		int shift = 3 * (MAX_DEPTH - 1 - depth);
+		float childSize = cellSize * 0.5f;
+		int begin = first;
+		while (begin < first + count)
+		{
+			int octant = (int)(keys[begin].first >> shift) & 7;
+			int end = begin + 1;
+			while (end < first + count && ((int)(keys[end].first >> shift) & 7) == octant) end++;
+			glm::vec3 childMin = cellMin + childSize * glm::vec3((float)(octant & 1), (float)(octant >> 1 & 1), (float)(octant >> 2));
+			buildNode(begin, end - begin, depth + 1, childMin, childSize, grouped);
+			begin = end;
+		}
+	}
+
+	// mass and center of mass, from the children if there are any
+	float gm = 0.f;
+	glm::vec3 moment = glm::vec3(0.f);
+	if (idx + 1 == (int)nodes.size())
+	{
+		for (int i = first; i < first + count; i++)
+		{
+			gm += bodies[i].w;
+			moment += glm::vec3(bodies[i]) * bodies[i].w;
+		}
+	}
+	else
+	{
+		for (int c = idx + 1; c < (int)nodes.size(); c = nodes[c].next)
+		{
+			gm += nodes[c].gm;
+			moment += nodes[c].center * nodes[c].gm;
+		}
+	}
+
+	Node& node = nodes[idx];
+	glm::vec3 cellCenter = cellMin + cellSize * 0.5f;
+	node.gm = gm;
+	node.center = gm > 0.f ? moment / gm : cellCenter;
+	node.first = first;
+	node.count = count;
+	node.next = (int)nodes.size();
+
+	// opened closer than size / theta from the center of mass, widened by the center of mass offset
+	// so a cell is always opened by its own particles (theta <= 1)
+	// a massless cell is never opened, it pulls nothing
+	if (gm <= 0.f) node.openDistance2 = -1.f;
+	else if (openingAngle <= 0.f) node.openDistance2 = INFINITY;
+	else
+	{
+		float openDistance = cellSize / openingAngle + glm::length(node.center - cellCenter);
+		node.openDistance2 = openDistance * openDistance;
+	}
+	return idx;
+}
+
+// sum of the lanes
+#if defined(SIMD_AVX2)
+static inline float horizontalSum(__m256 v)
+{
+	__m128 s = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+#else
+static inline float horizontalSum(__m128 s)
+{
+#endif
+	s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+	s = _mm_add_ss(s, _mm_shuffle_ps(s, s, 1));
+	return _mm_cvtss_f32(s);
+}
+
+void NBodySystem::flushList(Interactions& list, const glm::vec4* group, int groupCount, Accumulator* out)
+{
+	// padding entries are massless and far away, they add nothing
+	const int width = SimdMath::WIDTH;
+	while (list.count % width != 0)
+	{
+		list.x[list.count] = 1e15f;
+		list.y[list.count] = 1e15f;
+		list.z[list.count] = 1e15f;
+		list.gm[list.count] = 0.f;
+		list.count++;
+	}
+
+	// every group particle against the whole list, cells and particles alike
+	// 1 / sqrt is the rsqrt estimate refined by one newton step (~1e-7 relative instead of 12 bits)
+	// coincident points (s2 == 0) are skipped like in getDirectAcceleration
+	for (int k = 0; k < groupCount; k++)
+	{
+#if defined(SIMD_AVX2)
+		__m256 px = _mm256_set1_ps(group[k].x), py = _mm256_set1_ps(group[k].y), pz = _mm256_set1_ps(group[k].z);
+		__m256 eps2 = _mm256_set1_ps(softening2);
+		__m256 half = _mm256_set1_ps(0.5f), threeHalves = _mm256_set1_ps(1.5f);
+		__m256 ax = _mm256_setzero_ps(), ay = _mm256_setzero_ps(), az = _mm256_setzero_ps(), pot = _mm256_setzero_ps();
+		for (int i = 0; i < list.count; i += width)
+		{
+			__m256 dx = _mm256_sub_ps(_mm256_load_ps(&list.x[i]), px);
+			__m256 dy = _mm256_sub_ps(_mm256_load_ps(&list.y[i]), py);
+			__m256 dz = _mm256_sub_ps(_mm256_load_ps(&list.z[i]), pz);
+			__m256 s2 = _mm256_fmadd_ps(dx, dx, _mm256_fmadd_ps(dy, dy, _mm256_fmadd_ps(dz, dz, eps2)));
+			__m256 inv = _mm256_rsqrt_ps(s2);
+			inv = _mm256_mul_ps(inv, _mm256_fnmadd_ps(_mm256_mul_ps(half, s2), _mm256_mul_ps(inv, inv), threeHalves));
+			inv = _mm256_and_ps(inv, _mm256_cmp_ps(s2, _mm256_setzero_ps(), _CMP_GT_OQ));
+			__m256 gmInv = _mm256_mul_ps(_mm256_load_ps(&list.gm[i]), inv);
+			__m256 f = _mm256_mul_ps(gmInv, _mm256_mul_ps(inv, inv));
+			ax = _mm256_fmadd_ps(dx, f, ax);
+			ay = _mm256_fmadd_ps(dy, f, ay);
+			az = _mm256_fmadd_ps(dz, f, az);
+			pot = _mm256_sub_ps(pot, gmInv);
+		}
+#else
+		__m128 px = _mm_set1_ps(group[k].x), py = _mm_set1_ps(group[k].y), pz = _mm_set1_ps(group[k].z);
+		__m128 eps2 = _mm_set1_ps(softening2);
+		__m128 half = _mm_set1_ps(0.5f), threeHalves = _mm_set1_ps(1.5f);
+		__m128 ax = _mm_setzero_ps(), ay = _mm_setzero_ps(), az = _mm_setzero_ps(), pot = _mm_setzero_ps();
+		for (int i = 0; i < list.count; i += width)
+		{
+			__m128 dx = _mm_sub_ps(_mm_load_ps(&list.x[i]), px);
+			__m128 dy = _mm_sub_ps(_mm_load_ps(&list.y[i]), py);
+			__m128 dz = _mm_sub_ps(_mm_load_ps(&list.z[i]), pz);
+			__m128 s2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_add_ps(_mm_mul_ps(dz, dz), eps2));
+			__m128 inv = _mm_rsqrt_ps(s2);
+			inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, s2), _mm_mul_ps(inv, inv))));
+			inv = _mm_and_ps(inv, _mm_cmpgt_ps(s2, _mm_setzero_ps()));
+			__m128 gmInv = _mm_mul_ps(_mm_load_ps(&list.gm[i]), inv);
+			__m128 f = _mm_mul_ps(gmInv, _mm_mul_ps(inv, inv));
+			ax = _mm_add_ps(ax, _mm_mul_ps(dx, f));
+			ay = _mm_add_ps(ay, _mm_mul_ps(dy, f));
+			az = _mm_add_ps(az, _mm_mul_ps(dz, f));
+			pot = _mm_sub_ps(pot, gmInv);
+		}
+#endif
+		out[k].acceleration += glm::vec3(horizontalSum(ax), horizontalSum(ay), horizontalSum(az));
+		out[k].potential += horizontalSum(pot);
+	}
+	list.total += (long long)list.count * groupCount;
+	list.count = 0;
+}
+
+void NBodySystem::walkGroups(int begin, int end)
+{
+	const Node* n = nodes.data();
+	const glm::vec4* b = bodies.data();
+	int nodeCount = (int)nodes.size();
+	Interactions list;
+	list.count = 0;
+	list.total = 0;
+	Accumulator sums[GROUP_SIZE];
+
+	for (int g = begin; g < end; g++)
+	for (int first = n[groups[g]].first; first < n[groups[g]].first + n[groups[g]].count; first += GROUP_SIZE)
+	{
+		// a leaf of coincident particles at MAX_DEPTH can hold more than a group
+		const glm::vec4* p = b + first;
+		int groupCount = std::min(GROUP_SIZE, n[groups[g]].first + n[groups[g]].count - first);
+		glm::vec3 lo = glm::vec3(p[0]);
+		glm::vec3 hi = lo;
+		for (int k = 0; k < groupCount; k++)
+		{
+			lo = glm::min(lo, glm::vec3(p[k]));
+			hi = glm::max(hi, glm::vec3(p[k]));
+			sums[k].acceleration = glm::vec3(0.f);
+			sums[k].potential = 0.f;
+		}
+
+		// one walk for the whole group, a cell is taken as one mass if it is far enough from every
+		// particle of the group (the closest point of their bounds)
+		int idx = 0;
+		while (idx < nodeCount)
+		{
+			const Node& node = n[idx];
+			if (node.gm <= 0.f)
+			{
+				idx = node.next;
+				continue;
+			}
+			glm::vec3 d = glm::clamp(node.center, lo, hi) - node.center;
+			bool leaf = node.next == idx + 1;
+			if (glm::dot(d, d) > node.openDistance2)
+			{
+				list.x[list.count] = node.center.x;
+				list.y[list.count] = node.center.y;
+				list.z[list.count] = node.center.z;
+				list.gm[list.count] = node.gm;
+				if (++list.count == LIST_SIZE) flushList(list, p, groupCount, sums);
+				idx = node.next;
+			}
+			else if (leaf)
+			{
+				// includes the group's own particles, their self term is removed below
+				for (int j = node.first; j < node.first + node.count; j++)
+				{
+					list.x[list.count] = b[j].x;
+					list.y[list.count] = b[j].y;
+					list.z[list.count] = b[j].z;
+					list.gm[list.count] = b[j].w;
+					if (++list.count == LIST_SIZE) flushList(list, p, groupCount, sums);
+				}
+				idx = node.next;
+			}
+			else
+			{
+				idx++;
+			}
+		}
+		if (list.count > 0) flushList(list, p, groupCount, sums);
+
+		for (int k = 0; k < groupCount; k++)
+		{
+			glm::vec3 position = glm::vec3(p[k]);
+			glm::vec3 acc = sums[k].acceleration;
+			float pot = sums[k].potential;
+			if (softening2 > 0.f) pot += p[k].w / sqrtf(softening2);
+
+			// every pair is counted by both particles, the attractors only by this one
+			pot *= 0.5f;
+			for (int a = 0; a < attractorPositions.size(); a++)
+			{
+				glm::vec3 d = glm::vec3(attractorPositions[a]) - position;
+				float s2 = glm::dot(d, d) + softening2;
+				if (s2 <= 0.f) continue;
+				float inv = 1.f / sqrtf(s2);
+				float gmInv = attractorPositions[a].w * inv;
+				acc += d * (gmInv * inv * inv);
+				pot -= gmInv;
+			}
+			accelerations[first + k] = acc;
+			potentials[first + k] = pot;
+		}
+	}
+	interactions += list.total;
+}
+
+glm::vec3 NBodySystem::getDirectAcceleration(int idx)
+{
+	int slot = slots[idx];
+	glm::vec3 p = glm::vec3(bodies[slot]);
+	glm::dvec3 acc = glm::dvec3(0.0);
+	for (int j = 0; j < count; j++)
+	{
+		if (j == slot) continue;
+		glm::dvec3 d = glm::dvec3(glm::vec3(bodies[j]) - p);
+		double s2 = glm::dot(d, d) + softening2;
+		if (s2 <= 0.0) continue;
+		acc += d * (bodies[j].w / (s2 * sqrt(s2)));
+	}
+	for (int a = 0; a < attractorPositions.size(); a++)
+	{
+		glm::dvec3 d = glm::dvec3(glm::vec3(attractorPositions[a]) - p);
+		double s2 = glm::dot(d, d) + softening2;
+		if (s2 <= 0.0) continue;
+		acc += d * (attractorPositions[a].w / (s2 * sqrt(s2)));
+	}
+	return glm::vec3(acc);
+}
+
+double NBodySystem::getEnergy()
+{
+	// massive particles weighted by gm, test particles only count when there is no mass at all
+	// (their specific energies are conserved on their own then)
+	double total = 0.0;
+	double massless = 0.0;
+	bool massive = false;
+	for (int i = 0; i < count; i++)
+	{
+		double e = 0.5 * glm::dot(velocities[i], velocities[i]) + potentials[i];
+		total += bodies[i].w * e;
+		massless += e;
+		massive |= bodies[i].w > 0.f;
+	}
+	return massive ? total : massless;
+}
+
+void NBodySystem::writePositions(JobSystem* jobs)
+{
+	auto write = [this](int begin, int end)
+	{
+		for (int i = begin; i < end; i++) positions[ids[i]] = glm::vec3(bodies[i]);
+	};
+	if (jobs != NULL) jobs->parallelFor(count, 4096, write);
+	else write(0, count);
+}
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <atomic>
+#include <stdint.h>
+#include <vector>
+
+class JobSystem;
+class OrbitSystem;
+
+// gravity for bodies that move freely instead of on an analytic orbit (asteroids, debris...)
+// particles attract each other through a barnes hut octree and are attracted by a few analytic
+// attractors (sun, planets of the orbit system) which they don't move in return
+// steps are symplectic: leapfrog (kick drift kick) or yoshida's 4th order composition of three
+// leapfrog steps, attractors move linearly from their last to their new position within a step
+// the tree is rebuilt on every force evaluation, particles are sorted by the morton code of their
+// position (ranges in parallel, then merged) and kept in that order, nodes are stored depth first
+// with the index after their subtree so a walk is a loop without a stack that either opens a node
+// (next node) or takes its monopole and skips the subtree
+// neighbouring particles share one walk that collects cells and particles into an interaction
+// list, the list is then summed for each of them with simd without any branches, groups are
+// walked in parallel
+class NBodySystem
+{
+public:
+
+	enum Integrator { LEAPFROG, YOSHIDA4 };
+
+	static const int LEAF_SIZE = 8;			// max particles per leaf
+	static const int MAX_DEPTH = 21;		// morton code bits per axis
+	static const int GROUP_SIZE = 64;		// particles sharing one tree walk
+	static const int LIST_SIZE = 1024;		// interaction list entries evaluated at once
+	static const int MAX_RANGES = 64;		// particle ranges of a parallel tree build
+
+	// gm is the gravitational parameter (G * mass) in scene units, 0 = test particle that only
+	// feels gravity, orbitIdx is the orbit system body the particle moves instead of (-1 = none)
+	int addParticle(const glm::vec3& position, const glm::vec3& velocity, float gm, int orbitIdx = -1);
+	void clear();
+	void reserve(int particleCount);
+	int getParticleCount();
+
+	// analytic attractor at rotation * position of orbit system body orbitIdx (-1 = fixed at the origin)
+	int addAttractor(int orbitIdx, const glm::mat3& rotation, float gm);
+	int getAttractorCount();
+
+	// attractors jump to the current orbit system positions instead of moving there (start, seek)
+	void syncAttractors(OrbitSystem& orbits);
+
+	void setOpeningAngle(float theta);		// cell size / distance below which a cell is one mass, 0 = every pair, at most 1
+	void setSoftening(float length);		// plummer softening, keeps close encounters finite
+	void setIntegrator(Integrator integrator);
+	static const char* getIntegratorName(Integrator integrator);
+
+	// advance by seconds, attractors move to the current orbit system positions
+	void step(OrbitSystem& orbits, double seconds, JobSystem* jobs = NULL);
+
+	// same with attractors that stay where they are
+	void step(double seconds, JobSystem* jobs = NULL);
+
+	// tree accelerations and potentials of the current positions
+	void computeForces(JobSystem* jobs = NULL);
+
+	// acceleration of a particle from every other particle and the attractors, O(n) (checks)
+	glm::vec3 getDirectAcceleration(int idx);
+
+	// G * total energy (kinetic + potential, particles weighted by gm), from the last force evaluation
+	// conserved up to integration and tree errors while the attractors don't move
+	double getEnergy();
+
+	// by particle index
+	const glm::vec3* getPositions();
+	glm::vec3 getVelocity(int idx);
+	glm::vec3 getAcceleration(int idx);		// of the last force evaluation
+	const int* getOrbitIndices();
+
+	int getNodeCount();
+	long long getInteractionCount();		// particle and cell interactions of the last force evaluation
+
+private:
+
+	struct Node
+	{
+		glm::vec3 center;		// center of mass
+		float gm;
+		float openDistance2;	// taken as one mass beyond this squared distance from the center
+		int next;				// first node after the subtree, a leaf if it is the next node
+		int first;				// particle slots [first, first + count)
+		int count;
+	};
+
+	struct Attractor
+	{
+		int orbitIdx;
+		glm::mat3 rotation;
+		float gm;
+		glm::vec3 start;		// position at the start and end of the current step
+		glm::vec3 end;
+	};
+
+	// walk scratch, on the stack of the walking thread
+	struct Interactions
+	{
+		alignas(32) float x[LIST_SIZE];
+		alignas(32) float y[LIST_SIZE];
+		alignas(32) float z[LIST_SIZE];
+		alignas(32) float gm[LIST_SIZE];
+		int count;
+		long long total;
+	};
+
+	struct Accumulator
+	{
+		glm::vec3 acceleration;
+		float potential;
+	};
+
+	int count = 0;
+	float openingAngle = 0.5f;
+	float softening2 = 0.f;
+	Integrator integrator = LEAPFROG;
+	bool forcesValid = false;		// accelerations belong to the current positions
+
+	// particles in tree order (slots), integrated in double precision (steps far from the origin are
+	// below a float's resolution), float position and gm together for the walk
+	std::vector<glm::vec4> bodies;
+	std::vector<glm::dvec3> exactPositions;
+	std::vector<glm::dvec3> velocities;
+	std::vector<glm::vec3> accelerations;
+	std::vector<float> potentials;			// attractors plus half of the pairs, so the sum counts every pair once
+	std::vector<int> ids;					// particle index of every slot
+	std::vector<int> slots;					// slot of every particle index
+	std::vector<int> orbitIndices;			// by particle index
+	std::vector<glm::vec3> positions;		// by particle index, written after every step
+
+	// build scratch
+	std::vector<std::pair<uint64_t, int>> keys;		// morton code, slot
+	std::vector<std::pair<uint64_t, int>> mergedKeys;	// sorted ranges merged pairwise
+	std::vector<glm::vec4> sortedBodies;
+	std::vector<glm::dvec3> sortedExactPositions;
+	std::vector<glm::dvec3> sortedVelocities;
+	std::vector<int> sortedIds;
+	std::vector<Node> nodes;
+	std::vector<int> groups;				// nodes whose particles share a walk, covering every slot once
+
+	std::vector<Attractor> attractors;
+	std::vector<glm::vec4> attractorPositions;		// xyz, gm at the time of the force evaluation
+	float attractorTime = 1.f;						// fraction of the step between start and end
+
+	std::atomic<long long> interactions{ 0 };
+
+	void integrate(double seconds, JobSystem* jobs);
+	void leapfrog(double seconds, float startTime, float endTime, JobSystem* jobs);
+	void buildTree(JobSystem* jobs);
+	int buildNode(int first, int count, int depth, const glm::vec3& cellMin, float cellSize, bool grouped);
+	void walkGroups(int begin, int end);
+	void flushList(Interactions& list, const glm::vec4* group, int groupCount, Accumulator* out);
+	void writePositions(JobSystem* jobs);
+	static uint64_t mortonCode(uint32_t x, uint32_t y, uint32_t z);
+};
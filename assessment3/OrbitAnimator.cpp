@@ -25,6 +25,7 @@ OrbitAnimator::OrbitAnimator(float orbitalDelay, float orbitalDays, float ovalRa
 
 void OrbitAnimator::setOrbitalDays(float days) 
 { 
+	rebaseEpoch();
 	orbital_days = days; 
 	initDelays();
 }
@@ -32,20 +33,33 @@ float OrbitAnimator::getOrbitalDays() { return orbital_days; }
 
 void OrbitAnimator::setOrbitalDelay(float seconds)
 { 
+	rebaseEpoch();
 	orbital_delay = seconds; 
 	initDelays();
 }
 float OrbitAnimator::getOrbitalDelay() { return orbital_delay; }
 
-void OrbitAnimator::setOrbitAngle(float degrees) { orbit_angle = degrees; }
+void OrbitAnimator::setOrbitAngle(float degrees)
+{
+	rebaseEpoch();
+	orbit_angle = degrees;
+	epoch_orbit_angle = degrees;
+}
 float OrbitAnimator::getOrbitAngle() { return orbit_angle; }
 
 void OrbitAnimator::addOrbitAngle(float degress)
 {
+	rebaseEpoch();
 	orbit_angle += degress;
+	epoch_orbit_angle += degress;
 }
 
-void OrbitAnimator::setSpinAngle(float degrees) { spin_angle = degrees; }
+void OrbitAnimator::setSpinAngle(float degrees)
+{
+	rebaseEpoch();
+	spin_angle = degrees;
+	epoch_spin_angle = degrees;
+}
 float OrbitAnimator::getSpinAngle() { return spin_angle; }
 
 void OrbitAnimator::setOvalRatio(float ratio) { oval_ratio = ratio; }
@@ -59,25 +73,56 @@ float OrbitAnimator::getOrbitTilt() { return orbit_tilt; }
 
 void OrbitAnimator::setOrbitPosition(float x, float y, float z)
 {
-	orbit_position[0] = x;
-	orbit_position[1] = y;
-	orbit_position[2] = z;
+	orbit_position = glm::vec3(x, y, z);
 }
-std::vector<float> OrbitAnimator::getOrbitPosition() { return orbit_position; }
+const glm::vec3& OrbitAnimator::getOrbitPosition() { return orbit_position; }
 
 void OrbitAnimator::animate(float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force)
 {
-	std::vector<float> orbit_origin{ 0.f,0.f,0.f };
+	glm::vec3 orbit_origin = glm::vec3(0.f);
 	OrbitAnimator::updateSpin(current_ms_time, spin_angle_precision);
 	OrbitAnimator::updateOrbit(orbit_origin, current_ms_time, orbit_angle_precision, force);
 }
 
-void OrbitAnimator::animate(std::vector<float> orbit_origin, float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force)
+void OrbitAnimator::animate(const glm::vec3& orbit_origin, float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force)
 {
 	OrbitAnimator::updateSpin(current_ms_time, spin_angle_precision);
 	OrbitAnimator::updateOrbit(orbit_origin, current_ms_time, orbit_angle_precision, force);
 }
 
+void OrbitAnimator::evaluate(double seconds)
+{
+	glm::vec3 orbit_origin = glm::vec3(0.f);
+	OrbitAnimator::evaluate(orbit_origin, seconds);
+}
+
+void OrbitAnimator::evaluate(const glm::vec3& orbit_origin, double seconds)
+{
+	double elapsed = seconds - epoch_seconds;
+	spin_angle = (float)angleAt(epoch_spin_angle, elapsed, delay_per_day);
+	orbit_angle = (float)angleAt(epoch_orbit_angle, elapsed, orbital_delay);
+	evaluated_seconds = seconds;
+	updateOrbitPosition(orbit_origin);
+}
+
+double OrbitAnimator::angleAt(double epoch_angle, double elapsed_seconds, double period)
+{
+	// only the fraction of the current revolution matters, keeps precision for long runs
+	double revolutions = elapsed_seconds / period;
+	double angle = epoch_angle + (revolutions - floor(revolutions)) * 360.0;
+	angle = fmod(angle, 360.0);
+	if (angle < 0.0) angle += 360.0;
+	return angle;
+}
+
+void OrbitAnimator::rebaseEpoch()
+{
+	double elapsed = evaluated_seconds - epoch_seconds;
+	epoch_spin_angle = angleAt(epoch_spin_angle, elapsed, delay_per_day);
+	epoch_orbit_angle = angleAt(epoch_orbit_angle, elapsed, orbital_delay);
+	epoch_seconds = evaluated_seconds;
+}
+
 void OrbitAnimator::initDelays()
 {
 	delay_per_orbit_angle = orbital_delay / 360;	// delay for every orbit angle change in seconds
@@ -90,20 +135,25 @@ void OrbitAnimator::updateSpin(float current_ms_time, unsigned int precision)
 	stepAngle(current_ms_time, &previous_spin_timestamp, delay_per_spin_angle, precision, &spin_angle);
 }
 
-void OrbitAnimator::updateOrbit(std::vector<float> orbit_origin, float current_ms_time, unsigned int precision, bool force)
+void OrbitAnimator::updateOrbit(const glm::vec3& orbit_origin, float current_ms_time, unsigned int precision, bool force)
 {
 	if (stepAngle(current_ms_time, &previous_orbit_timestamp, delay_per_orbit_angle, precision, &orbit_angle) || force)
 	{
-		//float x = (sin(DEG2RAD(orbit_angle)) * orbit_radius * oval_ratio);
-		//float y = (tan(DEG2RAD(orbit_tilt)) * x);
-		float diag_x = sin(DEG2RAD(orbit_angle)) * orbit_radius * oval_ratio;
-		float x = cos(DEG2RAD(orbit_tilt)) * diag_x;
-		float y = sin(DEG2RAD(orbit_tilt)) * diag_x;
-		float z = (cos(DEG2RAD(orbit_angle)) * orbit_radius);
-		setOrbitPosition(x + orbit_origin[0], y + orbit_origin[1], z + orbit_origin[2]);
+		updateOrbitPosition(orbit_origin);
 	}
 }
 
+void OrbitAnimator::updateOrbitPosition(const glm::vec3& orbit_origin)
+{
+	//float x = (sin(DEG2RAD(orbit_angle)) * orbit_radius * oval_ratio);
+	//float y = (tan(DEG2RAD(orbit_tilt)) * x);
+	float diag_x = sin(DEG2RAD(orbit_angle)) * orbit_radius * oval_ratio;
+	float x = cos(DEG2RAD(orbit_tilt)) * diag_x;
+	float y = sin(DEG2RAD(orbit_tilt)) * diag_x;
+	float z = (cos(DEG2RAD(orbit_angle)) * orbit_radius);
+	setOrbitPosition(x + orbit_origin[0], y + orbit_origin[1], z + orbit_origin[2]);
+}
+
 bool OrbitAnimator::stepAngle(float current_ms_time, float* previous_timestamp, float s_delay_per_angle, unsigned int precision, float* angle)
 {
 	// elapsed time in milliseconds
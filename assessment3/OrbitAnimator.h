@@ -4,7 +4,7 @@
 #include <cmath>
 #include <math.h>
 #define DEG2RAD(n)	n*(M_PI/180)
-#include <vector>
+#include <glm/glm/glm.hpp>
 
 
 
@@ -37,7 +37,7 @@ public:
 	void addOrbitAngle(float degress);
 	void setOrbitAngle(float degrees);
 
-	std::vector<float> getOrbitPosition();
+	const glm::vec3& getOrbitPosition();
 	void setOrbitPosition(float x, float y, float z);
 
 	// Cosmetics
@@ -55,7 +55,12 @@ public:
 	// Public Methods
 
 	void animate(float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force = false);
-	void animate(std::vector<float> orbit_origin, float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force = false);
+	void animate(const glm::vec3& orbit_origin, float current_ms_time, unsigned int spin_angle_precision, unsigned int orbit_angle_precision, bool force = false);
+
+	// stateless evaluation, angles are computed directly from simulation time in seconds
+	// any time can be evaluated in O(1) and in any order (seeking, time warp, one body per thread)
+	void evaluate(double seconds);
+	void evaluate(const glm::vec3& orbit_origin, double seconds);
 
 private:
 
@@ -77,7 +82,14 @@ private:
 	// year cycle
 	float orbit_angle = 0.f;				// orbiting angle [1,360)
 	float previous_orbit_timestamp = 0.f;		// store previous orbit angle chnage timestamp in seconds
-	std::vector<float> orbit_position{ 0.f, 0.f, 0.f }; // x,y,z (width, height, depth)
+	glm::vec3 orbit_position = glm::vec3(0.f); // x,y,z (width, height, depth)
+
+	// closed form state, angles at epoch_seconds advance linearly with their period
+	// setters rebase the epoch to the last evaluated time so changes don't make bodies jump
+	double epoch_seconds = 0.0;
+	double epoch_spin_angle = 0.0;
+	double epoch_orbit_angle = 0.0;
+	double evaluated_seconds = 0.0;
 
 	// cosmestics
 	float oval_ratio = 1.f;					// scale of major axis over minor axis
@@ -94,6 +106,13 @@ private:
 	// calculate new spin angle
 	void updateSpin(float current_ms_time, unsigned int precision);
 	// calculate new orbit angle and positions
-	void updateOrbit(std::vector<float> orbit_origin, float current_ms_time, unsigned int precision, bool force = false);
+	void updateOrbit(const glm::vec3& orbit_origin, float current_ms_time, unsigned int precision, bool force = false);
+	// calculate positions from current orbit angle
+	void updateOrbitPosition(const glm::vec3& orbit_origin);
+
+	// angle in [0,360) at given time, period is seconds per full 360 degrees
+	static double angleAt(double epoch_angle, double elapsed_seconds, double period);
+	// move epoch to last evaluated time keeping current angles
+	void rebaseEpoch();
 	
 };
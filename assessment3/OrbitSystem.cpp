@@ -0,0 +1,470 @@
+#define _USE_MATH_DEFINES
+#include "OrbitSystem.h"
+#include "JobSystem.h"
+#include "SimdMath.h"
+#include <cmath>
+
+int OrbitSystem::addBody(float orbitalDelay, float orbitalDays, float ovalRatio, float orbitRadius, float orbitTilt,
+	float eccentricity, float periapsis)
+{
+	int idx = count++;
+	this->orbitalDelay.push_back(orbitalDelay);
+	this->orbitalDays.push_back(orbitalDays);
+	this->ovalRatio.push_back(ovalRatio);
+	this->orbitRadius.push_back(orbitRadius);
+	this->orbitTilt.push_back(orbitTilt);
+	this->periapsis.push_back(periapsis);
+
+	// simd loops always run full lanes, padding lanes are evaluated but never read
+	int padded = (count + SimdMath::WIDTH - 1) / SimdMath::WIDTH * SimdMath::WIDTH;
+	invOrbitPeriod.resize(padded, 0.0);
+	invSpinPeriod.resize(padded, 0.0);
+	axisX.resize(padded, 0.f);
+	axisY.resize(padded, 0.f);
+	axisZ.resize(padded, 0.f);
+	this->eccentricity.resize(padded, 0.f);
+	periCos.resize(padded, 1.f);
+	periSin.resize(padded, 0.f);
+	minorCos.resize(padded, 1.f);
+	minorSin.resize(padded, 0.f);
+	epochSeconds.resize(padded, evaluatedSeconds);
+	epochSpinAngle.resize(padded, 0.0);
+	epochOrbitAngle.resize(padded, 0.0);
+	spinAngle.resize(padded, 0.f);
+	orbitAngle.resize(padded, 0.f);
+	orbitTurns.resize(padded, 0.f);
+	positionX.resize(padded, 0.f);
+	positionY.resize(padded, 0.f);
+	positionZ.resize(padded, 0.f);
+	positions.resize(count, glm::vec3(0.f));
+	exactSeconds.resize(padded, evaluatedSeconds);
+	exactSpinAngle.resize(padded, 0.f);
+	exactOrbitAngle.resize(padded, 0.f);
+	velocityX.resize(padded, 0.f);
+	velocityY.resize(padded, 0.f);
+	velocityZ.resize(padded, 0.f);
+	spinSpeed.resize(padded, 0.f);
+	orbitSpeed.resize(padded, 0.f);
+	changed.resize(count, 0);
+
+	epochSeconds[idx] = evaluatedSeconds;
+	this->eccentricity[idx] = eccentricity;
+	updateDerived(idx);
+	markChanged(idx);
+	return idx;
+}
+
+void OrbitSystem::clear()
+{
+	count = 0;
+	orbitalDelay.clear();
+	orbitalDays.clear();
+	ovalRatio.clear();
+	orbitRadius.clear();
+	orbitTilt.clear();
+	periapsis.clear();
+	invOrbitPeriod.clear();
+	invSpinPeriod.clear();
+	axisX.clear();
+	axisY.clear();
+	axisZ.clear();
+	eccentricity.clear();
+	periCos.clear();
+	periSin.clear();
+	minorCos.clear();
+	minorSin.clear();
+	epochSeconds.clear();
+	epochSpinAngle.clear();
+	epochOrbitAngle.clear();
+	spinAngle.clear();
+	orbitAngle.clear();
+	orbitTurns.clear();
+	positionX.clear();
+	positionY.clear();
+	positionZ.clear();
+	positions.clear();
+	exactSeconds.clear();
+	exactSpinAngle.clear();
+	exactOrbitAngle.clear();
+	velocityX.clear();
+	velocityY.clear();
+	velocityZ.clear();
+	spinSpeed.clear();
+	orbitSpeed.clear();
+	changedBodies.clear();
+	changed.clear();
+}
+
+void OrbitSystem::reserve(int bodyCount)
+{
+	int padded = (bodyCount + SimdMath::WIDTH - 1) / SimdMath::WIDTH * SimdMath::WIDTH;
+	orbitalDelay.reserve(bodyCount);
+	orbitalDays.reserve(bodyCount);
+	ovalRatio.reserve(bodyCount);
+	orbitRadius.reserve(bodyCount);
+	orbitTilt.reserve(bodyCount);
+	periapsis.reserve(bodyCount);
+	invOrbitPeriod.reserve(padded);
+	invSpinPeriod.reserve(padded);
+	axisX.reserve(padded);
+	axisY.reserve(padded);
+	axisZ.reserve(padded);
+	eccentricity.reserve(padded);
+	periCos.reserve(padded);
+	periSin.reserve(padded);
+	minorCos.reserve(padded);
+	minorSin.reserve(padded);
+	epochSeconds.reserve(padded);
+	epochSpinAngle.reserve(padded);
+	epochOrbitAngle.reserve(padded);
+	spinAngle.reserve(padded);
+	orbitAngle.reserve(padded);
+	orbitTurns.reserve(padded);
+	positionX.reserve(padded);
+	positionY.reserve(padded);
+	positionZ.reserve(padded);
+	positions.reserve(bodyCount);
+	exactSeconds.reserve(padded);
+	exactSpinAngle.reserve(padded);
+	exactOrbitAngle.reserve(padded);
+	velocityX.reserve(padded);
+	velocityY.reserve(padded);
+	velocityZ.reserve(padded);
+	spinSpeed.reserve(padded);
+	orbitSpeed.reserve(padded);
+	changedBodies.reserve(bodyCount);
+	changed.reserve(bodyCount);
+	exactList.reserve(bodyCount);
+}
+
+int OrbitSystem::getBodyCount() { return count; }
+
+void OrbitSystem::setOrbitalDelay(int idx, float seconds)
+{
+	rebaseEpoch(idx);
+	orbitalDelay[idx] = seconds;
+	updateDerived(idx);
+	markChanged(idx);
+}
+
+void OrbitSystem::setOrbitalDays(int idx, float days)
+{
+	rebaseEpoch(idx);
+	orbitalDays[idx] = days;
+	updateDerived(idx);
+	markChanged(idx);
+}
+
+void OrbitSystem::setSpinAngle(int idx, float degrees)
+{
+	rebaseEpoch(idx);
+	epochSpinAngle[idx] = degrees;
+	spinAngle[idx] = degrees;
+	markChanged(idx);
+}
+
+void OrbitSystem::setOrbitAngle(int idx, float degrees)
+{
+	rebaseEpoch(idx);
+	epochOrbitAngle[idx] = degrees;
+	orbitAngle[idx] = degrees;
+	markChanged(idx);
+}
+
+void OrbitSystem::markChanged(int idx)
+{
+	if (changed[idx]) return;
+	changed[idx] = 1;
+	changedBodies.push_back(idx);
+}
+
+float OrbitSystem::getOrbitRadius(int idx)
+{
+	return orbitRadius[idx] * (ovalRatio[idx] > 1.f ? ovalRatio[idx] : 1.f) * (1.f + eccentricity[idx]);
+}
+
+float OrbitSystem::getOrbitSpeed(int idx)
+{
+	// acceleration peaks at periapsis with mean motion^2 * radius / (1 - e)^2
+	return (float)(invOrbitPeriod[idx] * 2.0 * M_PI / (1.0 - eccentricity[idx]));
+}
+
+const glm::vec3* OrbitSystem::getPositions() { return positions.data(); }
+const float* OrbitSystem::getSpinAngles() { return spinAngle.data(); }
+const float* OrbitSystem::getOrbitAngles() { return orbitAngle.data(); }
+glm::vec3 OrbitSystem::getVelocity(int idx) { return glm::vec3(velocityX[idx], velocityY[idx], velocityZ[idx]); }
+
+void OrbitSystem::setPositions(const int* indices, const glm::vec3* positions, int count)
+{
+	for (int n = 0; n < count; n++) this->positions[indices[n]] = positions[n];
+}
+
+void OrbitSystem::updateDerived(int idx)
+{
+	// same relations as OrbitAnimator::initDelays, a day lasts orbital delay / orbital days
+	invOrbitPeriod[idx] = 1.0 / orbitalDelay[idx];
+	invSpinPeriod[idx] = orbitalDays[idx] / (double)orbitalDelay[idx];
+	spinSpeed[idx] = (float)(invSpinPeriod[idx] * 360.0);
+	orbitSpeed[idx] = (float)(invOrbitPeriod[idx] * 360.0);
+
+	double tilt = orbitTilt[idx] * (M_PI / 180);
+	float axis = orbitRadius[idx] * ovalRatio[idx];
+	axisX[idx] = (float)(cos(tilt) * axis);
+	axisY[idx] = (float)(sin(tilt) * axis);
+	axisZ[idx] = orbitRadius[idx];
+
+	double peri = periapsis[idx] * (M_PI / 180);
+	double minor = sqrt(1.0 - (double)eccentricity[idx] * eccentricity[idx]);
+	periCos[idx] = (float)cos(peri);
+	periSin[idx] = (float)sin(peri);
+	minorCos[idx] = (float)(minor * cos(peri));
+	minorSin[idx] = (float)(minor * sin(peri));
+}
+
+void OrbitSystem::rebaseEpoch(int idx)
+{
+	double elapsed = evaluatedSeconds - epochSeconds[idx];
+	epochSpinAngle[idx] = turnsAt(epochSpinAngle[idx], elapsed, invSpinPeriod[idx]) * 360.0;
+	epochOrbitAngle[idx] = turnsAt(epochOrbitAngle[idx], elapsed, invOrbitPeriod[idx]) * 360.0;
+	epochSeconds[idx] = evaluatedSeconds;
+}
+
+double OrbitSystem::turnsAt(double epochAngle, double elapsedSeconds, double invPeriod)
+{
+	// whole turns dropped while still in double, the float angles only ever hold one revolution
+	double turns = epochAngle / 360.0 + elapsedSeconds * invPeriod;
+	return turns - floor(turns);
+}
+
+void OrbitSystem::evaluate(double seconds, JobSystem* jobs)
+{
+	evaluatedSeconds = seconds;
+	int padded = (int)axisZ.size();
+	if (jobs != NULL)
+	{
+		jobs->parallelFor(padded, 4096, SimdMath::WIDTH, [this](int begin, int end) { evaluateRange(begin, end); });
+	}
+	else
+	{
+		evaluateRange(0, padded);
+	}
+	for (int i = 0; i < changedBodies.size(); i++) changed[changedBodies[i]] = 0;
+	changedBodies.clear();
+}
+
+void OrbitSystem::evaluateScheduled(double seconds, const std::vector<int>& exactBodies, JobSystem* jobs)
+{
+	evaluatedSeconds = seconds;
+
+	// changed bodies can't be extrapolated from their old state, they join the listed ones
+	exactList.clear();
+	for (int i = 0; i < exactBodies.size(); i++)
+	{
+		if (!changed[exactBodies[i]]) exactList.push_back(exactBodies[i]);
+	}
+	for (int i = 0; i < changedBodies.size(); i++)
+	{
+		exactList.push_back(changedBodies[i]);
+		changed[changedBodies[i]] = 0;
+	}
+	changedBodies.clear();
+
+	// everything first, the listed bodies are then overwritten with closed form results
+	if (jobs != NULL)
+	{
+		jobs->parallelFor(count, 4096, [this](int begin, int end) { extrapolateRange(begin, end); });
+		jobs->parallelFor((int)exactList.size(), 1024, SimdMath::WIDTH, [this](int begin, int end) { evaluateList(begin, end); });
+	}
+	else
+	{
+		extrapolateRange(0, count);
+		evaluateList(0, (int)exactList.size());
+	}
+}
+
+void OrbitSystem::evaluateRange(int begin, int end)
+{
+	// angles in double, reduced to a single revolution before dropping to float
+	for (int i = begin; i < end; i++)
+	{
+		double elapsed = evaluatedSeconds - epochSeconds[i];
+		double spinTurns = turnsAt(epochSpinAngle[i], elapsed, invSpinPeriod[i]);
+		double orbitTurnsD = turnsAt(epochOrbitAngle[i], elapsed, invOrbitPeriod[i]);
+		spinAngle[i] = (float)(spinTurns * 360.0);
+		orbitAngle[i] = (float)(orbitTurnsD * 360.0);
+		orbitTurns[i] = (float)orbitTurnsD;
+		exactSeconds[i] = evaluatedSeconds;
+		exactSpinAngle[i] = spinAngle[i];
+		exactOrbitAngle[i] = orbitAngle[i];
+	}
+
+	// eccentric anomaly E from the mean anomaly (plain sin/cos of it when every lane is circular),
+	// in the orbit plane the body is at (cos(E) - e, sqrt(1 - e^2) * sin(E)) along and across the
+	// periapsis, turned by the argument of periapsis into "along" (z axis) and "across" (tilted
+	// x/y axis), velocity is the derivative with dE/dt = mean motion / (1 - e * cos(E))
+#if defined(SIMD_AVX2)
+	const __m256 turnToRadian = _mm256_set1_ps((float)(2.0 * M_PI));
+	const __m256 degreeToRadian = _mm256_set1_ps((float)(M_PI / 180.0));
+	const __m256 one = _mm256_set1_ps(1.f);
+	for (int i = begin; i < end; i += 8)
+	{
+		__m256 turns = _mm256_loadu_ps(&orbitTurns[i]);
+		__m256 e = _mm256_loadu_ps(&eccentricity[i]);
+		__m256 s, c;
+		if (_mm256_movemask_ps(_mm256_cmp_ps(e, _mm256_setzero_ps(), _CMP_GT_OQ)) == 0)
+		{
+			SimdMath::sincos8(_mm256_mul_ps(turns, turnToRadian), s, c);
+		}
+		else
+		{
+			// mean anomaly in [-pi,pi]
+			turns = _mm256_sub_ps(turns, _mm256_and_ps(_mm256_cmp_ps(turns, _mm256_set1_ps(0.5f), _CMP_GT_OQ), one));
+			SimdMath::kepler8(_mm256_mul_ps(turns, turnToRadian), e, s, c);
+		}
+		__m256 pc = _mm256_loadu_ps(&periCos[i]), ps = _mm256_loadu_ps(&periSin[i]);
+		__m256 mc = _mm256_loadu_ps(&minorCos[i]), ms = _mm256_loadu_ps(&minorSin[i]);
+		__m256 p = _mm256_sub_ps(c, e);
+		__m256 along = _mm256_fmsub_ps(p, pc, _mm256_mul_ps(s, ms));
+		__m256 across = _mm256_fmadd_ps(p, ps, _mm256_mul_ps(s, mc));
+		__m256 rate = _mm256_div_ps(_mm256_mul_ps(_mm256_loadu_ps(&orbitSpeed[i]), degreeToRadian), _mm256_fnmadd_ps(e, c, one));
+		__m256 alongV = _mm256_mul_ps(_mm256_fmadd_ps(s, pc, _mm256_mul_ps(c, ms)), _mm256_sub_ps(_mm256_setzero_ps(), rate));
+		__m256 acrossV = _mm256_mul_ps(_mm256_fmsub_ps(c, mc, _mm256_mul_ps(s, ps)), rate);
+
+		__m256 x = _mm256_loadu_ps(&axisX[i]), y = _mm256_loadu_ps(&axisY[i]), z = _mm256_loadu_ps(&axisZ[i]);
+		_mm256_storeu_ps(&positionX[i], _mm256_mul_ps(across, x));
+		_mm256_storeu_ps(&positionY[i], _mm256_mul_ps(across, y));
+		_mm256_storeu_ps(&positionZ[i], _mm256_mul_ps(along, z));
+		_mm256_storeu_ps(&velocityX[i], _mm256_mul_ps(acrossV, x));
+		_mm256_storeu_ps(&velocityY[i], _mm256_mul_ps(acrossV, y));
+		_mm256_storeu_ps(&velocityZ[i], _mm256_mul_ps(alongV, z));
+	}
+#else
+	const __m128 turnToRadian = _mm_set1_ps((float)(2.0 * M_PI));
+	const __m128 degreeToRadian = _mm_set1_ps((float)(M_PI / 180.0));
+	const __m128 one = _mm_set1_ps(1.f);
+	for (int i = begin; i < end; i += 4)
+	{
+		__m128 turns = _mm_loadu_ps(&orbitTurns[i]);
+		__m128 e = _mm_loadu_ps(&eccentricity[i]);
+		__m128 s, c;
+		if (_mm_movemask_ps(_mm_cmpgt_ps(e, _mm_setzero_ps())) == 0)
+		{
+			SimdMath::sincos4(_mm_mul_ps(turns, turnToRadian), s, c);
+		}
+		else
+		{
+			turns = _mm_sub_ps(turns, _mm_and_ps(_mm_cmpgt_ps(turns, _mm_set1_ps(0.5f)), one));
+			SimdMath::kepler4(_mm_mul_ps(turns, turnToRadian), e, s, c);
+		}
+		__m128 pc = _mm_loadu_ps(&periCos[i]), ps = _mm_loadu_ps(&periSin[i]);
+		__m128 mc = _mm_loadu_ps(&minorCos[i]), ms = _mm_loadu_ps(&minorSin[i]);
+		__m128 p = _mm_sub_ps(c, e);
+		__m128 along = _mm_sub_ps(_mm_mul_ps(p, pc), _mm_mul_ps(s, ms));
+		__m128 across = _mm_add_ps(_mm_mul_ps(p, ps), _mm_mul_ps(s, mc));
+		__m128 rate = _mm_div_ps(_mm_mul_ps(_mm_loadu_ps(&orbitSpeed[i]), degreeToRadian), _mm_sub_ps(one, _mm_mul_ps(e, c)));
+		__m128 alongV = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(s, pc), _mm_mul_ps(c, ms)), _mm_sub_ps(_mm_setzero_ps(), rate));
+		__m128 acrossV = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(c, mc), _mm_mul_ps(s, ps)), rate);
+
+		__m128 x = _mm_loadu_ps(&axisX[i]), y = _mm_loadu_ps(&axisY[i]), z = _mm_loadu_ps(&axisZ[i]);
+		_mm_storeu_ps(&positionX[i], _mm_mul_ps(across, x));
+		_mm_storeu_ps(&positionY[i], _mm_mul_ps(across, y));
+		_mm_storeu_ps(&positionZ[i], _mm_mul_ps(along, z));
+		_mm_storeu_ps(&velocityX[i], _mm_mul_ps(acrossV, x));
+		_mm_storeu_ps(&velocityY[i], _mm_mul_ps(acrossV, y));
+		_mm_storeu_ps(&velocityZ[i], _mm_mul_ps(alongV, z));
+	}
+#endif
+
+	for (int i = begin; i < end && i < count; i++)
+	{
+		positions[i] = glm::vec3(positionX[i], positionY[i], positionZ[i]);
+	}
+}
+
+void OrbitSystem::extrapolateRange(int begin, int end)
+{
+	// angles grow linearly with time, only the position leaves the orbit (by 1 - cos of the angle
+	// travelled since the last closed form evaluation)
+	for (int i = begin; i < end; i++)
+	{
+		float elapsed = (float)(evaluatedSeconds - exactSeconds[i]);
+		float spin = exactSpinAngle[i] + spinSpeed[i] * elapsed;
+		float orbit = exactOrbitAngle[i] + orbitSpeed[i] * elapsed;
+		spin -= 360.f * (int)(spin * (1.f / 360.f));
+		orbit -= 360.f * (int)(orbit * (1.f / 360.f));
+		spinAngle[i] = spin < 0.f ? spin + 360.f : spin;
+		orbitAngle[i] = orbit < 0.f ? orbit + 360.f : orbit;
+		positions[i] = glm::vec3(positionX[i] + velocityX[i] * elapsed, positionY[i] + velocityY[i] * elapsed,
+			positionZ[i] + velocityZ[i] * elapsed);
+	}
+}
+
+void OrbitSystem::evaluateList(int begin, int end)
+{
+	// same as evaluateRange on gathered bodies, lanes past the end repeat the last body
+	const int width = SimdMath::WIDTH;
+	for (int first = begin; first < end; first += width)
+	{
+		int lanes[width];
+		float anomalies[width];
+		float eccentricities[width];
+		bool circular = true;
+		for (int l = 0; l < width; l++)
+		{
+			int i = exactList[first + l < end ? first + l : end - 1];
+			lanes[l] = i;
+			double elapsed = evaluatedSeconds - epochSeconds[i];
+			double spinTurns = turnsAt(epochSpinAngle[i], elapsed, invSpinPeriod[i]);
+			double orbitTurnsD = turnsAt(epochOrbitAngle[i], elapsed, invOrbitPeriod[i]);
+			spinAngle[i] = (float)(spinTurns * 360.0);
+			orbitAngle[i] = (float)(orbitTurnsD * 360.0);
+			orbitTurns[i] = (float)orbitTurnsD;
+			exactSeconds[i] = evaluatedSeconds;
+			exactSpinAngle[i] = spinAngle[i];
+			exactOrbitAngle[i] = orbitAngle[i];
+			eccentricities[l] = eccentricity[i];
+			circular &= eccentricities[l] == 0.f;
+			anomalies[l] = (float)((orbitTurnsD > 0.5 ? orbitTurnsD - 1.0 : orbitTurnsD) * (2.0 * M_PI));
+		}
+
+		float sines[width], cosines[width];
+#if defined(SIMD_AVX2)
+		__m256 s, c;
+		if (circular) SimdMath::sincos8(_mm256_loadu_ps(anomalies), s, c);
+		else SimdMath::kepler8(_mm256_loadu_ps(anomalies), _mm256_loadu_ps(eccentricities), s, c);
+		_mm256_storeu_ps(sines, s);
+		_mm256_storeu_ps(cosines, c);
+#else
+		__m128 s, c;
+		if (circular) SimdMath::sincos4(_mm_loadu_ps(anomalies), s, c);
+		else SimdMath::kepler4(_mm_loadu_ps(anomalies), _mm_loadu_ps(eccentricities), s, c);
+		_mm_storeu_ps(sines, s);
+		_mm_storeu_ps(cosines, c);
+#endif
+
+		for (int l = 0; l < width && first + l < end; l++)
+		{
+			storeOrbit(lanes[l], sines[l], cosines[l]);
+		}
+	}
+}
+
+void OrbitSystem::storeOrbit(int i, float sinE, float cosE)
+{
+	// scalar evaluateRange
+	float e = eccentricity[i];
+	float p = cosE - e;
+	float along = p * periCos[i] - sinE * minorSin[i];
+	float across = p * periSin[i] + sinE * minorCos[i];
+	float rate = orbitSpeed[i] * (float)(M_PI / 180.0) / (1.f - e * cosE);
+	float alongV = -(sinE * periCos[i] + cosE * minorSin[i]) * rate;
+	float acrossV = (cosE * minorCos[i] - sinE * periSin[i]) * rate;
+
+	positionX[i] = across * axisX[i];
+	positionY[i] = across * axisY[i];
+	positionZ[i] = along * axisZ[i];
+	velocityX[i] = acrossV * axisX[i];
+	velocityY[i] = acrossV * axisY[i];
+	velocityZ[i] = alongV * axisZ[i];
+	positions[i] = glm::vec3(positionX[i], positionY[i], positionZ[i]);
+}
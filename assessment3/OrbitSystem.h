@@ -0,0 +1,118 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// batch version of OrbitAnimator's closed form evaluation, extended to kepler orbits: the orbit
+// angle is the mean anomaly and the parent sits in a focus of an ellipse with the body's
+// eccentricity, turned by the argument of periapsis (eccentricity 0 is OrbitAnimator's orbit)
+// every orbit parameter is stored in its own contiguous array (structure of arrays) so all
+// bodies are evaluated together, orbit positions use SimdMath::sincos or SimdMath::kepler 4 or 8
+// bodies at a time
+class OrbitSystem
+{
+public:
+
+	// returns index of the new body, same parameters as OrbitAnimator, orbit radius is the semi major
+	// axis, eccentricity in [0,0.99] and argument of periapsis in degrees from the ascending node
+	int addBody(float orbitalDelay, float orbitalDays, float ovalRatio, float orbitRadius, float orbitTilt,
+		float eccentricity = 0.f, float periapsis = 0.f);
+	void clear();
+
+	// reserve room for a number of bodies so adding them doesn't reallocate
+	void reserve(int bodyCount);
+	int getBodyCount();
+
+	// config, changes are rebased to the last evaluated time so bodies don't jump
+	void setOrbitalDelay(int idx, float seconds);
+	void setOrbitalDays(int idx, float days);
+	void setSpinAngle(int idx, float degrees);
+	void setOrbitAngle(int idx, float degrees);
+
+	// evaluate every body at simulation time in seconds, split over the job system if given
+	void evaluate(double seconds, JobSystem* jobs = NULL);
+
+	// evaluate only the listed bodies (and bodies changed since) in closed form, every other body
+	// is extrapolated from its last closed form evaluation: spin and orbit angles exactly, positions
+	// along the orbit tangent (see UpdateScheduler for picking the bodies), the extrapolation is
+	// still a pass over every body, only the closed form work follows the list
+	void evaluateScheduled(double seconds, const std::vector<int>& exactBodies, JobSystem* jobs = NULL);
+
+	// orbit size and speed, for the update scheduler
+	float getOrbitRadius(int idx);			// largest distance from the parent
+	float getOrbitSpeed(int idx);			// radians per second, mean motion / (1 - e) so speed^2 * radius bounds the acceleration
+
+	// results of last evaluate, one per body
+	const glm::vec3* getPositions();
+	const float* getSpinAngles();
+	const float* getOrbitAngles();
+	glm::vec3 getVelocity(int idx);			// orbit tangent of the last closed form evaluation, units per second
+
+	// replace the evaluated positions of the listed bodies (another position source, e.g. an
+	// ephemeris), until the next evaluate
+	void setPositions(const int* indices, const glm::vec3* positions, int count);
+
+private:
+
+	int count = 0;
+	double evaluatedSeconds = 0.0;
+
+	// config
+	std::vector<float> orbitalDelay;		// seconds per orbit
+	std::vector<float> orbitalDays;			// spins per orbit
+	std::vector<float> ovalRatio;
+	std::vector<float> orbitRadius;
+	std::vector<float> orbitTilt;			// degrees
+	std::vector<float> periapsis;			// degrees
+
+	// derived, padded to a multiple of SimdMath::WIDTH
+	std::vector<double> invOrbitPeriod;		// orbits per second
+	std::vector<double> invSpinPeriod;		// spins per second
+	std::vector<float> axisX;				// orbit radius * oval ratio * cos(tilt)
+	std::vector<float> axisY;				// orbit radius * oval ratio * sin(tilt)
+	std::vector<float> axisZ;				// orbit radius
+	std::vector<float> eccentricity;
+	std::vector<float> periCos;				// cos(periapsis)
+	std::vector<float> periSin;
+	std::vector<float> minorCos;			// sqrt(1 - e^2) * cos(periapsis)
+	std::vector<float> minorSin;
+
+	// closed form state, angles in degrees at epochSeconds
+	std::vector<double> epochSeconds;
+	std::vector<double> epochSpinAngle;
+	std::vector<double> epochOrbitAngle;
+
+	// output
+	std::vector<float> spinAngle;
+	std::vector<float> orbitAngle;
+	std::vector<float> orbitTurns;			// orbit angle in revolutions [0,1)
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<glm::vec3> positions;		// packed x,y,z per body
+
+	// state of the last closed form evaluation, extrapolated from by evaluateScheduled
+	// (positionX/Y/Z and orbitTurns also only hold closed form results)
+	std::vector<double> exactSeconds;
+	std::vector<float> exactSpinAngle;
+	std::vector<float> exactOrbitAngle;
+	std::vector<float> velocityX;			// orbit tangent, units per second
+	std::vector<float> velocityY;
+	std::vector<float> velocityZ;
+	std::vector<float> spinSpeed;			// degrees per second
+	std::vector<float> orbitSpeed;			// degrees per second
+	std::vector<int> changedBodies;			// changed since their last closed form evaluation
+	std::vector<unsigned char> changed;
+	std::vector<int> exactList;
+
+	void evaluateRange(int begin, int end);		// padded body range, multiple of SimdMath::WIDTH
+	void storeOrbit(int i, float sinE, float cosE);	// position and velocity from the eccentric anomaly
+	void evaluateList(int begin, int end);		// exactList range
+	void extrapolateRange(int begin, int end);
+	void markChanged(int idx);
+	void updateDerived(int idx);
+	void rebaseEpoch(int idx);
+	static double turnsAt(double epochAngle, double elapsedSeconds, double invPeriod);
+};
@@ -131,49 +131,6 @@ float PlanetMath::getRelativeValue(float a1, float b1, float b2, float r)
 //	return 0.0f;
 //}
 
-float PlanetMath::sumAllAscendingNodes(std::vector<RenderedBody> rb, std::vector<BodyConst> bc, int targetIndex)
-{
-	// if not more parent then do this (base case)
-	if (rb[targetIndex].orbitParentIdx == -1)
-	{
-		return bc[rb[targetIndex].bodyConstantIdx].ascendingNode;
-	}
-	return bc[rb[targetIndex].bodyConstantIdx].ascendingNode + sumAllAscendingNodes(rb, bc, rb[targetIndex].orbitParentIdx);
-}
-
-float PlanetMath::sumAllInclinations(std::vector<RenderedBody> rb, std::vector<BodyConst> bc, int targetIndex)
-{
-	// if not more parent then do this (base case)
-	if (rb[targetIndex].orbitParentIdx == -1)
-	{
-		return bc[rb[targetIndex].bodyConstantIdx].inclination;
-	}
-	return bc[rb[targetIndex].bodyConstantIdx].inclination + sumAllInclinations(rb, bc, rb[targetIndex].orbitParentIdx);
-}
-
-std::vector<float> PlanetMath::sumAllPositions(std::vector<RenderedBody> rb, int targetIndex)
-{
-	// if not more parent then do this (base case)
-	if (rb[targetIndex].orbitParentIdx == -1)
-	{
-		return rb[targetIndex].position;
-	}
-	return elementwiseAdd(rb[targetIndex].position, sumAllPositions(rb, rb[targetIndex].orbitParentIdx));
-}
-
-std::vector<float> PlanetMath::elementwiseAdd(std::vector<float> a, std::vector<float> b)
-{
-	/*if (a.size() != b.size())
-	{
-		throw invali
-	}*/
-	for (int i = 0; i < a.size(); i++)
-	{
-		a[i] += b[i];
-	}
-	return a;
-}
-
 //bool PlanetMath::findEqual(std::vector<float> values, float value)
 //{
 //	for (int j = 0; j < values.size(); j++)
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <glm/glm/glm.hpp>
+#include <cmath>
 #include <vector>
 #include <map>
 #include <string>
@@ -113,26 +115,31 @@ struct BodyConst
 
 	// special config
 	float defaultSpinAngle = 0.f; // spin angle relative to orbit angle
+
+	// kepler elements, the semi major axis is the laid out orbit radius (distances are not to scale)
+	// and inclination and ascending node are the ones above
+	float eccentricity = 0.f;
+	float periapsisArgument = 0.f; // degrees from the ascending node
+	float meanAnomaly = NAN; // orbit angle in degrees at simulation start, NaN = random
+
+	// gravity of physics bodies and their attractors, kg (0 = massless)
+	float mass = 0.f;
+
+	// NAIF id of the body in an spk ephemeris (SpkEphemeris), 0 = none
+	int naifId = 0;
 };
 
+// configuration of a body, read during setup and by keyboard interactions
+// per frame data lives in the scene graph and in the BodyStore components
 struct RenderedBody
 {
-	// === render ===
-	
-	// body orbiting position
-	std::vector<float> position{0.f,0.f,0.f};
-	// final position for model view position calculation
-	std::vector<float> finalPosition{ 0.f,0.f,0.f };
-
-	// body spin rotation
-	float rotation = 0;
 	bool randomSpinAngle = true;
 
 	// special variable to fix nested orbit object (such as moon) not 
 	// following ascending node of parent orbiting object 
 	// the result of not using this variable simply makes moon orbiting an 
 	// empty space while earth is shifted to it's ascending node angle
-	float parentsAscendingNodeSum = 0; // this will be calculated using recursion
+	float parentsAscendingNodeSum = 0; // accumulated down the scene graph during setup
 	float allInclinationSum = 0; // make object stay perpendicular to it's orbit plane after the orbit is inclined
 
 	// animation
@@ -149,6 +156,9 @@ struct RenderedBody
 	int VAOIdx = -1;
 	int textureIdx = -1;
 	bool modelViewed = true;
+	bool transparent = false; // blended, drawn back to front after opaque bodies
+	bool physics = false; // moved by the n-body system, its orbit only gives the start state
+	bool periodOrbit = false; // orbit radius interpolated from its period instead of the sibling layout
 };
 
 class PlanetMath
@@ -161,11 +171,7 @@ public:
 	//float getMarginedRadius(float radiusA, float radiusB, float marginB, float modifierB);
 	//bool findEqual(std::vector<float> values, float value);
 	//std::vector<float> batchGetRelativeValue(std::vector<float> as1, float bs1, float bs2);
-	float sumAllInclinations(std::vector<RenderedBody> rb, std::vector<BodyConst> bc, int targetIndex);
-	float sumAllAscendingNodes(std::vector<RenderedBody> rb, std::vector<BodyConst> bc, int targetIndex);
-	std::vector<float> sumAllPositions(std::vector<RenderedBody> rb, int targetIndex);
 private:
-	std::vector<float> elementwiseAdd(std::vector<float> a, std::vector<float> b);
 	//std::map < std::string, int> keyMap
 	//{
 	//	{"sun",		1},
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <stdlib.h>
+
+// uniform float in [min,max) from rand(), so an srand seed repeats the same values
+inline float randomRange(float min, float max)
+{
+	return min + (max - min) * (rand() / (RAND_MAX + 1.f));
+}
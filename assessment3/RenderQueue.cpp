@@ -0,0 +1,209 @@
+#include "RenderQueue.h"
+#include <string.h>
+
+// positive floats keep their ordering when reinterpreted as unsigned integers
+static uint32_t depthBits(float viewDepth)
+{
+	if (viewDepth < 0.f) viewDepth = 0.f;
+	uint32_t bits;
+	memcpy(&bits, &viewDepth, sizeof(bits));
+	return bits;
+}
+
+void RenderQueue::clear()
+{
+	packets.clear();
+	opaqueItems.clear();
+	transparentItems.clear();
+}
+
+void RenderQueue::reserve(int count)
+{
+	packets.reserve(count);
+	opaqueItems.reserve(count);
+	transparentItems.reserve(count);
+	scratch.reserve(count);
+}
+
+void RenderQueue::push(const DrawPacket& packet, float viewDepth, bool transparent)
+{
+	SortItem item;
+	item.packetIdx = (uint32_t)packets.size();
+	packets.push_back(packet);
+
+	if (transparent)
+	{
+		item.key = makeTransparentKey(packet, viewDepth);
+		transparentItems.push_back(item);
+	}
+	else
+	{
+		item.key = makeOpaqueKey(packet, viewDepth);
+		opaqueItems.push_back(item);
+	}
+}
+
+// opaque key (most significant first)
+// | program 16 | VAO 16 | texture 16 | depth 16 |
+// GL names are truncated to 16 bits, a collision only costs an extra state change
+uint64_t RenderQueue::makeOpaqueKey(const DrawPacket& packet, float viewDepth)
+{
+	uint64_t key = 0;
+	key |= (uint64_t)(packet.shaderProgram & 0xFFFF) << 48;
+	key |= (uint64_t)(packet.VAO & 0xFFFF) << 32;
+	key |= (uint64_t)(packet.textures[0] & 0xFFFF) << 16;
+	key |= (uint64_t)(depthBits(viewDepth) >> 16);		// coarse front to back
+	return key;
+}
+
+// transparent key (most significant first)
+// | inverted depth 32 | program 16 | VAO 16 |
+uint64_t RenderQueue::makeTransparentKey(const DrawPacket& packet, float viewDepth)
+{
+	uint64_t key = 0;
+	key |= (uint64_t)(~depthBits(viewDepth)) << 32;		// back to front
+	key |= (uint64_t)(packet.shaderProgram & 0xFFFF) << 16;
+	key |= (uint64_t)(packet.VAO & 0xFFFF);
+	return key;
+}
+
+void RenderQueue::sort()
+{
+	radixSort(opaqueItems);
+	radixSort(transparentItems);
+}
+
+void RenderQueue::radixSort(std::vector<SortItem>& items)
+{
+	size_t n = items.size();
+	if (n < 2) return;
+	scratch.resize(n);
+
+	SortItem* src = items.data();
+	SortItem* dst = scratch.data();
+
+	for (int shift = 0; shift < 64; shift += 8)
+	{
+		size_t histogram[256] = { 0 };
+		for (size_t i = 0; i < n; i++)
+		{
+			histogram[(src[i].key >> shift) & 0xFF]++;
+		}
+
+		// every key has the same byte, this pass would not change the order
+		if (histogram[(src[0].key >> shift) & 0xFF] == n) continue;
+
+		size_t offset = 0;
+		for (int b = 0; b < 256; b++)
+		{
+			size_t count = histogram[b];
+			histogram[b] = offset;
+			offset += count;
+		}
+
+		for (size_t i = 0; i < n; i++)
+		{
+			dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+		}
+
+		SortItem* tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+
+	// result ended up in scratch buffer
+	if (src != items.data())
+	{
+		memcpy(items.data(), src, n * sizeof(SortItem));
+	}
+}
+
+void RenderQueue::submit()
+{
+	drawCount = 0;
+	stateChangeCount = 0;
+
+	// force rebinding on first packet, state may have been touched outside of the queue
+	boundProgram = 0;
+	boundVAO = 0;
+	boundTextures[0] = boundTextures[1] = boundTextures[2] = 0;
+
+	submitItems(opaqueItems);
+
+	if (!transparentItems.empty())
+	{
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_FALSE);
+		submitItems(transparentItems);
+		glDepthMask(GL_TRUE);
+		glDisable(GL_BLEND);
+	}
+
+	glBindVertexArray(0);
+}
+
+void RenderQueue::submitItems(std::vector<SortItem>& items)
+{
+	for (size_t i = 0; i < items.size(); i++)
+	{
+		const DrawPacket& packet = packets[items[i].packetIdx];
+
+		if (packet.shaderProgram != boundProgram)
+		{
+			glUseProgram(packet.shaderProgram);
+			boundProgram = packet.shaderProgram;
+			stateChangeCount++;
+		}
+		if (packet.VAO != boundVAO)
+		{
+			glBindVertexArray(packet.VAO);
+			boundVAO = packet.VAO;
+			stateChangeCount++;
+		}
+		for (int t = 0; t < packet.textureCount; t++)
+		{
+			if (packet.textures[t] != boundTextures[t])
+			{
+				glActiveTexture(GL_TEXTURE0 + t);
+				glBindTexture(packet.textureTarget, packet.textures[t]);
+				boundTextures[t] = packet.textures[t];
+				stateChangeCount++;
+			}
+		}
+
+		if (packet.instanceCount > 0)
+		{
+			glDrawArraysInstanced(GL_TRIANGLES, packet.first, packet.count, packet.instanceCount);
+		}
+		else
+		{
+			glUniformMatrix4fv(getModelLocation(packet.shaderProgram), 1, GL_FALSE, glm::value_ptr(packet.model));
+			glDrawArrays(GL_TRIANGLES, packet.first, packet.count);
+		}
+		drawCount++;
+	}
+}
+
+int RenderQueue::getModelLocation(unsigned int shaderProgram)
+{
+	if (shaderProgram >= modelLocations.size())
+	{
+		modelLocations.resize(shaderProgram + 1, -2);
+	}
+	if (modelLocations[shaderProgram] == -2)
+	{
+		modelLocations[shaderProgram] = glGetUniformLocation(shaderProgram, "model");
+	}
+	return modelLocations[shaderProgram];
+}
+
+int RenderQueue::getDrawCount()
+{
+	return drawCount;
+}
+
+int RenderQueue::getStateChangeCount()
+{
+	return stateChangeCount;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <glm/glm/glm.hpp>
+#include <glm/glm/gtc/type_ptr.hpp>
+#include <stdint.h>
+#include <vector>
+
+// everything needed to issue one draw call
+struct DrawPacket
+{
+	// state
+	unsigned int shaderProgram = 0;
+	unsigned int VAO = 0;
+	unsigned int textureTarget = GL_TEXTURE_2D;
+	unsigned int textures[3] = { 0, 0, 0 };
+	int textureCount = 1;
+
+	// vertex range
+	int first = 0;
+	int count = 0;
+
+	// > 0 draws instanced, model matrices come from the VAO instance attributes
+	int instanceCount = 0;
+
+	// per object data
+	glm::mat4 model = glm::mat4(1.f);
+};
+
+// collects draw packets for a frame and submits them sorted by a packed 64 bit key
+// so that program, VAO and texture changes are kept to a minimum
+class RenderQueue
+{
+public:
+
+	// drop all packets from previous frame (keeps capacity)
+	void clear();
+
+	// preallocate for a number of packets so pushing never allocates
+	void reserve(int count);
+
+	// queue a draw, viewDepth is the distance from camera used for ordering
+	void push(const DrawPacket& packet, float viewDepth, bool transparent = false);
+
+	// sort opaque by state then front to back, transparent back to front
+	void sort();
+
+	// issue every queued draw, opaque first then transparent
+	void submit();
+
+	// statistics of last submit
+	int getDrawCount();
+	int getStateChangeCount();
+
+private:
+
+	struct SortItem
+	{
+		uint64_t key;
+		uint32_t packetIdx;
+	};
+
+	std::vector<DrawPacket> packets;
+	std::vector<SortItem> opaqueItems;
+	std::vector<SortItem> transparentItems;
+	std::vector<SortItem> scratch;			// radix sort ping pong buffer
+	std::vector<int> modelLocations;		// cached "model" uniform location indexed by program
+
+	// currently bound state
+	unsigned int boundProgram = 0;
+	unsigned int boundVAO = 0;
+	unsigned int boundTextures[3] = { 0, 0, 0 };
+
+	int drawCount = 0;
+	int stateChangeCount = 0;
+
+	// key packing
+	uint64_t makeOpaqueKey(const DrawPacket& packet, float viewDepth);
+	uint64_t makeTransparentKey(const DrawPacket& packet, float viewDepth);
+
+	// lsd radix sort by key, 8 bits per pass
+	void radixSort(std::vector<SortItem>& items);
+
+	void submitItems(std::vector<SortItem>& items);
+	int getModelLocation(unsigned int shaderProgram);
+};
@@ -0,0 +1,585 @@
+#include "SceneCompiler.h"
+#include "JobSystem.h"
+#include "MinorBodyCatalog.h"
+#include "SceneFile.h"
+#include <fstream>
+#include <math.h>
+#include <stdexcept>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unordered_map>
+
+using namespace std;
+
+struct ParsedBody
+{
+	string name;
+	string parent;		// "-" for root
+	string constant;
+	string mesh;
+	string texture;
+	float scaleModifier = 1.f;
+	float distanceMargin = 0.f;
+	float ovalRatio = 1.f;
+	uint32_t flags = SceneFile::BODY_ANIMATED | SceneFile::BODY_RANDOM_SPIN | SceneFile::BODY_MODEL_VIEW;
+	int line = 0;
+	int constantIdx = -1;	// catalog bodies use their own unnamed constant instead of constant
+};
+
+struct ParsedTexture
+{
+	string name;
+	vector<string> paths;
+};
+
+// whitespace separated tokens of a line, '#' starts a comment
+static void tokenize(const string& line, vector<string>& tokens)
+{
+	tokens.clear();
+	size_t i = 0;
+	while (i < line.size())
+	{
+		while (i < line.size() && (line[i] == ' ' || line[i] == '\t' || line[i] == '\r')) i++;
+		if (i >= line.size() || line[i] == '#') break;
+		size_t start = i;
+		while (i < line.size() && line[i] != ' ' && line[i] != '\t' && line[i] != '\r' && line[i] != '#') i++;
+		tokens.push_back(line.substr(start, i - start));
+	}
+}
+
+static runtime_error compileError(const string& sourceName, int line, const string& message)
+{
+	return runtime_error(sourceName + ":" + to_string(line) + ": " + message);
+}
+
+static bool parseFloat(const string& token, float& value)
+{
+	char* end = NULL;
+	value = strtof(token.c_str(), &end);
+	return end != token.c_str() && *end == '\0';
+}
+
+// name -> index, duplicates are an error
+static void addName(unordered_map<string, int>& names, const string& name, int idx, const char* kind,
+	const string& sourceName, int line)
+{
+	if (!names.insert(make_pair(name, idx)).second)
+	{
+		throw compileError(sourceName, line, string(kind) + " \"" + name + "\" is already defined");
+	}
+}
+
+static int findName(const unordered_map<string, int>& names, const string& name, const char* kind,
+	const string& sourceName, int line)
+{
+	auto it = names.find(name);
+	if (it == names.end()) throw compileError(sourceName, line, string("unknown ") + kind + " \"" + name + "\"");
+	return it->second;
+}
+
+// append a section to the output, sections start 4 byte aligned
+// size and modification time of a source file as they are compared on the next load
+static void setSourceStat(SceneSource& source, const struct stat& fileStat)
+{
+	uint64_t size = (uint64_t)fileStat.st_size;
+	uint64_t modified = (uint64_t)(int64_t)fileStat.st_mtime;
+	source.sizeLow = (uint32_t)size;
+	source.sizeHigh = (uint32_t)(size >> 32);
+	source.modifiedLow = (uint32_t)modified;
+	source.modifiedHigh = (uint32_t)(modified >> 32);
+}
+
+static uint32_t appendSection(vector<char>& out, const void* data, size_t size)
+{
+	out.resize((out.size() + 3) & ~(size_t)3, 0);
+	uint32_t offset = (uint32_t)out.size();
+	out.insert(out.end(), (const char*)data, (const char*)data + size);
+	return offset;
+}
+
+vector<char> SceneCompiler::compile(istream& text, const string& sourceName)
+{
+	vector<SceneMesh> meshes;
+	vector<string> meshPaths;
+	vector<ParsedTexture> textures;
+	vector<SceneConstant> constants;
+	vector<ParsedBody> bodies;
+	vector<SceneSource> sources;
+	vector<string> sourcePaths;
+	unordered_map<string, int> meshNames, textureNames, constantNames, bodyNames;
+	vector<string> meshNameList, constantNameList;	// in definition order
+
+	// ======== parse ========
+
+	string line;
+	vector<string> tokens;
+	int lineNumber = 0;
+	while (getline(text, line))
+	{
+		lineNumber++;
+		tokenize(line, tokens);
+		if (tokens.empty()) continue;
+		const string& keyword = tokens[0];
+
+		if (keyword == "mesh")
+		{
+			if (tokens.size() != 3) throw compileError(sourceName, lineNumber, "expected: mesh <name> <obj file>");
+			addName(meshNames, tokens[1], (int)meshes.size(), "mesh", sourceName, lineNumber);
+			meshes.push_back(SceneMesh());
+			meshNameList.push_back(tokens[1]);
+			meshPaths.push_back(tokens[2]);
+		}
+		else if (keyword == "texture")
+		{
+			if (tokens.size() < 3) throw compileError(sourceName, lineNumber, "expected: texture <name> <image file>...");
+			addName(textureNames, tokens[1], (int)textures.size(), "texture", sourceName, lineNumber);
+			ParsedTexture texture;
+			texture.name = tokens[1];
+			texture.paths.assign(tokens.begin() + 2, tokens.end());
+			textures.push_back(texture);
+		}
+		else if (keyword == "constant")
+		{
+			// positional values, then kepler element options
+			int valueCount = 0;
+			while (2 + valueCount < tokens.size() && tokens[2 + valueCount].find('=') == string::npos) valueCount++;
+			if (valueCount != 6 && valueCount != 7)
+			{
+				throw compileError(sourceName, lineNumber, "expected: constant <name> <radius> <orbital period> "
+					"<local orbital period> <ascending node> <inclination> <axial tilt> [default spin angle] [options]");
+			}
+			addName(constantNames, tokens[1], (int)constants.size(), "constant", sourceName, lineNumber);
+			float values[7] = { 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f };
+			for (int i = 0; i < valueCount; i++)
+			{
+				if (!parseFloat(tokens[2 + i], values[i])) throw compileError(sourceName, lineNumber, "\"" + tokens[2 + i] + "\" is not a number");
+			}
+			if (!(values[0] > 0.f)) throw compileError(sourceName, lineNumber, "radius must be positive");
+
+			float eccentricity = 0.f, periapsisArgument = 0.f, meanAnomaly = NAN, mass = 0.f;
+			int naifId = 0;
+			for (int i = 2 + valueCount; i < tokens.size(); i++)
+			{
+				const string& option = tokens[i];
+				size_t equals = option.find('=');
+				string key = option.substr(0, equals);
+				float value = 0.f;
+				if (equals == string::npos) throw compileError(sourceName, lineNumber, "unknown constant option \"" + option + "\"");
+				if (key == "naif")
+				{
+					// integer ids, asteroid ids don't fit a float
+					string token = option.substr(equals + 1);
+					char* end = NULL;
+					long id = strtol(token.c_str(), &end, 10);
+					if (end == token.c_str() || *end != '\0' || id == 0 || id != (int32_t)id)
+					{
+						throw compileError(sourceName, lineNumber, "naif must be a non zero integer id");
+					}
+					naifId = (int)id;
+					continue;
+				}
+				if (!parseFloat(option.substr(equals + 1), value)) throw compileError(sourceName, lineNumber, "\"" + option + "\" is not a number");
+
+				// the orbit solver converges up to 0.99
+				if (key == "e" && value >= 0.f && value <= 0.99f) eccentricity = value;
+				else if (key == "peri" && isfinite(value)) periapsisArgument = value;
+				else if (key == "mean" && isfinite(value)) meanAnomaly = value;
+				else if (key == "mass" && isfinite(value) && value >= 0.f) mass = value;
+				else if (key == "e") throw compileError(sourceName, lineNumber, "eccentricity must be within [0,0.99]");
+				else if (key == "mass") throw compileError(sourceName, lineNumber, "mass must be finite and not negative");
+				else if (key == "peri" || key == "mean") throw compileError(sourceName, lineNumber, key + " must be finite");
+				else throw compileError(sourceName, lineNumber, "unknown constant option \"" + option + "\"");
+			}
+
+			SceneConstant constant;
+			constant.name = 0;
+			constant.radius = values[0];
+			constant.orbitalPeriod = values[1];
+			constant.localOrbitalPeriod = values[2];
+			constant.ascendingNode = values[3];
+			constant.inclination = values[4];
+			constant.axialTilt = values[5];
+			constant.defaultSpinAngle = values[6];
+			constant.eccentricity = eccentricity;
+			constant.periapsisArgument = periapsisArgument;
+			constant.meanAnomaly = meanAnomaly;
+			constant.mass = mass;
+			constant.naifId = naifId;
+			constants.push_back(constant);
+			constantNameList.push_back(tokens[1]);
+		}
+		else if (keyword == "body")
+		{
+			if (tokens.size() < 6) throw compileError(sourceName, lineNumber, "expected: body <name> <parent or -> <constant> <mesh> <texture> [options]");
+			if (tokens[1] == "-") throw compileError(sourceName, lineNumber, "\"-\" can't be used as body name");
+			addName(bodyNames, tokens[1], (int)bodies.size(), "body", sourceName, lineNumber);
+
+			ParsedBody body;
+			body.name = tokens[1];
+			body.parent = tokens[2];
+			body.constant = tokens[3];
+			body.mesh = tokens[4];
+			body.texture = tokens[5];
+			body.line = lineNumber;
+			for (int i = 6; i < tokens.size(); i++)
+			{
+				const string& option = tokens[i];
+				size_t equals = option.find('=');
+				if (equals != string::npos)
+				{
+					string key = option.substr(0, equals);
+					float value = 0.f;
+					if (!parseFloat(option.substr(equals + 1), value)) throw compileError(sourceName, lineNumber, "\"" + option + "\" is not a number");
+
+					if (key == "scale" && value > 0.f) body.scaleModifier = value;
+					else if (key == "margin" && value >= 0.f) body.distanceMargin = value;
+					else if (key == "oval" && value > 0.f) body.ovalRatio = value;
+					else if (key == "scale" || key == "oval") throw compileError(sourceName, lineNumber, key + " must be positive");
+					else if (key == "margin") throw compileError(sourceName, lineNumber, "margin can't be negative");
+					else throw compileError(sourceName, lineNumber, "unknown body option \"" + option + "\"");
+				}
+				else if (option == "static") body.flags &= ~SceneFile::BODY_ANIMATED;
+				else if (option == "fixedSpin") body.flags &= ~SceneFile::BODY_RANDOM_SPIN;
+				else if (option == "noModelView") body.flags &= ~SceneFile::BODY_MODEL_VIEW;
+				else if (option == "transparent") body.flags |= SceneFile::BODY_TRANSPARENT;
+				else if (option == "light") body.flags |= SceneFile::BODY_LIGHT;
+				else if (option == "reference") body.flags |= SceneFile::BODY_REFERENCE;
+				else if (option == "physics") body.flags |= SceneFile::BODY_PHYSICS;
+				else throw compileError(sourceName, lineNumber, "unknown body option \"" + option + "\"");
+			}
+			bodies.push_back(body);
+		}
+		else if (keyword == "catalog")
+		{
+			if (tokens.size() < 5) throw compileError(sourceName, lineNumber, "expected: catalog <mpcorb file> <parent> <mesh> <texture> [options]");
+
+			CatalogFilter filter;
+			ParsedBody body;
+			body.parent = tokens[2];
+			body.mesh = tokens[3];
+			body.texture = tokens[4];
+			body.line = lineNumber;
+			body.flags = SceneFile::BODY_ANIMATED | SceneFile::BODY_RANDOM_SPIN | SceneFile::BODY_PERIOD_ORBIT;
+			for (int i = 5; i < tokens.size(); i++)
+			{
+				const string& option = tokens[i];
+				size_t equals = option.find('=');
+				if (equals != string::npos)
+				{
+					string key = option.substr(0, equals);
+					float value = 0.f;
+					if (!parseFloat(option.substr(equals + 1), value)) throw compileError(sourceName, lineNumber, "\"" + option + "\" is not a number");
+
+					if (key == "minA" && value >= 0.f) filter.minSemiMajorAxis = value;
+					else if (key == "maxA" && value > 0.f) filter.maxSemiMajorAxis = value;
+					else if (key == "maxH" && !isnan(value)) filter.maxMagnitude = value;
+					else if (key == "count" && value >= 0.f && value == floorf(value) && value <= 2e9f) filter.maxCount = (int)value;
+					else if (key == "scale" && value > 0.f) body.scaleModifier = value;
+					else if (key == "minA") throw compileError(sourceName, lineNumber, "minA can't be negative");
+					else if (key == "maxA" || key == "scale") throw compileError(sourceName, lineNumber, key + " must be positive");
+					else if (key == "maxH") throw compileError(sourceName, lineNumber, "maxH must be a number");
+					else if (key == "count") throw compileError(sourceName, lineNumber, "count must be a whole number");
+					else throw compileError(sourceName, lineNumber, "unknown catalog option \"" + option + "\"");
+				}
+				else if (option == "fixedSpin") body.flags &= ~SceneFile::BODY_RANDOM_SPIN;
+				else if (option == "modelView") body.flags |= SceneFile::BODY_MODEL_VIEW;
+				else if (option == "transparent") body.flags |= SceneFile::BODY_TRANSPARENT;
+				else if (option == "physics") body.flags |= SceneFile::BODY_PHYSICS;
+				else throw compileError(sourceName, lineNumber, "unknown catalog option \"" + option + "\"");
+			}
+
+			// stat before reading, a catalog changing while it is read is recompiled next time
+			struct stat catalogStat;
+			if (stat(tokens[1].c_str(), &catalogStat) == 0)
+			{
+				SceneSource source;
+				setSourceStat(source, catalogStat);
+				sources.push_back(source);
+				sourcePaths.push_back(tokens[1]);
+			}
+
+			MinorBodyCatalog catalog;
+			JobSystem jobs;
+			jobs.start();
+			try
+			{
+				catalog.load(tokens[1], filter, &jobs);
+			}
+			catch (const runtime_error& e)
+			{
+				throw compileError(sourceName, lineNumber, e.what());
+			}
+			jobs.stop();
+
+			// one constant per body: size from the absolute magnitude (typical albedo 0.14, 1 km without
+			// one), spinning every 8 hours, kepler elements with the mean anomaly moved to J2000
+			int count = catalog.getCount();
+			const float* magnitudes = catalog.getMagnitudes();
+			const float* eccentricities = catalog.getEccentricities();
+			const float* inclinations = catalog.getInclinations();
+			const float* nodes = catalog.getAscendingNodes();
+			const float* periapsisArguments = catalog.getPeriapsisArguments();
+			const float* meanMotions = catalog.getMeanMotions();
+			constants.reserve(constants.size() + count);
+			constantNameList.reserve(constantNameList.size() + count);
+			bodies.reserve(bodies.size() + count);
+			for (int i = 0; i < count; i++)
+			{
+				SceneConstant constant;
+				constant.name = 0;
+				constant.radius = isnan(magnitudes[i]) ? 1.f : 1329.f / sqrtf(0.14f) * powf(10.f, -0.2f * magnitudes[i]) * 0.5f;
+				constant.orbitalPeriod = 360.f / meanMotions[i];
+				constant.localOrbitalPeriod = constant.orbitalPeriod * 3.f;
+				constant.ascendingNode = nodes[i];
+				constant.inclination = inclinations[i];
+				constant.axialTilt = 0.f;
+				constant.defaultSpinAngle = 0.f;
+				constant.eccentricity = eccentricities[i];
+				constant.periapsisArgument = periapsisArguments[i];
+				constant.meanAnomaly = (float)catalog.getMeanAnomaly(i, 0.0);
+				constant.mass = 0.f;
+				constant.naifId = 0;
+
+				body.name = catalog.getDesignation(i);
+				body.constantIdx = (int)constants.size();
+				addName(bodyNames, body.name, (int)bodies.size(), "body", sourceName, lineNumber);
+				constants.push_back(constant);
+				constantNameList.push_back(body.name);
+				bodies.push_back(body);
+			}
+		}
+		else
+		{
+			throw compileError(sourceName, lineNumber, "unknown keyword \"" + keyword + "\"");
+		}
+	}
+
+	// ======== resolve and validate ========
+
+	int bodyCount = (int)bodies.size();
+	if (bodyCount == 0) throw compileError(sourceName, lineNumber, "scene has no bodies");
+
+	vector<int> parents(bodyCount);
+	int lightBody = -1;
+	int referenceBody = -1;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		const ParsedBody& body = bodies[i];
+		parents[i] = body.parent == "-" ? -1 : findName(bodyNames, body.parent, "parent body", sourceName, body.line);
+		if (parents[i] == i) throw compileError(sourceName, body.line, "body \"" + body.name + "\" can't orbit itself");
+		int constant = body.constantIdx != -1 ? body.constantIdx : findName(constantNames, body.constant, "constant", sourceName, body.line);
+		findName(meshNames, body.mesh, "mesh", sourceName, body.line);
+		findName(textureNames, body.texture, "texture", sourceName, body.line);
+
+		// animators divide by both periods
+		const SceneConstant& c = constants[constant];
+		if ((body.flags & SceneFile::BODY_ANIMATED)
+			&& !(isfinite(c.orbitalPeriod) && c.orbitalPeriod > 0.f && isfinite(c.localOrbitalPeriod) && c.localOrbitalPeriod > 0.f))
+		{
+			throw compileError(sourceName, body.line, "animated body \"" + body.name + "\" needs finite positive orbital periods");
+		}
+
+		if (body.flags & SceneFile::BODY_LIGHT)
+		{
+			if (lightBody != -1) throw compileError(sourceName, body.line, "only one body can be the light");
+			lightBody = i;
+		}
+		if (body.flags & SceneFile::BODY_REFERENCE)
+		{
+			if (referenceBody != -1) throw compileError(sourceName, body.line, "only one body can be the reference");
+			referenceBody = i;
+		}
+	}
+	if (referenceBody == -1) throw compileError(sourceName, lineNumber, "no body is marked as reference");
+	const SceneConstant& reference = constants[constantNames[bodies[referenceBody].constant]];
+	if (!(isfinite(reference.orbitalPeriod) && reference.orbitalPeriod > 0.f))
+	{
+		throw compileError(sourceName, bodies[referenceBody].line, "reference body needs a finite positive orbital period");
+	}
+	if (textures[textureNames[bodies[referenceBody].texture]].paths.size() != 3)
+	{
+		throw compileError(sourceName, bodies[referenceBody].line, "reference body is drawn with the earth shader and needs day, clouds and night textures");
+	}
+
+	// physics bodies fall around one static root body and nothing orbits them (no orbit to follow)
+	int physicsParent = -1;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		const ParsedBody& body = bodies[i];
+		int parent = parents[i];
+		if (parent != -1 && (bodies[parent].flags & SceneFile::BODY_PHYSICS))
+		{
+			throw compileError(sourceName, body.line, "body \"" + body.name + "\" can't orbit physics body \"" + bodies[parent].name + "\"");
+		}
+		if (!(body.flags & SceneFile::BODY_PHYSICS)) continue;
+		if (!(body.flags & SceneFile::BODY_ANIMATED)) throw compileError(sourceName, body.line, "physics body \"" + body.name + "\" can't be static");
+		if (parent == -1 || parents[parent] != -1 || (bodies[parent].flags & SceneFile::BODY_ANIMATED))
+		{
+			throw compileError(sourceName, body.line, "physics body \"" + body.name + "\" has to orbit a static root body");
+		}
+		if (physicsParent != -1 && parent != physicsParent)
+		{
+			throw compileError(sourceName, body.line, "physics bodies have to orbit the same body");
+		}
+		physicsParent = parent;
+	}
+
+	// parent first order, a body whose parent is not placed yet places its unplaced ancestors first
+	// (0 not placed, 1 on the current ancestor chain, 2 placed)
+	vector<int> order;
+	order.reserve(bodyCount);
+	vector<char> state(bodyCount, 0);
+	vector<int> chain;
+	for (int i = 0; i < bodyCount; i++)
+	{
+		if (state[i] == 2) continue;
+		chain.clear();
+		int idx = i;
+		while (idx != -1 && state[idx] == 0)
+		{
+			state[idx] = 1;
+			chain.push_back(idx);
+			idx = parents[idx];
+		}
+		if (idx != -1 && state[idx] == 1)
+		{
+			throw compileError(sourceName, bodies[idx].line, "body \"" + bodies[idx].name + "\" is its own ancestor");
+		}
+		for (int c = (int)chain.size() - 1; c >= 0; c--)
+		{
+			state[chain[c]] = 2;
+			order.push_back(chain[c]);
+		}
+	}
+	vector<int> newIdx(bodyCount);
+	for (int i = 0; i < bodyCount; i++) newIdx[order[i]] = i;
+
+	// ======== write ========
+
+	string strings(1, '\0');	// offset 0 is the empty string
+	auto addString = [&strings](const string& s)
+	{
+		uint32_t offset = (uint32_t)strings.size();
+		strings.append(s);
+		strings.push_back('\0');
+		return offset;
+	};
+
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		meshes[i].name = addString(meshNameList[i]);
+		meshes[i].path = addString(meshPaths[i]);
+	}
+	vector<SceneTexture> sceneTextures(textures.size());
+	vector<uint32_t> texturePaths;
+	for (int i = 0; i < textures.size(); i++)
+	{
+		sceneTextures[i].name = addString(textures[i].name);
+		sceneTextures[i].firstPath = (uint32_t)texturePaths.size();
+		sceneTextures[i].pathCount = (uint32_t)textures[i].paths.size();
+		for (int p = 0; p < textures[i].paths.size(); p++) texturePaths.push_back(addString(textures[i].paths[p]));
+	}
+	for (int i = 0; i < constants.size(); i++)
+	{
+		constants[i].name = addString(constantNameList[i]);
+	}
+	for (int i = 0; i < sources.size(); i++)
+	{
+		sources[i].path = addString(sourcePaths[i]);
+	}
+	vector<SceneBody> sceneBodies(bodyCount);
+	for (int i = 0; i < bodyCount; i++)
+	{
+		const ParsedBody& body = bodies[order[i]];
+		SceneBody& out = sceneBodies[i];
+		out.name = addString(body.name);
+		out.parent = parents[order[i]] == -1 ? -1 : newIdx[parents[order[i]]];
+		out.constant = (uint32_t)(body.constantIdx != -1 ? body.constantIdx : constantNames[body.constant]);
+		out.mesh = (uint32_t)meshNames[body.mesh];
+		out.texture = (uint32_t)textureNames[body.texture];
+		out.scaleModifier = body.scaleModifier;
+		out.distanceMargin = body.distanceMargin;
+		out.ovalRatio = body.ovalRatio;
+		out.flags = body.flags;
+	}
+
+	SceneHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "SCNB", 4);
+	header.version = SceneFile::VERSION;
+	header.meshCount = (uint32_t)meshes.size();
+	header.textureCount = (uint32_t)sceneTextures.size();
+	header.texturePathCount = (uint32_t)texturePaths.size();
+	header.constantCount = (uint32_t)constants.size();
+	header.bodyCount = (uint32_t)bodyCount;
+	header.sourceCount = (uint32_t)sources.size();
+	header.stringSize = (uint32_t)strings.size();
+	header.lightBody = lightBody == -1 ? -1 : newIdx[lightBody];
+	header.referenceBody = newIdx[referenceBody];
+
+	vector<char> out(sizeof(SceneHeader));
+	header.meshOffset = appendSection(out, meshes.data(), meshes.size() * sizeof(SceneMesh));
+	header.textureOffset = appendSection(out, sceneTextures.data(), sceneTextures.size() * sizeof(SceneTexture));
+	header.texturePathOffset = appendSection(out, texturePaths.data(), texturePaths.size() * sizeof(uint32_t));
+	header.constantOffset = appendSection(out, constants.data(), constants.size() * sizeof(SceneConstant));
+	header.bodyOffset = appendSection(out, sceneBodies.data(), sceneBodies.size() * sizeof(SceneBody));
+	header.sourceOffset = appendSection(out, sources.data(), sources.size() * sizeof(SceneSource));
+	header.stringOffset = appendSection(out, strings.data(), strings.size());
+	out.resize((out.size() + 3) & ~(size_t)3, 0);
+	header.fileSize = (uint32_t)out.size();
+	memcpy(out.data(), &header, sizeof(header));
+	return out;
+}
+
+void SceneCompiler::compileFile(const string& textPath, const string& binaryPath)
+{
+	ifstream text(textPath);
+	if (!text) throw runtime_error("can't open scene file " + textPath);
+	vector<char> binary = compile(text, textPath);
+
+	ofstream out(binaryPath, ios::binary | ios::trunc);
+	out.write(binary.data(), binary.size());
+	if (!out) throw runtime_error("can't write compiled scene " + binaryPath);
+}
+
+string SceneCompiler::compileIfOutdated(const string& textPath)
+{
+	string binaryPath = textPath + ".bin";
+	struct stat textStat, binaryStat;
+	if (stat(textPath.c_str(), &textStat) != 0) throw runtime_error("can't open scene file " + textPath);
+
+	// an existing binary is kept if it is newer than the text, has the current version and every
+	// catalog it was compiled from still has the same size and modification time
+	bool upToDate = false;
+	if (stat(binaryPath.c_str(), &binaryStat) == 0 && binaryStat.st_mtime >= textStat.st_mtime)
+	{
+		// unmapped again before it is rewritten
+		SceneFile scene;
+		try
+		{
+			scene.load(binaryPath);
+			upToDate = true;
+		}
+		catch (const runtime_error&)
+		{
+			// invalid or another version, recompiled
+		}
+		for (int i = 0; upToDate && i < scene.getSourceCount(); i++)
+		{
+			const SceneSource& recorded = scene.getSource(i);
+			struct stat sourceStat;
+			SceneSource current;
+			if (stat(scene.getString(recorded.path), &sourceStat) != 0)
+			{
+				upToDate = false;
+				break;
+			}
+			setSourceStat(current, sourceStat);
+			upToDate = current.sizeLow == recorded.sizeLow && current.sizeHigh == recorded.sizeHigh
+				&& current.modifiedLow == recorded.modifiedLow && current.modifiedHigh == recorded.modifiedHigh;
+		}
+	}
+	if (!upToDate) compileFile(textPath, binaryPath);
+	return binaryPath;
+}
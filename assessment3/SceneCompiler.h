@@ -0,0 +1,26 @@
+#pragma once
+
+#include <istream>
+#include <string>
+#include <vector>
+
+// turns a text scene (see resources/scenes/solar_system.scene for the syntax) into the binary
+// layout read by SceneFile
+// every name is resolved and checked here (unknown or duplicate names, parent cycles, bad values,
+// light and reference bodies) and bodies are reordered parent first, keeping the written order
+// wherever a parent already comes before its children
+// catalog lines are expanded into one body and constant per minor body of an MPCORB file (see
+// MinorBodyCatalog), parsed in parallel on a job system of their own
+// errors throw std::runtime_error with "source:line: message"
+class SceneCompiler
+{
+public:
+
+	std::vector<char> compile(std::istream& text, const std::string& sourceName);
+	void compileFile(const std::string& textPath, const std::string& binaryPath);
+
+	// compiled file next to a text scene (textPath + ".bin"), recompiled when missing, older than
+	// the text or when a catalog file it was compiled from changed size or modification time,
+	// returns its path
+	std::string compileIfOutdated(const std::string& textPath);
+};
@@ -0,0 +1,124 @@
+#include "SceneFile.h"
+#include <stdexcept>
+#include <string.h>
+
+void SceneFile::load(const std::string& path)
+{
+	if (!file.open(path))
+	{
+		throw std::runtime_error("can't open scene file " + path);
+	}
+	try
+	{
+		load(file.getData(), file.getSize());
+	}
+	catch (const std::runtime_error& e)
+	{
+		file.close();
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+void SceneFile::load(const void* data, size_t size)
+{
+	this->data = (const char*)data;
+	this->size = size;
+	header = NULL;
+	if (size < sizeof(SceneHeader) || ((uintptr_t)data & 3) != 0)
+	{
+		throw std::runtime_error("not a compiled scene");
+	}
+	header = (const SceneHeader*)data;
+	validate();
+}
+
+void SceneFile::validate()
+{
+	if (memcmp(header->magic, "SCNB", 4) != 0) throw std::runtime_error("not a compiled scene");
+	if (header->version != VERSION) throw std::runtime_error("compiled scene version " + std::to_string(header->version)
+		+ " is not supported (expected " + std::to_string(VERSION) + ")");
+	if (header->fileSize != size) throw std::runtime_error("compiled scene is truncated");
+
+	meshes = (const SceneMesh*)section(header->meshOffset, header->meshCount, sizeof(SceneMesh));
+	textures = (const SceneTexture*)section(header->textureOffset, header->textureCount, sizeof(SceneTexture));
+	texturePaths = (const uint32_t*)section(header->texturePathOffset, header->texturePathCount, sizeof(uint32_t));
+	constants = (const SceneConstant*)section(header->constantOffset, header->constantCount, sizeof(SceneConstant));
+	bodies = (const SceneBody*)section(header->bodyOffset, header->bodyCount, sizeof(SceneBody));
+	sources = (const SceneSource*)section(header->sourceOffset, header->sourceCount, sizeof(SceneSource));
+	strings = (const char*)section(header->stringOffset, header->stringSize, 1);
+
+	// every string read later must end inside the string section
+	if (header->stringSize == 0 || strings[header->stringSize - 1] != '\0')
+	{
+		throw std::runtime_error("string section is not terminated");
+	}
+	uint32_t stringSize = header->stringSize;
+
+	for (uint32_t i = 0; i < header->meshCount; i++)
+	{
+		if (meshes[i].name >= stringSize || meshes[i].path >= stringSize) throw std::runtime_error("mesh string out of range");
+	}
+	for (uint32_t i = 0; i < header->textureCount; i++)
+	{
+		const SceneTexture& texture = textures[i];
+		if (texture.name >= stringSize || texture.pathCount == 0 || texture.firstPath > header->texturePathCount
+			|| texture.pathCount > header->texturePathCount - texture.firstPath)
+		{
+			throw std::runtime_error("texture out of range");
+		}
+	}
+	for (uint32_t i = 0; i < header->texturePathCount; i++)
+	{
+		if (texturePaths[i] >= stringSize) throw std::runtime_error("texture path out of range");
+	}
+	for (uint32_t i = 0; i < header->constantCount; i++)
+	{
+		if (constants[i].name >= stringSize) throw std::runtime_error("constant name out of range");
+	}
+	for (uint32_t i = 0; i < header->sourceCount; i++)
+	{
+		if (sources[i].path >= stringSize) throw std::runtime_error("source path out of range");
+	}
+
+	// parent first order is what makes single pass setup possible, so it is checked as well
+	for (uint32_t i = 0; i < header->bodyCount; i++)
+	{
+		const SceneBody& body = bodies[i];
+		if (body.name >= stringSize || body.constant >= header->constantCount || body.mesh >= header->meshCount
+			|| body.texture >= header->textureCount || body.parent < -1 || body.parent >= (int32_t)i)
+		{
+			throw std::runtime_error("body " + std::to_string(i) + " out of range");
+		}
+	}
+	if (header->lightBody < -1 || header->lightBody >= (int32_t)header->bodyCount
+		|| header->referenceBody < 0 || header->referenceBody >= (int32_t)header->bodyCount)
+	{
+		throw std::runtime_error("light or reference body out of range");
+	}
+}
+
+const void* SceneFile::section(uint32_t offset, uint32_t count, size_t elementSize)
+{
+	if (offset % 4 != 0 || offset > size || count > (size - offset) / elementSize)
+	{
+		throw std::runtime_error("section out of range");
+	}
+	return data + offset;
+}
+
+int SceneFile::getMeshCount() { return (int)header->meshCount; }
+int SceneFile::getTextureCount() { return (int)header->textureCount; }
+int SceneFile::getConstantCount() { return (int)header->constantCount; }
+int SceneFile::getBodyCount() { return (int)header->bodyCount; }
+int SceneFile::getSourceCount() { return (int)header->sourceCount; }
+int SceneFile::getLightBody() { return header->lightBody; }
+int SceneFile::getReferenceBody() { return header->referenceBody; }
+
+const SceneMesh& SceneFile::getMesh(int idx) { return meshes[idx]; }
+const SceneTexture& SceneFile::getTexture(int idx) { return textures[idx]; }
+const char* SceneFile::getTexturePath(const SceneTexture& texture, int pathIdx) { return strings + texturePaths[texture.firstPath + pathIdx]; }
+const SceneConstant& SceneFile::getConstant(int idx) { return constants[idx]; }
+const SceneBody& SceneFile::getBody(int idx) { return bodies[idx]; }
+const SceneBody* SceneFile::getBodies() { return bodies; }
+const SceneSource& SceneFile::getSource(int idx) { return sources[idx]; }
+const char* SceneFile::getString(uint32_t offset) { return strings + offset; }
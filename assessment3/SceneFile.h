@@ -0,0 +1,149 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include "MappedFile.h"
+
+// compiled scene layout (written by SceneCompiler), every section is a plain array of the structs
+// below so the mapped file is used in place without parsing
+// offsets are bytes from the start of the file, names and paths are offsets into the string section
+struct SceneHeader
+{
+	char magic[4];				// "SCNB"
+	uint32_t version;
+	uint32_t fileSize;
+	uint32_t meshCount;
+	uint32_t meshOffset;
+	uint32_t textureCount;
+	uint32_t textureOffset;
+	uint32_t texturePathCount;
+	uint32_t texturePathOffset;	// string offsets, textures index ranges of it
+	uint32_t constantCount;
+	uint32_t constantOffset;
+	uint32_t bodyCount;
+	uint32_t bodyOffset;
+	uint32_t stringSize;
+	uint32_t stringOffset;		// null terminated strings
+	uint32_t sourceCount;
+	uint32_t sourceOffset;
+	int32_t lightBody;			// -1 if the scene has no light body
+	int32_t referenceBody;
+};
+
+// file read while compiling besides the text (catalogs), as it was then so a changed file is noticed
+// 64 bit values are split into 32 bit halves to keep every section 4 byte aligned
+struct SceneSource
+{
+	uint32_t path;
+	uint32_t sizeLow;			// bytes
+	uint32_t sizeHigh;
+	uint32_t modifiedLow;		// modification time (time_t)
+	uint32_t modifiedHigh;
+};
+
+struct SceneMesh
+{
+	uint32_t name;
+	uint32_t path;
+};
+
+struct SceneTexture
+{
+	uint32_t name;
+	uint32_t firstPath;			// texture paths [firstPath, firstPath + pathCount)
+	uint32_t pathCount;
+};
+
+// same values as BodyConst
+struct SceneConstant
+{
+	uint32_t name;
+	float radius;
+	float orbitalPeriod;
+	float localOrbitalPeriod;
+	float ascendingNode;
+	float inclination;
+	float axialTilt;
+	float defaultSpinAngle;
+	float eccentricity;
+	float periapsisArgument;
+	float meanAnomaly;			// NaN if not given
+	float mass;					// kg, 0 if not given
+	int32_t naifId;				// spk ephemeris body, 0 if not given
+};
+
+// bodies are stored parent first, parent < own index
+struct SceneBody
+{
+	uint32_t name;
+	int32_t parent;				// -1 for root
+	uint32_t constant;
+	uint32_t mesh;
+	uint32_t texture;
+	float scaleModifier;
+	float distanceMargin;
+	float ovalRatio;
+	uint32_t flags;				// SceneFile::BODY_*
+};
+
+// read only access to a compiled scene, either memory mapped from a file or a buffer in memory
+// loading only checks the header and that every index is in range, so it stays cheap for
+// millions of bodies
+class SceneFile
+{
+public:
+
+	static const uint32_t VERSION = 5;
+
+	// body flags
+	static const uint32_t BODY_ANIMATED = 1;
+	static const uint32_t BODY_RANDOM_SPIN = 2;		// random spin angle instead of the default one
+	static const uint32_t BODY_MODEL_VIEW = 4;		// selectable in model view camera
+	static const uint32_t BODY_TRANSPARENT = 8;
+	static const uint32_t BODY_LIGHT = 16;			// light source, drawn unlit
+	static const uint32_t BODY_REFERENCE = 32;		// scale and orbit delay reference
+	static const uint32_t BODY_PHYSICS = 64;		// moved by gravity (NBodySystem) instead of its orbit
+	static const uint32_t BODY_PERIOD_ORBIT = 128;	// orbit radius from its period among the laid out siblings (catalog bodies)
+
+	// map compiled scene file, throws std::runtime_error if it is missing or invalid
+	void load(const std::string& path);
+
+	// use a compiled scene in memory, data has to stay alive while it is used
+	void load(const void* data, size_t size);
+
+	int getMeshCount();
+	int getTextureCount();
+	int getConstantCount();
+	int getBodyCount();
+	int getSourceCount();
+	int getLightBody();
+	int getReferenceBody();
+
+	const SceneMesh& getMesh(int idx);
+	const SceneTexture& getTexture(int idx);
+	const char* getTexturePath(const SceneTexture& texture, int pathIdx);
+	const SceneConstant& getConstant(int idx);
+	const SceneBody& getBody(int idx);
+	const SceneBody* getBodies();
+	const SceneSource& getSource(int idx);
+	const char* getString(uint32_t offset);
+
+private:
+
+	MappedFile file;
+	const char* data = NULL;
+	size_t size = 0;
+	const SceneHeader* header = NULL;
+	const SceneMesh* meshes = NULL;
+	const SceneTexture* textures = NULL;
+	const uint32_t* texturePaths = NULL;
+	const SceneConstant* constants = NULL;
+	const SceneBody* bodies = NULL;
+	const SceneSource* sources = NULL;
+	const char* strings = NULL;
+
+	void validate();
+
+	// pointer to a section of count elements, throws if it lies outside the file
+	const void* section(uint32_t offset, uint32_t count, size_t elementSize);
+};
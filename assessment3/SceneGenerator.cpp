@@ -0,0 +1,181 @@
+#include "SceneGenerator.h"
+#include "SceneCompiler.h"
+#include "RandomRange.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <stdlib.h>
+
+using namespace std;
+
+static const int CONSTANT_POOL_SIZE = 16;		// random constants per level (planet, moon)
+static const char* SPHERE_PATH = "resources/solar_system/sphere.obj";
+
+vector<GeneratedMesh> SceneGenerator::bundledMeshes()
+{
+	vector<GeneratedMesh> bundled(3);
+	bundled[0].name = "sphere";
+	bundled[0].path = SPHERE_PATH;
+	const char* planets[] = { "2k_mercury.jpg", "2k_venus_surface.jpg", "2k_mars.jpg", "2k_jupiter.jpg",
+		"2k_saturn.jpg", "2k_uranus.jpg", "2k_neptune.jpg", "pluto.jpg", "2k_moon.jpg" };
+	for (int i = 0; i < 9; i++)
+	{
+		bundled[0].texturePaths.push_back(string("resources/solar_system/textures/") + planets[i]);
+	}
+	bundled[0].weight = 0.85f;
+
+	bundled[1].name = "astroid_1";
+	bundled[1].path = "resources/astroid_1/astroid_1.obj";
+	bundled[1].texturePaths.push_back("resources/astroid_1/astroid_1.jpg");
+	bundled[1].weight = 0.1f;
+
+	bundled[2].name = "satelite_1";
+	bundled[2].path = "resources/satelite_1/satelite_1.obj";
+	bundled[2].texturePaths.push_back("resources/satelite_1/satelite_1.jpg");
+	bundled[2].weight = 0.05f;
+	return bundled;
+}
+
+void SceneGenerator::writeText(const GeneratorSettings& settings, ostream& text)
+{
+	if (settings.bodyCount < 2) throw runtime_error("generated scene needs at least a sun and a reference body");
+	if (settings.depth < 1 || settings.moonsPerPlanet < 0) throw runtime_error("bad generated scene hierarchy");
+	if (settings.debrisCount < 0 || settings.debrisCount > settings.bodyCount - 2) throw runtime_error("bad generated debris count");
+
+	this->settings = settings;
+	meshes = settings.meshMix.empty() ? bundledMeshes() : settings.meshMix;
+	meshWeightSums.clear();
+	float weightSum = 0.f;
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		if (meshes[i].texturePaths.empty()) throw runtime_error("generated mesh " + meshes[i].name + " has no texture");
+		weightSum += max(meshes[i].weight, 0.f);
+		meshWeightSums.push_back(weightSum);
+	}
+	if (weightSum <= 0.f) throw runtime_error("generated scene has no mesh to draw");
+	srand(settings.seed);
+
+	text << "# generated scene: " << settings.bodyCount << " bodies, depth " << settings.depth
+		<< ", " << settings.moonsPerPlanet << " moons per planet, " << settings.debrisCount << " debris\n\n";
+
+	// sun and reference body share the mix sphere if there is one
+	sunMesh = "sun_sphere";
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		if (meshes[i].path == SPHERE_PATH) sunMesh = meshes[i].name;
+	}
+	if (sunMesh == "sun_sphere") text << "mesh sun_sphere " << SPHERE_PATH << "\n";
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		text << "mesh " << meshes[i].name << " " << meshes[i].path << "\n";
+	}
+	text << "texture sun resources/solar_system/textures/2k_sun.jpg\n";
+	text << "texture earth resources/solar_system/textures/2k_earth_daymap.jpg resources/solar_system/textures/2k_earth_clouds.jpg"
+		" resources/solar_system/textures/8k_earth_nightmap.jpg\n";
+	for (int i = 0; i < meshes.size(); i++)
+	{
+		for (int t = 0; t < meshes[i].texturePaths.size(); t++)
+		{
+			text << "texture " << meshes[i].name << "_" << t << " " << meshes[i].texturePaths[t] << "\n";
+		}
+	}
+
+	text << "\nconstant sun 696340 inf inf 0 0 7.25 mass=1.989e30\nconstant earth 6371 365.256363 365.256363 -11.26064 0 23.4392811\n";
+	for (int i = 0; i < CONSTANT_POOL_SIZE; i++)
+	{
+		text << "constant planet" << i << " " << randomRange(2000.f, 70000.f) << " " << randomRange(50.f, 5000.f)
+			<< " " << randomRange(1.f, 1000.f) << " " << randomRange(0.f, 360.f) << " " << randomRange(0.f, 10.f)
+			<< " " << randomRange(0.f, 30.f) << "\n";
+	}
+	for (int i = 0; i < CONSTANT_POOL_SIZE; i++)
+	{
+		text << "constant moon" << i << " " << randomRange(200.f, 3000.f) << " " << randomRange(1.f, 100.f)
+			<< " 1 " << randomRange(0.f, 360.f) << " " << randomRange(0.f, 10.f) << " " << randomRange(0.f, 10.f) << "\n";
+	}
+
+	for (int i = 0; i < CONSTANT_POOL_SIZE && settings.debrisCount > 0; i++)
+	{
+		text << "constant debris" << i << " " << randomRange(0.5f, 50.f) << " " << randomRange(1000.f, 10000.f)
+			<< " " << randomRange(100.f, 10000.f) << " " << randomRange(0.f, 360.f) << " " << randomRange(0.f, 5.f)
+			<< " " << randomRange(0.f, 90.f) << " e=" << randomRange(0.f, 0.2f) << " peri=" << randomRange(0.f, 360.f)
+			<< " mass=" << randomRange(1e13f, 1e17f) << "\n";
+	}
+
+	text << "\nbody b0 - sun " << sunMesh << " sun scale=0.3 static light\n";
+	written = 1;
+	while (written < settings.bodyCount - settings.debrisCount) writeBody(text, 0, 1);
+	writeDebris(text);
+}
+
+void SceneGenerator::writeDebris(ostream& text)
+{
+	// after every planet, the tightly packed sibling orbits form a belt beyond them
+	while (written < settings.bodyCount)
+	{
+		float pick = randomRange(0.f, meshWeightSums.back());
+		int mesh = (int)(upper_bound(meshWeightSums.begin(), meshWeightSums.end(), pick) - meshWeightSums.begin());
+		mesh = min(mesh, (int)meshes.size() - 1);
+		text << "body b" << written++ << " b0 debris" << rand() % CONSTANT_POOL_SIZE << " " << meshes[mesh].name
+			<< " " << meshes[mesh].name << "_" << rand() % (int)meshes[mesh].texturePaths.size()
+			<< " scale=" << settings.scaleModifier << " physics noModelView\n";
+	}
+}
+
+void SceneGenerator::writeBody(ostream& text, int parent, int level)
+{
+	// depth first with an explicit stack so deep settings can't overflow the call stack, the top
+	// entry is the body whose next moon is written
+	pending.clear();
+	pending.push_back(PendingBody{ writeBodyLine(text, parent, level), level, 0 });
+	while (!pending.empty())
+	{
+		PendingBody top = pending.back();
+		if (top.children >= settings.moonsPerPlanet || top.level >= settings.depth || written >= settings.bodyCount - settings.debrisCount)
+		{
+			pending.pop_back();
+			continue;
+		}
+		pending.back().children++;
+		pending.push_back(PendingBody{ writeBodyLine(text, top.idx, top.level + 1), top.level + 1, 0 });
+	}
+}
+
+int SceneGenerator::writeBodyLine(ostream& text, int parent, int level)
+{
+	int idx = written++;
+	text << "body b" << idx << " b" << parent << " ";
+	if (idx == 1)
+	{
+		text << "earth " << sunMesh << " earth margin=20 reference\n";
+	}
+	else
+	{
+		// mesh by weight, texture uniform among the mesh's textures
+		float pick = randomRange(0.f, meshWeightSums.back());
+		int mesh = (int)(upper_bound(meshWeightSums.begin(), meshWeightSums.end(), pick) - meshWeightSums.begin());
+		mesh = min(mesh, (int)meshes.size() - 1);
+		int texture = rand() % (int)meshes[mesh].texturePaths.size();
+
+		text << (level == 1 ? "planet" : "moon") << rand() % CONSTANT_POOL_SIZE << " " << meshes[mesh].name
+			<< " " << meshes[mesh].name << "_" << texture << " scale=" << settings.scaleModifier
+			<< " margin=" << (level == 1 ? randomRange(5.f, 20.f) : randomRange(1.f, 5.f))
+			<< " oval=" << randomRange(1.f, 1.1f) << "\n";
+	}
+	return idx;
+}
+
+void SceneGenerator::writeFile(const GeneratorSettings& settings, const string& path)
+{
+	ofstream text(path, ios::trunc);
+	if (!text) throw runtime_error("can't write scene file " + path);
+	writeText(settings, text);
+	if (!text) throw runtime_error("can't write scene file " + path);
+}
+
+vector<char> SceneGenerator::generate(const GeneratorSettings& settings)
+{
+	stringstream text;
+	writeText(settings, text);
+	return SceneCompiler().compile(text, "generated");
+}
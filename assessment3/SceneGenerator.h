@@ -0,0 +1,71 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// mesh drawn by generated bodies, every body picks one of its textures
+struct GeneratedMesh
+{
+	std::string name;
+	std::string path;
+	std::vector<std::string> texturePaths;
+	float weight = 1.f;			// share of the bodies using this mesh, relative to the other meshes
+};
+
+// shape of a generated solar system
+struct GeneratorSettings
+{
+	int bodyCount = 1000;		// including the sun
+	int depth = 2;				// orbit levels below the sun, 1 = planets only, 2 = planets and moons, 3 = moons of moons...
+	int moonsPerPlanet = 4;		// children of every body above the deepest level
+	float scaleModifier = 0.5f;	// scale modifier of every body except sun and reference
+	int debrisCount = 0;		// of bodyCount, physics bodies around the sun (n-body debris belt beyond the planets)
+	unsigned int seed = 1;
+	std::vector<GeneratedMesh> meshMix;		// empty = spheres with planet textures, asteroids and satellites
+};
+
+// builds solar systems of any size for stress tests, output is a text scene (same syntax as
+// resources/scenes/solar_system.scene) so it goes through the compiler and the normal setup
+// bodies are written parent first: a static sun (light), then every planet followed by its moons,
+// the first planet is an earth sized reference body
+// planets and moons draw from small pools of random constants, so 1M bodies stay 1M lines
+// debris comes last, small massive physics bodies on eccentric orbits, the sun has a mass and the
+// planets don't, so debris only falls around the sun and each other
+class SceneGenerator
+{
+public:
+
+	void writeText(const GeneratorSettings& settings, std::ostream& text);
+	void writeFile(const GeneratorSettings& settings, const std::string& path);
+
+	// compiled scene, ready for SceneFile::load
+	std::vector<char> generate(const GeneratorSettings& settings);
+
+	// default mesh mix, paths relative to the working directory of the application
+	static std::vector<GeneratedMesh> bundledMeshes();
+
+private:
+
+	GeneratorSettings settings;
+	std::vector<GeneratedMesh> meshes;
+	std::vector<float> meshWeightSums;		// running sum of the mesh weights
+	std::string sunMesh;					// sphere mesh of sun and reference body
+	int written = 0;
+
+	// body whose moons are being written
+	struct PendingBody
+	{
+		int idx;
+		int level;
+		int children;		// moons written so far
+	};
+	std::vector<PendingBody> pending;
+
+	// one body and its moons, depth first so parents come before their children
+	void writeBody(std::ostream& text, int parent, int level);
+
+	// line of one body, returns its index
+	int writeBodyLine(std::ostream& text, int parent, int level);
+	void writeDebris(std::ostream& text);
+};
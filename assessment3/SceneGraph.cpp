@@ -0,0 +1,166 @@
+#include "SceneGraph.h"
+#include "JobSystem.h"
+#include "TransformKernel.h"
+
+void SceneGraph::build(const std::vector<int>& parents)
+{
+	int count = (int)parents.size();
+	nodes.assign(count, Node());
+	order.clear();
+	order.reserve(count);
+	worlds.assign(count, glm::mat4(1.f));
+	worldPositions.assign(count, glm::vec3(0.f));
+	batchIndex.resize(count);
+	batchParentsRotation.resize(count);
+	batchAscendingNode.resize(count);
+	batchTilt.resize(count);
+	batchSpin.resize(count);
+	batchScale.resize(count);
+	batchParentOffset.resize(count);
+	batchPosition.resize(count);
+
+	// children lists as offsets into one array (counting sort by parent, so in index order)
+	childStart.assign(count + 1, 0);
+	children.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		nodes[i].parent = parents[i];
+		if (parents[i] != -1) childStart[parents[i] + 1]++;
+	}
+	for (int i = 0; i < count; i++)
+	{
+		childStart[i + 1] += childStart[i];
+	}
+	std::vector<int> fill(childStart.begin(), childStart.end() - 1);
+	for (int i = 0; i < count; i++)
+	{
+		if (parents[i] != -1) children[fill[parents[i]]++] = i;
+	}
+
+	// breadth first from every root
+	for (int i = 0; i < count; i++)
+	{
+		if (parents[i] == -1) order.push_back(i);
+	}
+	for (int head = 0; head < order.size(); head++)
+	{
+		int idx = order[head];
+		for (int c = childStart[idx]; c < childStart[idx + 1]; c++)
+		{
+			order.push_back(children[c]);
+		}
+	}
+
+	// nodes in a parent cycle are never reached, treat them as roots so they still get drawn
+	if (order.size() < count)
+	{
+		std::vector<bool> placed(count, false);
+		for (int i = 0; i < order.size(); i++) placed[order[i]] = true;
+		for (int i = 0; i < count; i++)
+		{
+			if (placed[i]) continue;
+			nodes[i].parent = -1;
+			order.push_back(i);
+		}
+	}
+}
+
+int SceneGraph::getChildCount(int idx) { return childStart[idx + 1] - childStart[idx]; }
+const int* SceneGraph::getChildren(int idx) { return children.data() + childStart[idx]; }
+
+int SceneGraph::getNodeCount() { return (int)nodes.size(); }
+int SceneGraph::getParent(int idx) { return nodes[idx].parent; }
+const std::vector<int>& SceneGraph::getOrder() { return order; }
+
+void SceneGraph::accumulate(const std::vector<float>& local, std::vector<float>& out)
+{
+	out.resize(nodes.size());
+	for (int i = 0; i < order.size(); i++)
+	{
+		int idx = order[i];
+		int parent = nodes[idx].parent;
+		out[idx] = local[idx] + (parent == -1 ? 0.f : out[parent]);
+	}
+}
+
+void SceneGraph::setConstants(int idx, float parentsRotation, float ascendingNode, float tilt, float scale)
+{
+	Node& node = nodes[idx];
+	node.parentsRotation = parentsRotation;
+	node.ascendingNode = ascendingNode;
+	node.tilt = tilt;
+	node.scale = scale;
+	node.dirty = true;
+}
+
+void SceneGraph::setLocal(int idx, const glm::vec3& position, float spin)
+{
+	Node& node = nodes[idx];
+	if (node.position == position && node.spin == spin) return;
+	node.position = position;
+	node.spin = spin;
+	node.dirty = true;
+}
+
+int SceneGraph::update(JobSystem* jobs)
+{
+	// position sums in parent first order, gather every node that has to be recomposed
+	int batchCount = 0;
+	for (int i = 0; i < order.size(); i++)
+	{
+		int idx = order[i];
+		Node& node = nodes[idx];
+		Node* parent = node.parent == -1 ? NULL : &nodes[node.parent];
+
+		// a moved parent moves the whole subtree
+		node.changed = node.dirty || (parent != NULL && parent->changed);
+		node.dirty = false;
+		if (!node.changed) continue;
+
+		glm::vec3 parentSum = parent != NULL ? parent->positionSum : glm::vec3(0.f);
+		node.positionSum = node.position + parentSum;
+
+		batchIndex[batchCount] = idx;
+		batchParentsRotation[batchCount] = node.parentsRotation;
+		batchAscendingNode[batchCount] = node.ascendingNode;
+		batchTilt[batchCount] = node.tilt;
+		batchSpin[batchCount] = node.spin;
+		batchScale[batchCount] = node.scale;
+		batchParentOffset[batchCount] = parentSum;
+		batchPosition[batchCount] = node.position;
+		batchCount++;
+	}
+
+	// gathered nodes are independent of each other, ranges can be composed on any thread
+	auto compose = [this](int begin, int end)
+	{
+		TransformBatch batch;
+		batch.count = end - begin;
+		batch.parentsRotation = batchParentsRotation.data() + begin;
+		batch.ascendingNode = batchAscendingNode.data() + begin;
+		batch.tilt = batchTilt.data() + begin;
+		batch.spin = batchSpin.data() + begin;
+		batch.scale = batchScale.data() + begin;
+		batch.parentOffset = batchParentOffset.data() + begin;
+		batch.position = batchPosition.data() + begin;
+		batch.indices = batchIndex.data() + begin;
+		batch.world = worlds.data();
+		batch.worldPosition = worldPositions.data();
+		composeTransforms(batch);
+	};
+	if (jobs != NULL)
+	{
+		jobs->parallelFor(batchCount, 2048, 4, compose);
+	}
+	else
+	{
+		compose(0, batchCount);
+	}
+
+	return batchCount;
+}
+
+const glm::mat4& SceneGraph::getWorld(int idx) { return worlds[idx]; }
+const glm::vec3& SceneGraph::getWorldPosition(int idx) { return worldPositions[idx]; }
+const glm::mat4* SceneGraph::getWorlds() { return worlds.data(); }
+const glm::vec3* SceneGraph::getWorldPositions() { return worldPositions.data(); }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// flat body hierarchy, nodes are kept in parent before child order so every world transform
+// is computed once per frame from the already updated parent (no recursion, no allocation)
+// nodes whose local state and ancestors did not change keep their cached transform, the changed
+// ones are composed together by the simd transform kernel into contiguous matrix arrays
+class SceneGraph
+{
+public:
+
+	// parent index of every node (-1 for root), sorts the nodes parent first
+	void build(const std::vector<int>& parents);
+
+	int getNodeCount();
+	int getParent(int idx);
+
+	// children of a node in index order
+	int getChildCount(int idx);
+	const int* getChildren(int idx);
+
+	// nodes in update order, every parent comes before its children
+	const std::vector<int>& getOrder();
+
+	// out[i] = local[i] + out[parent], e.g. sum of all inclinations up to the root
+	void accumulate(const std::vector<float>& local, std::vector<float>& out);
+
+	// transform parameters that never change after setup (angles in degrees)
+	//   model = Ry(parentsRotation) * T(parent position sum) * Ry(ascendingNode) * T(position)
+	//           * Rz(tilt) * Ry(spin) * S(scale)
+	void setConstants(int idx, float parentsRotation, float ascendingNode, float tilt, float scale);
+
+	// orbit position and spin angle, the node is only recomputed when these changed
+	void setLocal(int idx, const glm::vec3& position, float spin);
+
+	// recompute dirty nodes and their subtrees, returns number of recomputed nodes
+	// the changed nodes are composed in parallel ranges if a job system is given
+	int update(JobSystem* jobs = NULL);
+
+	const glm::mat4& getWorld(int idx);
+	const glm::vec3& getWorldPosition(int idx);
+
+	// every node's world matrix and position, indexed by node (ready for an instance buffer)
+	const glm::mat4* getWorlds();
+	const glm::vec3* getWorldPositions();
+
+private:
+
+	struct Node
+	{
+		int parent = -1;
+
+		// constants
+		float parentsRotation = 0.f;
+		float ascendingNode = 0.f;
+		float tilt = 0.f;
+		float scale = 1.f;
+
+		// local state
+		glm::vec3 position = glm::vec3(0.f);
+		float spin = 0.f;
+		bool dirty = true;
+
+		// cached results
+		glm::vec3 positionSum = glm::vec3(0.f);		// own position plus all parents' positions
+		bool changed = false;						// recomputed during last update
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> order;
+	std::vector<int> childStart;		// children of node i are children[childStart[i], childStart[i + 1])
+	std::vector<int> children;
+	std::vector<glm::mat4> worlds;
+	std::vector<glm::vec3> worldPositions;
+
+	// inputs of the nodes recomposed this update (transform kernel layout)
+	std::vector<int> batchIndex;
+	std::vector<float> batchParentsRotation;
+	std::vector<float> batchAscendingNode;
+	std::vector<float> batchTilt;
+	std::vector<float> batchSpin;
+	std::vector<float> batchScale;
+	std::vector<glm::vec3> batchParentOffset;
+	std::vector<glm::vec3> batchPosition;
+};
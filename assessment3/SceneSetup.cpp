@@ -0,0 +1,328 @@
+#define _USE_MATH_DEFINES
+#include "SceneSetup.h"
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+
+void setupScene(SceneFile& scene, const SceneSettings& settings, std::vector<RenderedBody>& bodies,
+	std::vector<BodyConst>& constants, SceneGraph& graph, OrbitSystem& orbits)
+{
+	PlanetMath m;
+	int count = scene.getBodyCount();
+	int referenceIdx = scene.getReferenceBody();
+
+	constants.resize(scene.getConstantCount());
+	for (int i = 0; i < constants.size(); i++)
+	{
+		const SceneConstant& sc = scene.getConstant(i);
+		constants[i].radius = sc.radius;
+		constants[i].orbitalPeriod = sc.orbitalPeriod;
+		constants[i].localOrbitalPeriod = sc.localOrbitalPeriod;
+		constants[i].ascendingNode = sc.ascendingNode;
+		constants[i].inclination = sc.inclination;
+		constants[i].axialTilt = sc.axialTilt;
+		constants[i].defaultSpinAngle = sc.defaultSpinAngle;
+		constants[i].eccentricity = sc.eccentricity;
+		constants[i].periapsisArgument = sc.periapsisArgument;
+		constants[i].meanAnomaly = sc.meanAnomaly;
+		constants[i].mass = sc.mass;
+		constants[i].naifId = sc.naifId;
+	}
+
+	// configuration and scale relative to the reference body
+	bodies.assign(count, RenderedBody());
+	std::vector<int> parents(count);
+	float referenceRadius = constants[scene.getBody(referenceIdx).constant].radius;
+	int animIndexCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		const SceneBody& sb = scene.getBody(i);
+		RenderedBody& rb = bodies[i];
+		rb.animatorIdx = (sb.flags & SceneFile::BODY_ANIMATED) ? animIndexCount++ : -1;
+		rb.scaleModifier = sb.scaleModifier;
+		rb.distanceMargin = sb.distanceMargin;
+		rb.ovalRatio = sb.ovalRatio;
+		rb.randomSpinAngle = (sb.flags & SceneFile::BODY_RANDOM_SPIN) != 0;
+		rb.orbitParentIdx = sb.parent;
+		rb.bodyConstantIdx = sb.constant;
+		rb.VAOIdx = sb.mesh;
+		rb.textureIdx = sb.texture;
+		rb.modelViewed = (sb.flags & SceneFile::BODY_MODEL_VIEW) != 0;
+		rb.transparent = (sb.flags & SceneFile::BODY_TRANSPARENT) != 0;
+		rb.physics = (sb.flags & SceneFile::BODY_PHYSICS) != 0;
+		rb.periodOrbit = (sb.flags & SceneFile::BODY_PERIOD_ORBIT) != 0;
+		rb.scale = i == referenceIdx ? settings.earthScale
+			: m.getRelativeValue(constants[sb.constant].radius, referenceRadius, settings.earthScale, sb.scaleModifier);
+		parents[i] = sb.parent;
+	}
+	graph.build(parents);
+
+	// orbit radius, bodies around the same parent are laid out one after another in index order:
+	// the first one starts at the parent's surface, the next ones outside the previous sibling
+	// period orbit bodies are placed by their period among the laid out animated siblings instead
+	// (log radius interpolated over log period, kepler's third law beyond them) so catalog asteroids
+	// land between the planets of their period, without such siblings they are laid out after the others
+	std::vector<std::pair<float, float>> references;	// log period, log orbit radius
+	for (int p = 0; p < count; p++)
+	{
+		float parentRadius = bodies[p].scale * settings.sphereObjectRadius;
+		const int* children = graph.getChildren(p);
+		int childCount = graph.getChildCount(p);
+		int previous = -1;
+		auto layOut = [&](RenderedBody& rb)
+		{
+			float margin = rb.distanceMargin * settings.distanceModifier;
+			float radius = rb.scale * settings.sphereObjectRadius;
+			if (previous == -1)
+			{
+				rb.orbitRadius = parentRadius + radius + margin;
+			}
+			else
+			{
+				rb.orbitRadius = bodies[previous].orbitRadius + bodies[previous].scale * settings.sphereObjectRadius + radius + margin;
+			}
+		};
+
+		references.clear();
+		bool periodOrbits = false;
+		for (int c = 0; c < childCount; c++)
+		{
+			RenderedBody& rb = bodies[children[c]];
+			if (rb.periodOrbit)
+			{
+				periodOrbits = true;
+				continue;
+			}
+			layOut(rb);
+			previous = children[c];
+			float period = constants[rb.bodyConstantIdx].orbitalPeriod;
+			if (rb.animatorIdx != -1 && std::isfinite(period) && period > 0.f)
+			{
+				references.push_back(std::make_pair(logf(period), logf(rb.orbitRadius)));
+			}
+		}
+		if (!periodOrbits) continue;
+
+		std::sort(references.begin(), references.end());
+		for (int c = 0; c < childCount; c++)
+		{
+			RenderedBody& rb = bodies[children[c]];
+			if (!rb.periodOrbit) continue;
+			float period = constants[rb.bodyConstantIdx].orbitalPeriod;
+			if (references.empty() || !(std::isfinite(period) && period > 0.f))
+			{
+				layOut(rb);
+				previous = children[c];
+				continue;
+			}
+			float logPeriod = logf(period);
+			auto next = std::lower_bound(references.begin(), references.end(), std::make_pair(logPeriod, -INFINITY));
+			float logRadius;
+			if (next == references.begin() || next == references.end())
+			{
+				const std::pair<float, float>& closest = next == references.end() ? references.back() : *next;
+				logRadius = closest.second + (logPeriod - closest.first) * (2.f / 3.f);
+			}
+			else
+			{
+				const std::pair<float, float>& before = *(next - 1);
+				float t = (logPeriod - before.first) / (next->first - before.first);
+				logRadius = before.second + (next->second - before.second) * t;
+			}
+			rb.orbitRadius = expf(logRadius);
+		}
+	}
+
+	// sum of all parents ascending node angles and of all inclinations including its own
+	std::vector<float> ascendingNodes(count);
+	std::vector<float> inclinations(count);
+	for (int i = 0; i < count; i++)
+	{
+		ascendingNodes[i] = constants[bodies[i].bodyConstantIdx].ascendingNode;
+		inclinations[i] = constants[bodies[i].bodyConstantIdx].inclination;
+	}
+	std::vector<float> ascendingNodeSums;
+	std::vector<float> inclinationSums;
+	graph.accumulate(ascendingNodes, ascendingNodeSums);
+	graph.accumulate(inclinations, inclinationSums);
+
+	// transform constants, bodies that are not animated and not following others only get tilt and scale
+	for (int i = 0; i < count; i++)
+	{
+		RenderedBody& rb = bodies[i];
+		const BodyConst& bc = constants[rb.bodyConstantIdx];
+		if (rb.animatorIdx == -1 && rb.orbitParentIdx == -1)
+		{
+			graph.setConstants(i, 0.f, 0.f, bc.axialTilt, rb.scale);
+		}
+		else
+		{
+			rb.parentsAscendingNodeSum = rb.orbitParentIdx == -1 ? 0.f : ascendingNodeSums[rb.orbitParentIdx];
+			rb.allInclinationSum = inclinationSums[i];
+			graph.setConstants(i, rb.parentsAscendingNodeSum, bc.ascendingNode, bc.axialTilt + rb.allInclinationSum, rb.scale);
+		}
+		graph.setLocal(i, glm::vec3(0.f), 0.f);
+	}
+
+	// one orbit system body per animatorIdx
+	std::vector<float> delays;
+	computeOrbitDelays(bodies, constants, referenceIdx, settings.earthOrbitDelay, delays);
+	orbits.clear();
+	orbits.reserve(animIndexCount);
+	for (int i = 0; i < count; i++)
+	{
+		const RenderedBody& rb = bodies[i];
+		if (rb.animatorIdx == -1) continue;
+		const BodyConst& bc = constants[rb.bodyConstantIdx];
+		orbits.addBody(delays[rb.animatorIdx], bc.localOrbitalPeriod, rb.ovalRatio, rb.orbitRadius, rb.allInclinationSum,
+			bc.eccentricity, bc.periapsisArgument);
+	}
+}
+
+void setupPhysics(SceneFile& scene, const SceneSettings& settings, const std::vector<RenderedBody>& bodies,
+	const std::vector<BodyConst>& constants, SceneGraph& graph, OrbitSystem& orbits, NBodySystem& nbody)
+{
+	nbody.clear();
+	int count = (int)bodies.size();
+	int root = -1;
+	int physicsCount = 0;
+	for (int i = 0; i < count; i++)
+	{
+		if (!bodies[i].physics) continue;
+		root = bodies[i].orbitParentIdx;		// the same static root for all of them (SceneCompiler)
+		physicsCount++;
+	}
+	if (root == -1) return;
+
+	// gravity of the root from kepler's third law, gm = 4 pi^2 a^3 / T^2 of an animated child
+	// (the reference body if it orbits the root)
+	std::vector<float> delays;
+	int referenceIdx = scene.getReferenceBody();
+	computeOrbitDelays(bodies, constants, referenceIdx, settings.earthOrbitDelay, delays);
+	const int* children = graph.getChildren(root);
+	int sample = bodies[referenceIdx].orbitParentIdx == root ? referenceIdx : -1;
+	for (int c = 0; c < graph.getChildCount(root) && sample == -1; c++)
+	{
+		if (bodies[children[c]].animatorIdx != -1) sample = children[c];
+	}
+	double a = bodies[sample].orbitRadius;
+	double period = delays[bodies[sample].animatorIdx];
+	double rootGm = 4.0 * M_PI * M_PI * a * a * a / (period * period);
+
+	// other masses relative to the root's
+	float rootMass = constants[bodies[root].bodyConstantIdx].mass;
+	auto gmOf = [&](int i)
+	{
+		float mass = constants[bodies[i].bodyConstantIdx].mass;
+		return rootMass > 0.f && mass > 0.f ? (float)(rootGm * mass / rootMass) : 0.f;
+	};
+
+	// particles live in the root's frame (after its ascending node), so the ascending node of a physics
+	// body is part of its particle position instead of its transform
+	nbody.reserve(physicsCount);
+	nbody.addAttractor(-1, glm::mat3(1.f), (float)rootGm);
+	const glm::vec3* positions = orbits.getPositions();
+	float radiusSum = 0.f;
+	for (int c = 0; c < graph.getChildCount(root); c++)
+	{
+		int i = children[c];
+		const RenderedBody& rb = bodies[i];
+		const BodyConst& bc = constants[rb.bodyConstantIdx];
+		if (rb.animatorIdx == -1) continue;
+		glm::mat3 node = glm::mat3(glm::rotate(glm::mat4(1.f), glm::radians(bc.ascendingNode), glm::vec3(0.f, 1.f, 0.f)));
+		if (!rb.physics)
+		{
+			// planets stay on their analytic orbits and pull the particles
+			float gm = gmOf(i);
+			if (gm > 0.f) nbody.addAttractor(rb.animatorIdx, node, gm);
+			continue;
+		}
+
+		// start on the orbit with the vis viva speed of its semi major axis
+		glm::vec3 position = node * positions[rb.animatorIdx];
+		glm::vec3 direction = orbits.getVelocity(rb.animatorIdx);
+		float length = glm::length(direction);
+		direction = length > 0.f ? node * (direction / length) : glm::vec3(0.f);
+		double r = glm::length(position);
+		double visViva = 2.0 / r - 1.0 / rb.orbitRadius;
+		float speed = (float)sqrt(rootGm * (visViva > 0.0 ? visViva : 1.0 / r));
+		nbody.addParticle(position, direction * speed, gmOf(i), rb.animatorIdx);
+
+		graph.setConstants(i, rb.parentsAscendingNodeSum, 0.f, bc.axialTilt + rb.allInclinationSum, rb.scale);
+		radiusSum += rb.scale * settings.sphereObjectRadius;
+	}
+
+	// close passes are softened over the size of a body
+	nbody.setSoftening(radiusSum / physicsCount);
+}
+
+int setupEphemeris(const SceneSettings& settings, const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, SpkEphemeris& ephemeris)
+{
+	const int samplesPerOrbit = 256;
+	const double secondsPerDay = 86400.0;
+	ephemeris.clearBodies();
+
+	// ecliptic x (equinox) is the scene's +z (ascending node 0), ecliptic north is +y
+	glm::dmat3 eclipticToScene(glm::dvec3(0.0, 0.0, 1.0), glm::dvec3(1.0, 0.0, 0.0), glm::dvec3(0.0, 1.0, 0.0));
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		const RenderedBody& rb = bodies[i];
+		if (rb.animatorIdx == -1 || rb.physics || rb.orbitParentIdx == -1) continue;
+		const BodyConst& bc = constants[rb.bodyConstantIdx];
+		int center = constants[bodies[rb.orbitParentIdx].bodyConstantIdx].naifId;
+		double start, end;
+		if (bc.naifId == 0 || center == 0 || !ephemeris.getCoverage(bc.naifId, center, start, end)) continue;
+
+		// semi major axis from the distances over one orbit (or as much of it as is covered)
+		double period = std::isfinite(bc.orbitalPeriod) && bc.orbitalPeriod > 0.f ? bc.orbitalPeriod * secondsPerDay : end - start;
+		double from = std::min(std::max(0.0, start), end);
+		double to = std::min(from + period, end);
+		double closest = INFINITY;
+		double farthest = 0.0;
+		for (int s = 0; s <= samplesPerOrbit; s++)
+		{
+			double distance = glm::length(ephemeris.getPosition(bc.naifId, center, from + (to - from) * s / samplesPerOrbit));
+			closest = std::min(closest, distance);
+			farthest = std::max(farthest, distance);
+		}
+		if (!(farthest > 0.0)) continue;
+		double unitsPerKm = rb.orbitRadius / (0.5 * (closest + farthest));
+
+		// the scene graph turns the position by all ascending nodes up to the body's, undo them so
+		// the offset from the parent is the ephemeris direction
+		glm::dmat3 nodes = glm::dmat3(glm::rotate(glm::dmat4(1.0), glm::radians((double)rb.parentsAscendingNodeSum + bc.ascendingNode),
+			glm::dvec3(0.0, 1.0, 0.0)));
+		ephemeris.addBody(bc.naifId, center, rb.animatorIdx, glm::transpose(nodes) * eclipticToScene * unitsPerKm);
+	}
+
+	ephemeris.setStartTime(0.0);
+	ephemeris.setTimeScale(getEphemerisTimeScale(bodies, constants, referenceIdx, settings.earthOrbitDelay));
+	return ephemeris.getBodyCount();
+}
+
+double getEphemerisTimeScale(const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, float referenceDelay)
+{
+	return constants[bodies[referenceIdx].bodyConstantIdx].orbitalPeriod * 86400.0 / referenceDelay;
+}
+
+void computeOrbitDelays(const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, float referenceDelay, std::vector<float>& delays)
+{
+	PlanetMath m;
+	float referencePeriod = constants[bodies[referenceIdx].bodyConstantIdx].orbitalPeriod;
+	delays.clear();
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		if (bodies[i].animatorIdx == -1) continue;
+		if (i == referenceIdx) // use delay specified by user
+		{
+			delays.push_back(referenceDelay);
+		}
+		else // use delay relative to reference delay
+		{
+			delays.push_back(m.getRelativeValue(constants[bodies[i].bodyConstantIdx].orbitalPeriod, referencePeriod, referenceDelay));
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "NBodySystem.h"
+#include "OrbitSystem.h"
+#include "PlanetMath.h"
+#include "SceneFile.h"
+#include "SceneGraph.h"
+#include "SpkEphemeris.h"
+
+// layout hyper params of the whole scene (tweak these to adjust scene)
+struct SceneSettings
+{
+	float sphereObjectRadius = 2.f;		// 3d vertex sphere radius (do not change)
+	float distanceModifier = 240.f;		// master distance margin scale
+	float earthScale = 200.f;			// master scale, size of the reference body
+	float earthOrbitDelay = 3600.f;		// seconds per orbit of the reference body
+};
+
+// turns a loaded scene into rendered bodies, scene graph constants and orbit system bodies
+// (scale, orbit radius layout, delays, inclination and ascending node sums, animators)
+// every step is one pass over the parent first bodies or over the graph's child lists, so
+// setup stays linear in the number of bodies
+void setupScene(SceneFile& scene, const SceneSettings& settings, std::vector<RenderedBody>& bodies,
+	std::vector<BodyConst>& constants, SceneGraph& graph, OrbitSystem& orbits);
+
+// physics bodies (SceneFile::BODY_PHYSICS) become n-body particles around their static root body,
+// starting from their evaluated orbit position with the vis viva speed of their orbit radius, the
+// root's gravity follows from the orbit radius and delay of one of its animated children and the
+// other animated children with a mass stay on their orbits as attractors (call after evaluating
+// the orbit system at its start time)
+void setupPhysics(SceneFile& scene, const SceneSettings& settings, const std::vector<RenderedBody>& bodies,
+	const std::vector<BodyConst>& constants, SceneGraph& graph, OrbitSystem& orbits, NBodySystem& nbody);
+
+// animated bodies (not physics) whose constant and parent's constant have a naif id follow the
+// ephemeris instead of their kepler orbit, in the same orbit frame: distances are scaled so the
+// mean of the closest and farthest distance within one orbital period after J2000 is the laid out
+// orbit radius, and ephemeris time starts at J2000 (the epoch of the kepler elements) and passes at
+// the reference body's orbit delay, returns the number of bodies on the ephemeris
+int setupEphemeris(const SceneSettings& settings, const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, SpkEphemeris& ephemeris);
+
+// ephemeris seconds per simulation second for a reference orbit delay
+double getEphemerisTimeScale(const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, float referenceDelay);
+
+// orbit delay (seconds per orbit) of every animator, relative to the reference body's delay
+void computeOrbitDelays(const std::vector<RenderedBody>& bodies, const std::vector<BodyConst>& constants,
+	int referenceIdx, float referenceDelay, std::vector<float>& delays);
@@ -0,0 +1,193 @@
+#pragma once
+
+#include <emmintrin.h>
+
+// msvc /arch:AVX2 implies fma, gcc and clang report it separately
+#if defined(__AVX2__) && (defined(__FMA__) || defined(_MSC_VER))
+#define SIMD_AVX2
+#include <immintrin.h>
+#endif
+
+// vectorised single precision math used by the batch animation systems
+// sincos is the cephes polynomial (range reduced to [-pi/4,pi/4]), max error ~1e-7 for |x| < 8192
+
+namespace SimdMath
+{
+	// lanes processed per call by the widest enabled instruction set
+#if defined(SIMD_AVX2)
+	const int WIDTH = 8;
+#else
+	const int WIDTH = 4;
+#endif
+
+	inline const char* getInstructionSet()
+	{
+#if defined(SIMD_AVX2)
+		return "AVX2";
+#else
+		return "SSE2";
+#endif
+	}
+
+	// cephes constants
+	const float FOUR_OVER_PI = 1.27323954473516f;
+	const float DP1 = -0.78515625f;
+	const float DP2 = -2.4187564849853515625e-4f;
+	const float DP3 = -3.77489497744594108e-8f;
+	const float SIN_P0 = -1.9515295891e-4f;
+	const float SIN_P1 = 8.3321608736e-3f;
+	const float SIN_P2 = -1.6666654611e-1f;
+	const float COS_P0 = 2.443315711809948e-5f;
+	const float COS_P1 = -1.388731625493765e-3f;
+	const float COS_P2 = 4.166664568298827e-2f;
+
+	// sine and cosine of 4 angles in radians
+	inline void sincos4(__m128 x, __m128& s, __m128& c)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+
+		// sin is odd, work on |x| and put the sign back at the end
+		__m128 signSin = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		// octant, rounded up to even so the remainder is within [-pi/4,pi/4]
+		__m128 y = _mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI));
+		__m128i j = _mm_cvttps_epi32(y);
+		j = _mm_add_epi32(j, _mm_set1_epi32(1));
+		j = _mm_and_si128(j, _mm_set1_epi32(~1));
+		y = _mm_cvtepi32_ps(j);
+
+		// octant decides which polynomial and which sign each result takes
+		__m128i swapSin = _mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29);
+		__m128i signCosI = _mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29);
+		__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		signSin = _mm_xor_ps(signSin, _mm_castsi128_ps(swapSin));
+		__m128 signCos = _mm_castsi128_ps(signCosI);
+
+		// x - y * pi/4 in extended precision
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP1)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP2)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(DP3)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		// cos polynomial
+		__m128 pc = _mm_set1_ps(COS_P0);
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(COS_P1));
+		pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(COS_P2));
+		pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+		pc = _mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		pc = _mm_add_ps(pc, _mm_set1_ps(1.f));
+
+		// sin polynomial
+		__m128 ps = _mm_set1_ps(SIN_P0);
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(SIN_P1));
+		ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(SIN_P2));
+		ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), x), x);
+
+		s = _mm_or_ps(_mm_and_ps(polyMask, ps), _mm_andnot_ps(polyMask, pc));
+		c = _mm_or_ps(_mm_and_ps(polyMask, pc), _mm_andnot_ps(polyMask, ps));
+		s = _mm_xor_ps(s, signSin);
+		c = _mm_xor_ps(c, signCos);
+	}
+
+	// kepler's equation E - e sin(E) = M solved for the eccentric anomaly E, halley steps from
+	// danby's starting guess (M + 0.85 e towards the sign of M)
+	// the step count is fixed so every lane runs the same instructions, 4 reach float
+	// precision for mean anomalies in [-pi,pi] and eccentricities in [0,0.99]
+	const int KEPLER_ITERATIONS = 4;
+
+	// sine and cosine of the eccentric anomaly of 4 orbits
+	inline void kepler4(__m128 m, __m128 e, __m128& sinE, __m128& cosE)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		const __m128 one = _mm_set1_ps(1.f);
+		const __m128 half = _mm_set1_ps(0.5f);
+
+		__m128 x = _mm_add_ps(m, _mm_or_ps(_mm_mul_ps(e, _mm_set1_ps(0.85f)), _mm_and_ps(m, signMask)));
+		__m128 s, c, step;
+		for (int k = 0; k < KEPLER_ITERATIONS; k++)
+		{
+			// f = x - e sin x - M, f' = 1 - e cos x, f'' = e sin x, step = f f' / (f'^2 - f f'' / 2)
+			sincos4(x, s, c);
+			__m128 es = _mm_mul_ps(e, s);
+			__m128 f = _mm_sub_ps(_mm_sub_ps(x, es), m);
+			__m128 d = _mm_sub_ps(one, _mm_mul_ps(e, c));
+			step = _mm_div_ps(_mm_mul_ps(f, d), _mm_sub_ps(_mm_mul_ps(d, d), _mm_mul_ps(_mm_mul_ps(half, f), es)));
+			x = _mm_sub_ps(x, step);
+		}
+
+		// the last step is small, rotate sin and cos by it instead of evaluating them again
+		__m128 cosStep = _mm_sub_ps(one, _mm_mul_ps(half, _mm_mul_ps(step, step)));
+		sinE = _mm_sub_ps(_mm_mul_ps(s, cosStep), _mm_mul_ps(c, step));
+		cosE = _mm_add_ps(_mm_mul_ps(c, cosStep), _mm_mul_ps(s, step));
+	}
+
+#if defined(SIMD_AVX2)
+	// sine and cosine of 8 angles in radians
+	inline void sincos8(__m256 x, __m256& s, __m256& c)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+
+		__m256 signSin = _mm256_and_ps(x, signMask);
+		x = _mm256_andnot_ps(signMask, x);
+
+		__m256 y = _mm256_mul_ps(x, _mm256_set1_ps(FOUR_OVER_PI));
+		__m256i j = _mm256_cvttps_epi32(y);
+		j = _mm256_add_epi32(j, _mm256_set1_epi32(1));
+		j = _mm256_and_si256(j, _mm256_set1_epi32(~1));
+		y = _mm256_cvtepi32_ps(j);
+
+		__m256i swapSin = _mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29);
+		__m256i signCosI = _mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29);
+		__m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+		signSin = _mm256_xor_ps(signSin, _mm256_castsi256_ps(swapSin));
+		__m256 signCos = _mm256_castsi256_ps(signCosI);
+
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(DP1), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(DP2), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(DP3), x);
+		__m256 z = _mm256_mul_ps(x, x);
+
+		__m256 pc = _mm256_set1_ps(COS_P0);
+		pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(COS_P1));
+		pc = _mm256_fmadd_ps(pc, z, _mm256_set1_ps(COS_P2));
+		pc = _mm256_mul_ps(_mm256_mul_ps(pc, z), z);
+		pc = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), pc);
+		pc = _mm256_add_ps(pc, _mm256_set1_ps(1.f));
+
+		__m256 ps = _mm256_set1_ps(SIN_P0);
+		ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(SIN_P1));
+		ps = _mm256_fmadd_ps(ps, z, _mm256_set1_ps(SIN_P2));
+		ps = _mm256_fmadd_ps(_mm256_mul_ps(ps, z), x, x);
+
+		s = _mm256_blendv_ps(pc, ps, polyMask);
+		c = _mm256_blendv_ps(ps, pc, polyMask);
+		s = _mm256_xor_ps(s, signSin);
+		c = _mm256_xor_ps(c, signCos);
+	}
+
+	// sine and cosine of the eccentric anomaly of 8 orbits
+	inline void kepler8(__m256 m, __m256 e, __m256& sinE, __m256& cosE)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+		const __m256 one = _mm256_set1_ps(1.f);
+		const __m256 half = _mm256_set1_ps(0.5f);
+
+		__m256 x = _mm256_add_ps(m, _mm256_or_ps(_mm256_mul_ps(e, _mm256_set1_ps(0.85f)), _mm256_and_ps(m, signMask)));
+		__m256 s, c, step;
+		for (int k = 0; k < KEPLER_ITERATIONS; k++)
+		{
+			sincos8(x, s, c);
+			__m256 es = _mm256_mul_ps(e, s);
+			__m256 f = _mm256_sub_ps(_mm256_sub_ps(x, es), m);
+			__m256 d = _mm256_fnmadd_ps(e, c, one);
+			step = _mm256_div_ps(_mm256_mul_ps(f, d), _mm256_fnmadd_ps(_mm256_mul_ps(half, f), es, _mm256_mul_ps(d, d)));
+			x = _mm256_sub_ps(x, step);
+		}
+
+		__m256 cosStep = _mm256_fnmadd_ps(half, _mm256_mul_ps(step, step), one);
+		sinE = _mm256_fnmadd_ps(c, step, _mm256_mul_ps(s, cosStep));
+		cosE = _mm256_fmadd_ps(s, step, _mm256_mul_ps(c, cosStep));
+	}
+#endif
+}
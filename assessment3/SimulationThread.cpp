@@ -0,0 +1,239 @@
+#include "SimulationThread.h"
+#include <math.h>
+
+SimulationThread::~SimulationThread()
+{
+	stop();
+}
+
+void SimulationThread::start(OrbitSystem* orbits, double tickRate, JobSystem* jobs)
+{
+	this->orbits = orbits;
+	this->jobs = jobs;
+	tickSeconds = 1.0 / tickRate;
+	simulationSeconds = 0.0;
+	evaluateAll = true;
+	epoch = std::chrono::steady_clock::now();
+
+	// allocate every snapshot once, ticks only copy into them
+	size_t count = orbits->getBodyCount();
+	lastState.assign(count, BodyState{ glm::vec3(0.f), 0.f });
+	for (int i = 0; i < 3; i++)
+	{
+		snapshots[i].previous.assign(count, BodyState{ glm::vec3(0.f), 0.f });
+		snapshots[i].current.assign(count, BodyState{ glm::vec3(0.f), 0.f });
+		snapshots[i].tick = -1;
+	}
+	backIdx = 0;
+	frontIdx = 1;
+	middle = 2;
+
+	// initial positions before the first frame is drawn
+	evaluate();
+	publish(0.0);
+	publish(0.0);	// previous == current
+
+	running = true;
+	thread = std::thread(&SimulationThread::run, this);
+}
+
+void SimulationThread::stop()
+{
+	if (!running) return;
+	running = false;
+	thread.join();
+}
+
+void SimulationThread::post(std::function<void()> command)
+{
+	std::lock_guard<std::mutex> lock(commandMutex);
+	commands.push_back(command);
+}
+
+void SimulationThread::setScheduler(UpdateScheduler* scheduler)
+{
+	this->scheduler = scheduler;
+}
+
+void SimulationThread::setNBody(NBodySystem* nbody, int tickInterval)
+{
+	this->nbody = nbody;
+	nbodyInterval = tickInterval > 1 ? tickInterval : 1;
+}
+
+void SimulationThread::setEphemeris(SpkEphemeris* ephemeris)
+{
+	this->ephemeris = ephemeris;
+}
+
+void SimulationThread::setCommandCallback(void (*callback)())
+{
+	commandCallback = callback;
+}
+
+void SimulationThread::setPaused(bool value)
+{
+	paused = value;
+}
+
+void SimulationThread::seek(double seconds)
+{
+	// a jump can't be extrapolated
+	post([this, seconds]()
+	{
+		simulationSeconds = seconds;
+		evaluateAll = true;
+	});
+}
+
+long long SimulationThread::getTickCount()
+{
+	return tickCount;
+}
+
+double SimulationThread::getPhysicsEnergyDrift()
+{
+	return energyDrift;
+}
+
+double SimulationThread::secondsSinceStart()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void SimulationThread::run()
+{
+	auto tickDuration = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+		std::chrono::duration<double>(tickSeconds));
+	auto nextTick = std::chrono::steady_clock::now();
+
+	while (running)
+	{
+		nextTick += tickDuration;
+		auto now = std::chrono::steady_clock::now();
+		if (now - nextTick > tickDuration * 8) nextTick = now;	// stalled (debugger, sleep), do not burst
+		else std::this_thread::sleep_until(nextTick);
+
+		{
+			std::lock_guard<std::mutex> lock(commandMutex);
+			pendingCommands.swap(commands);
+		}
+		bool changed = !pendingCommands.empty();
+		for (int i = 0; i < pendingCommands.size(); i++)
+		{
+			pendingCommands[i]();
+		}
+		pendingCommands.clear();
+
+		if (!paused)
+		{
+			simulationSeconds += tickSeconds;
+			evaluate();
+			if (nbody != NULL && ++nbodyTicks >= nbodyInterval)
+			{
+				nbody->step(*orbits, tickSeconds * nbodyInterval, jobs);
+				nbodyTicks = 0;
+				energyDrift = startEnergy != 0.0 ? (nbody->getEnergy() - startEnergy) / fabs(startEnergy) : 0.0;
+			}
+			publish(secondsSinceStart());
+			tickCount++;
+		}
+		else if (changed)
+		{
+			// paused, show the change without interpolating from the old state
+			evaluate();
+			publish(secondsSinceStart());
+			publish(secondsSinceStart());
+		}
+
+		if (changed && commandCallback != NULL) commandCallback();
+	}
+}
+
+void SimulationThread::evaluate()
+{
+	if (scheduler == NULL || evaluateAll) orbits->evaluate(simulationSeconds, jobs);
+	else orbits->evaluateScheduled(simulationSeconds, scheduler->schedule(*orbits, tickCount), jobs);
+	applyEphemeris();
+
+	if (evaluateAll && nbody != NULL)
+	{
+		// start or seek, attractors jump (steps move them otherwise), the energy is measured from here
+		nbody->syncAttractors(*orbits);
+		nbody->computeForces(jobs);
+		startEnergy = nbody->getEnergy();
+		energyDrift = 0.0;
+		nbodyTicks = 0;
+	}
+	evaluateAll = false;
+}
+
+void SimulationThread::applyEphemeris()
+{
+	if (ephemeris == NULL) return;
+	ephemeris->evaluate(simulationSeconds);
+	orbits->setPositions(ephemeris->getOrbitIndices(), ephemeris->getPositions(), ephemeris->getBodyCount());
+}
+
+void SimulationThread::publish(double tickTime)
+{
+	Snapshot& back = snapshots[backIdx];
+	const glm::vec3* positions = orbits->getPositions();
+	const float* spinAngles = orbits->getSpinAngles();
+
+	back.previous = lastState;
+	for (int i = 0; i < back.current.size(); i++)
+	{
+		back.current[i].position = positions[i];
+		back.current[i].rotation = spinAngles[i];
+	}
+	if (nbody != NULL)
+	{
+		const glm::vec3* particles = nbody->getPositions();
+		const int* orbitIndices = nbody->getOrbitIndices();
+		float sinceStep = (float)(nbodyTicks * tickSeconds);
+		for (int p = 0; p < nbody->getParticleCount(); p++)
+		{
+			if (orbitIndices[p] == -1) continue;
+			glm::vec3 position = particles[p];
+			if (nbodyTicks > 0) position += nbody->getVelocity(p) * sinceStep;
+			back.current[orbitIndices[p]].position = position;
+		}
+	}
+	back.tickTime = tickTime;
+	back.tick = tickCount;
+	lastState = back.current;
+
+	// hand the filled slot over, take the one the reader is not using
+	backIdx = middle.exchange(backIdx | DIRTY) & 3;
+}
+
+bool SimulationThread::sample(std::vector<BodyState>& states)
+{
+	if (middle.load() & DIRTY)
+	{
+		frontIdx = middle.exchange(frontIdx) & 3;
+	}
+
+	Snapshot& front = snapshots[frontIdx];
+	if (front.tick < 0) return false;
+
+	// rendering one tick behind, blend towards the newest state as time passes
+	float alpha = (float)((secondsSinceStart() - front.tickTime) / tickSeconds);
+	alpha = glm::clamp(alpha, 0.f, 1.f);
+
+	states.resize(front.current.size());
+	for (int i = 0; i < front.current.size(); i++)
+	{
+		const BodyState& a = front.previous[i];
+		const BodyState& b = front.current[i];
+		states[i].position = glm::mix(a.position, b.position, alpha);
+
+		// shortest way around 360
+		float delta = b.rotation - a.rotation;
+		if (delta > 180.f) delta -= 360.f;
+		if (delta < -180.f) delta += 360.f;
+		states[i].rotation = a.rotation + delta * alpha;
+	}
+	return true;
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "JobSystem.h"
+#include "NBodySystem.h"
+#include "OrbitSystem.h"
+#include "SpkEphemeris.h"
+#include "UpdateScheduler.h"
+
+// animated state of one body (indexed like the orbit system bodies)
+struct BodyState
+{
+	glm::vec3 position;
+	float rotation;		// spin angle in degrees
+};
+
+// runs orbit and spin animation on its own thread at a fixed tick rate
+// every tick publishes the previous and current body states through a lock free triple
+// buffer, the render thread samples them interpolated at its own frame time
+// once started the orbit system belongs to this thread, change it through post()
+class SimulationThread
+{
+public:
+
+	~SimulationThread();
+
+	// ticks split the orbit evaluation over jobs if given
+	void start(OrbitSystem* orbits, double tickRate, JobSystem* jobs = NULL);
+
+	// evaluate only the bodies the scheduler picks on a tick and extrapolate the others
+	// (NULL = every body every tick), set before start
+	void setScheduler(UpdateScheduler* scheduler);
+
+	// step the particles after the orbit evaluation of every tickInterval-th tick by tickInterval
+	// ticks and publish their positions instead of their orbit positions (NULL = no physics), in
+	// between they move along their velocity, set before start
+	// a seek moves the attractors to the new time, the particles stay where they are
+	void setNBody(NBodySystem* nbody, int tickInterval = 1);
+
+	// move the ephemeris bodies to their ephemeris positions after every orbit evaluation, before the
+	// particles see them (NULL = none), set before start
+	void setEphemeris(SpkEphemeris* ephemeris);
+	void stop();
+
+	// queue a change of the orbit system, executed on the simulation thread before its next tick
+	// (bodies are then re evaluated and published even while paused)
+	void post(std::function<void()> command);
+
+	// called on the simulation thread after a command was applied (e.g. to wake the renderer)
+	void setCommandCallback(void (*callback)());
+
+	void setPaused(bool paused);
+
+	// jump animation time to given seconds, bodies are evaluated in closed form so this is O(1)
+	void seek(double seconds);
+
+	// states interpolated between the last two ticks for the current time
+	// returns false until the first tick was published
+	bool sample(std::vector<BodyState>& states);
+
+	long long getTickCount();
+
+	// relative change of the particles' energy since start or the last seek, includes work done by
+	// moving attractors
+	double getPhysicsEnergyDrift();
+
+private:
+
+	struct Snapshot
+	{
+		std::vector<BodyState> previous;
+		std::vector<BodyState> current;
+		double tickTime = 0.0;			// seconds since start of current state
+		long long tick = -1;
+	};
+
+	static const int DIRTY = 4;
+
+	OrbitSystem* orbits = NULL;
+	JobSystem* jobs = NULL;
+	UpdateScheduler* scheduler = NULL;
+	NBodySystem* nbody = NULL;
+	SpkEphemeris* ephemeris = NULL;
+	int nbodyInterval = 1;
+	int nbodyTicks = 0;					// ticks since the last particle step
+	double startEnergy = 0.0;
+	std::atomic<double> energyDrift{ 0.0 };
+	bool evaluateAll = true;			// next tick evaluates every body (start, seek)
+	double tickSeconds = 1.0 / 120.0;
+	double simulationSeconds = 0.0;		// animation time, only advances while not paused
+	std::chrono::steady_clock::time_point epoch;
+
+	std::thread thread;
+	std::atomic<bool> running{ false };
+	std::atomic<bool> paused{ false };
+	std::atomic<long long> tickCount{ 0 };
+
+	// commands from other threads
+	std::mutex commandMutex;
+	std::vector<std::function<void()>> commands;
+	std::vector<std::function<void()>> pendingCommands;	// simulation thread copy
+	void (*commandCallback)() = NULL;
+
+	// triple buffer, writer owns back, reader owns front, middle is swapped atomically
+	Snapshot snapshots[3];
+	int backIdx = 0;
+	int frontIdx = 1;
+	std::atomic<int> middle{ 2 };		// slot index, DIRTY set when not yet read
+	std::vector<BodyState> lastState;
+
+	void run();
+	void evaluate();
+	void applyEphemeris();
+	void publish(double tickTime);
+	double secondsSinceStart();
+};
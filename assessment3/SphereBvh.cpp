@@ -0,0 +1,393 @@
+#include "SphereBvh.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <atomic>
+#include <math.h>
+#include <string.h>
+
+void SphereBvh::resize(int count)
+{
+	this->count = count;
+	spheres.assign(count, glm::vec4(0.f));
+	buildSpheres.assign(count, glm::vec4(0.f));
+	items.resize(count);
+	slots.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		items[i] = i;
+		slots[i] = i;
+	}
+	nodes.clear();
+}
+
+void SphereBvh::setSphere(int index, const glm::vec3& center, float radius)
+{
+	spheres[slots[index]] = glm::vec4(center, radius);
+}
+
+int SphereBvh::getCount() { return count; }
+void SphereBvh::setRebuildRatio(float ratio) { rebuildRatio = ratio; }
+int SphereBvh::getRebuildCount() { return rebuildCount; }
+
+void SphereBvh::build()
+{
+	// capacity is kept, so rebuilding with the same count never allocates
+	nodes.clear();
+	nodes.reserve(count > 0 ? 2 * count : 1);
+	subtreeRoots.clear();
+	subtreeEnds.clear();
+	topNodes.clear();
+	subtreeRoots.reserve(1 << SUBTREE_DEPTH);
+	subtreeEnds.reserve(1 << SUBTREE_DEPTH);
+	topNodes.reserve(1 << SUBTREE_DEPTH);
+	subtreeArea.resize(1 << SUBTREE_DEPTH);
+
+	// split the sphere indices, then store the spheres in the new slot order
+	for (int slot = 0; slot < count; slot++) buildSpheres[items[slot]] = spheres[slot];
+	for (int i = 0; i < count; i++) items[i] = i;
+	if (count > 0) buildNode(0, count, 0);
+	for (int slot = 0; slot < count; slot++)
+	{
+		spheres[slot] = buildSpheres[items[slot]];
+		slots[items[slot]] = slot;
+	}
+	builtArea = refitRange(0, (int)nodes.size());
+	rebuildCount++;
+}
+
+int SphereBvh::buildNode(int first, int count, int depth)
+{
+	int idx = (int)nodes.size();
+	nodes.push_back(Node());
+	nodes[idx].first = first;
+	nodes[idx].count = count;
+	nodes[idx].right = -1;
+	bool subtreeRoot = depth == SUBTREE_DEPTH || (depth < SUBTREE_DEPTH && count <= LEAF_SIZE);
+	if (subtreeRoot) subtreeRoots.push_back(idx);
+
+	if (count > LEAF_SIZE)
+	{
+		// split at the median center along the longest axis of the centers
+		glm::vec3 lo = glm::vec3(buildSpheres[items[first]]);
+		glm::vec3 hi = lo;
+		for (int i = first + 1; i < first + count; i++)
+		{
+			lo = glm::min(lo, glm::vec3(buildSpheres[items[i]]));
+			hi = glm::max(hi, glm::vec3(buildSpheres[items[i]]));
+		}
+		glm::vec3 extent = hi - lo;
+		int axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+		int half = count / 2;
+		const glm::vec4* s = buildSpheres.data();
+		std::nth_element(items.begin() + first, items.begin() + first + half, items.begin() + first + count,
+			[s, axis](int a, int b) { return s[a][axis] < s[b][axis]; });
+
+		buildNode(first, half, depth + 1);
+		int right = buildNode(first + half, count - half, depth + 1);
+		nodes[idx].right = right;
+	}
+
+	if (subtreeRoot) subtreeEnds.push_back((int)nodes.size());
+	else if (depth < SUBTREE_DEPTH) topNodes.push_back(idx);
+	return idx;
+}
+
+float SphereBvh::fitNode(int idx)
+{
+	Node& node = nodes[idx];
+	if (node.count <= LEAF_SIZE)
+	{
+		const glm::vec4* s = spheres.data() + node.first;
+		node.min = glm::vec3(s[0]) - s[0].w;
+		node.max = glm::vec3(s[0]) + s[0].w;
+		for (int i = 1; i < node.count; i++)
+		{
+			node.min = glm::min(node.min, glm::vec3(s[i]) - s[i].w);
+			node.max = glm::max(node.max, glm::vec3(s[i]) + s[i].w);
+		}
+	}
+	else
+	{
+		const Node& left = nodes[idx + 1];
+		const Node& right = nodes[node.right];
+		node.min = glm::min(left.min, right.min);
+		node.max = glm::max(left.max, right.max);
+	}
+	glm::vec3 size = node.max - node.min;
+	return 2.f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+float SphereBvh::refitRange(int begin, int end)
+{
+	// children come after their parent, so going backwards fits them first
+	float area = 0.f;
+	for (int n = end - 1; n >= begin; n--)
+	{
+		area += fitNode(n);
+	}
+	return area;
+}
+
+bool SphereBvh::refit(JobSystem* jobs)
+{
+	if (nodes.empty())
+	{
+		build();
+		return true;
+	}
+
+	int subtreeCount = (int)subtreeRoots.size();
+	auto refitSubtrees = [this](int begin, int end)
+	{
+		for (int s = begin; s < end; s++) subtreeArea[s] = refitRange(subtreeRoots[s], subtreeEnds[s]);
+	};
+	if (jobs != NULL) jobs->parallelFor(subtreeCount, 1, refitSubtrees);
+	else refitSubtrees(0, subtreeCount);
+
+	float area = 0.f;
+	for (int s = 0; s < subtreeCount; s++) area += subtreeArea[s];
+	for (int t = 0; t < topNodes.size(); t++) area += fitNode(topNodes[t]);
+
+	if (area > builtArea * rebuildRatio)
+	{
+		build();
+		return true;
+	}
+	return false;
+}
+
+int SphereBvh::raycast(const glm::vec3& origin, const glm::vec3& direction, const unsigned char* selectable, float* hitDistance)
+{
+	if (nodes.empty()) return -1;
+
+	glm::vec3 invDirection = 1.f / direction;
+	float best = INFINITY;
+	int bestIdx = -1;
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		int idx = stack[--stackSize];
+		const Node& node = nodes[idx];
+
+		// slab test, skip boxes behind the ray or farther than the best hit
+		glm::vec3 t0 = (node.min - origin) * invDirection;
+		glm::vec3 t1 = (node.max - origin) * invDirection;
+		glm::vec3 tNear = glm::min(t0, t1);
+		glm::vec3 tFar = glm::max(t0, t1);
+		float enter = fmaxf(fmaxf(tNear.x, tNear.y), fmaxf(tNear.z, 0.f));
+		float exit = fminf(fminf(tFar.x, tFar.y), tFar.z);
+		if (enter > exit || enter > best) continue;
+
+		if (node.count > LEAF_SIZE)
+		{
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = idx + 1;
+			continue;
+		}
+		for (int slot = node.first; slot < node.first + node.count; slot++)
+		{
+			if (selectable != NULL && !selectable[items[slot]]) continue;
+
+			// |origin + t * direction - center| = radius, a ray starting inside hits at 0
+			// discriminant from the distance of the center to the ray line (b * b - c cancels out
+			// for small far away spheres)
+			const glm::vec4& s = spheres[slot];
+			glm::vec3 offset = origin - glm::vec3(s);
+			float b = glm::dot(offset, direction);
+			float c = glm::dot(offset, offset) - s.w * s.w;
+			glm::vec3 perpendicular = offset - b * direction;
+			float discriminant = s.w * s.w - glm::dot(perpendicular, perpendicular);
+			if (discriminant < 0.f) continue;
+			float t = c <= 0.f ? 0.f : -b - sqrtf(discriminant);
+			if (t < 0.f || t >= best) continue;
+			best = t;
+			bestIdx = items[slot];
+		}
+	}
+
+	if (hitDistance != NULL) *hitDistance = best;
+	return bestIdx;
+}
+
+float SphereBvh::sphereDistance(const glm::vec3& point, int slot)
+{
+	return fmaxf(glm::length(point - glm::vec3(spheres[slot])) - spheres[slot].w, 0.f);
+}
+
+float SphereBvh::boxDistance(const glm::vec3& point, const Node& node)
+{
+	glm::vec3 outside = glm::max(glm::max(node.min - point, point - node.max), glm::vec3(0.f));
+	return glm::length(outside);
+}
+
+void SphereBvh::nearest(const glm::vec3& point, int k, std::vector<int>& out, const unsigned char* selectable)
+{
+	out.clear();
+	if (nodes.empty() || k <= 0) return;
+
+	// depth first, nearer child first, boxes farther than the current k-th result are skipped
+	// out holds slots sorted by distance (insertion, k is small) until they are turned into indices
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		int idx = stack[--stackSize];
+		const Node& node = nodes[idx];
+		float worst = out.size() == k ? sphereDistance(point, out.back()) : INFINITY;
+		if (boxDistance(point, node) >= worst) continue;
+
+		if (node.count > LEAF_SIZE)
+		{
+			int nearChild = idx + 1;
+			int farChild = node.right;
+			if (boxDistance(point, nodes[farChild]) < boxDistance(point, nodes[nearChild])) std::swap(nearChild, farChild);
+			stack[stackSize++] = farChild;
+			stack[stackSize++] = nearChild;
+			continue;
+		}
+		for (int slot = node.first; slot < node.first + node.count; slot++)
+		{
+			if (selectable != NULL && !selectable[items[slot]]) continue;
+			float distance = sphereDistance(point, slot);
+			if (out.size() == k)
+			{
+				if (distance >= sphereDistance(point, out.back())) continue;
+				out.pop_back();
+			}
+			int position = (int)out.size();
+			out.push_back(slot);
+			while (position > 0 && sphereDistance(point, out[position - 1]) > distance)
+			{
+				out[position] = out[position - 1];
+				position--;
+			}
+			out[position] = slot;
+		}
+	}
+	for (int i = 0; i < out.size(); i++) out[i] = items[out[i]];
+}
+
+void SphereBvh::overlap(const glm::vec3& center, float radius, std::vector<int>& out)
+{
+	out.clear();
+	if (nodes.empty()) return;
+
+	int stack[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
+	{
+		int idx = stack[--stackSize];
+		const Node& node = nodes[idx];
+		if (boxDistance(center, node) > radius) continue;
+
+		if (node.count > LEAF_SIZE)
+		{
+			stack[stackSize++] = node.right;
+			stack[stackSize++] = idx + 1;
+			continue;
+		}
+		for (int slot = node.first; slot < node.first + node.count; slot++)
+		{
+			float reach = radius + spheres[slot].w;
+			glm::vec3 offset = center - glm::vec3(spheres[slot]);
+			if (glm::dot(offset, offset) <= reach * reach) out.push_back(items[slot]);
+		}
+	}
+}
+
+int SphereBvh::cullFrustum(const glm::vec4* planes, unsigned char* visible, JobSystem* jobs)
+{
+	memset(visible, 0, count);
+	if (nodes.empty()) return 0;
+
+	int subtreeCount = (int)subtreeRoots.size();
+	if (jobs == NULL)
+	{
+		int visibleCount = 0;
+		for (int s = 0; s < subtreeCount; s++) visibleCount += cullSubtree(subtreeRoots[s], planes, visible);
+		return visibleCount;
+	}
+
+	std::atomic<int> visibleSum{ 0 };
+	jobs->parallelFor(subtreeCount, 1, [this, planes, visible, &visibleSum](int begin, int end)
+	{
+		int visibleInRange = 0;
+		for (int s = begin; s < end; s++) visibleInRange += cullSubtree(subtreeRoots[s], planes, visible);
+		visibleSum.fetch_add(visibleInRange, std::memory_order_relaxed);
+	});
+	return visibleSum.load();
+}
+
+int SphereBvh::cullSubtree(int root, const glm::vec4* planes, unsigned char* visible)
+{
+	// every stack entry carries the planes its parent box crossed, planes the parent was
+	// completely inside of are not tested again below it
+	int visibleCount = 0;
+	int stack[STACK_SIZE];
+	int stackPlanes[STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize] = root;
+	stackPlanes[stackSize++] = 63;
+	while (stackSize > 0)
+	{
+		stackSize--;
+		int idx = stack[stackSize];
+		int planeMask = stackPlanes[stackSize];
+		const Node& node = nodes[idx];
+
+		// box center distance against its extent along every plane normal
+		glm::vec3 center = (node.min + node.max) * 0.5f;
+		glm::vec3 extent = (node.max - node.min) * 0.5f;
+		bool outside = false;
+		int crossed = 0;
+		for (int p = 0; p < 6; p++)
+		{
+			if ((planeMask & (1 << p)) == 0) continue;
+			glm::vec3 normal = glm::vec3(planes[p]);
+			float distance = glm::dot(normal, center) + planes[p].w;
+			float reach = glm::dot(glm::abs(normal), extent);
+			if (distance + reach < 0.f)
+			{
+				outside = true;
+				break;
+			}
+			if (distance - reach < 0.f) crossed |= 1 << p;
+		}
+		if (outside) continue;
+
+		if (crossed == 0)
+		{
+			for (int slot = node.first; slot < node.first + node.count; slot++) visible[items[slot]] = 1;
+			visibleCount += node.count;
+		}
+		else if (node.count > LEAF_SIZE)
+		{
+			stack[stackSize] = node.right;
+			stackPlanes[stackSize++] = crossed;
+			stack[stackSize] = idx + 1;
+			stackPlanes[stackSize++] = crossed;
+		}
+		else
+		{
+			for (int slot = node.first; slot < node.first + node.count; slot++)
+			{
+				const glm::vec4& s = spheres[slot];
+				bool sphereVisible = true;
+				for (int p = 0; p < 6; p++)
+				{
+					if ((crossed & (1 << p)) == 0) continue;
+					float d = planes[p].w + s.x * planes[p].x + s.y * planes[p].y + s.z * planes[p].z;
+					if (!(d >= -s.w)) sphereVisible = false;
+				}
+				visible[items[slot]] = sphereVisible;
+				visibleCount += sphereVisible;
+			}
+		}
+	}
+	return visibleCount;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// bounding volume hierarchy over bounding spheres (one per body) for ray picking, nearest body
+// and radius queries and hierarchical frustum culling
+// the tree is built top down with median splits, afterwards every frame only refits the node
+// boxes to the moved spheres (independent subtrees in parallel) and rebuilds once refitting let
+// the boxes grow too loose
+// nodes are stored depth first, a node's left child follows it and its subtree is one range
+class SphereBvh
+{
+public:
+
+	static const int LEAF_SIZE = 4;			// max spheres per leaf
+
+	// number of spheres, the tree is built on the next refit
+	void resize(int count);
+	void setSphere(int index, const glm::vec3& center, float radius);
+	int getCount();
+
+	// build the tree from the current spheres
+	void build();
+
+	// fit node boxes to the current spheres, builds instead if there is no tree yet or the summed
+	// box area reached rebuildRatio times the area right after the last build
+	// returns true if the tree was rebuilt
+	bool refit(JobSystem* jobs = NULL);
+	void setRebuildRatio(float ratio);
+	int getRebuildCount();
+
+	// closest sphere hit by a ray (normalised direction), -1 if none, selectable filters spheres (NULL = all)
+	int raycast(const glm::vec3& origin, const glm::vec3& direction, const unsigned char* selectable = NULL, float* hitDistance = NULL);
+
+	// up to k spheres whose surface is closest to point, nearest first (a point inside counts as 0)
+	void nearest(const glm::vec3& point, int k, std::vector<int>& out, const unsigned char* selectable = NULL);
+
+	// every sphere intersecting the sphere (center, radius)
+	void overlap(const glm::vec3& center, float radius, std::vector<int>& out);
+
+	// visible[i] = sphere i not completely behind any of the 6 planes (same test as FrustumCuller),
+	// boxes completely inside or outside decide their whole subtree at once, returns visible count
+	int cullFrustum(const glm::vec4* planes, unsigned char* visible, JobSystem* jobs = NULL);
+
+private:
+
+	struct Node
+	{
+		glm::vec3 min;
+		int right;				// right child, left child is the next node
+		glm::vec3 max;
+		int first;				// sphere slots [first, first + count)
+		int count;				// leaf if count <= LEAF_SIZE
+	};
+
+	static const int SUBTREE_DEPTH = 6;		// up to 64 subtrees refitted and culled in parallel
+	static const int STACK_SIZE = 64;		// median splits keep the depth at log2 of the count
+
+	int count = 0;
+	std::vector<Node> nodes;
+
+	// spheres (center, radius) are kept in tree order so refitting streams through them,
+	// every node covers one range of slots
+	std::vector<glm::vec4> spheres;			// by slot
+	std::vector<int> items;					// sphere index of every slot
+	std::vector<int> slots;					// slot of every sphere index
+	std::vector<glm::vec4> buildSpheres;	// by sphere index while building
+
+	// nodes at SUBTREE_DEPTH (or shallower leaves) and their ends, and the nodes above them
+	// (children before parents)
+	std::vector<int> subtreeRoots;
+	std::vector<int> subtreeEnds;
+	std::vector<int> topNodes;
+	std::vector<float> subtreeArea;
+
+	float builtArea = 0.f;
+	float rebuildRatio = 2.f;
+	int rebuildCount = 0;
+
+	int buildNode(int first, int count, int depth);
+	float fitNode(int idx);						// box from children or spheres, returns its area
+	float refitRange(int begin, int end);		// nodes [begin, end) in reverse, returns area sum
+	int cullSubtree(int root, const glm::vec4* planes, unsigned char* visible);
+	float sphereDistance(const glm::vec3& point, int slot);
+	static float boxDistance(const glm::vec3& point, const Node& node);
+};
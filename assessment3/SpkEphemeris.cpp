@@ -0,0 +1,374 @@
+#define _USE_MATH_DEFINES
+#include "SpkEphemeris.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string.h>
+
+// DAF layout: 1024 byte records of 128 doubles, addresses count doubles from 1
+static const size_t RECORD_BYTES = 1024;
+static const size_t RECORD_WORDS = 128;
+
+// J2000 equator to ecliptic, IAU 1976 obliquity of 84381.448 arcseconds
+static const double OBLIQUITY = 84381.448 / 3600.0 * (M_PI / 180.0);
+static const double OBLIQUITY_COS = cos(OBLIQUITY);
+static const double OBLIQUITY_SIN = sin(OBLIQUITY);
+
+void SpkEphemeris::load(const std::string& path)
+{
+	if (!file.open(path))
+	{
+		throw std::runtime_error("can't open ephemeris file " + path);
+	}
+	try
+	{
+		load(file.getData(), file.getSize());
+	}
+	catch (const std::runtime_error& e)
+	{
+		file.close();
+		throw std::runtime_error(path + ": " + e.what());
+	}
+}
+
+void SpkEphemeris::load(const void* data, size_t size)
+{
+	this->data = (const char*)data;
+	this->size = size;
+	segments.clear();
+	targets.clear();
+	clearBodies();
+	if (size < RECORD_BYTES || ((uintptr_t)data & 7) != 0 || memcmp(data, "DAF/SPK ", 8) != 0)
+	{
+		throw std::runtime_error("not a DAF/SPK file");
+	}
+
+	// byte order of the writer, files without one are in ours
+	uint16_t one = 1;
+	bool littleEndian = *(const char*)&one == 1;
+	swapBytes = (memcmp(this->data + 88, "BIG-IEEE", 8) == 0 && littleEndian)
+		|| (memcmp(this->data + 88, "LTL-IEEE", 8) == 0 && !littleEndian);
+
+	// spk summaries are two times (start, end) and six integers
+	if (readInt(8) != 2 || readInt(12) != 6)
+	{
+		throw std::runtime_error("unexpected summary format");
+	}
+	readSummaries(readInt(76));
+	resolveChains();
+}
+
+void SpkEphemeris::readSummaries(int firstRecord)
+{
+	// doubly linked list of summary records, each followed by a record of names
+	int record = firstRecord;
+	size_t recordCount = size / RECORD_BYTES;
+	size_t visited = 0;
+	while (record != 0)
+	{
+		if (record < 2 || (size_t)record > recordCount || ++visited > recordCount)
+		{
+			throw std::runtime_error("corrupt summary records");
+		}
+		size_t word = (record - 1) * RECORD_WORDS;
+		int next = (int)readDouble(word);
+		int summaryCount = (int)readDouble(word + 2);
+		if (summaryCount < 0 || summaryCount > 25)
+		{
+			throw std::runtime_error("corrupt summary records");
+		}
+
+		for (int n = 0; n < summaryCount; n++)
+		{
+			size_t summary = word + 3 + n * 5;
+			size_t ints = (summary + 2) * 8;
+			int target = readInt(ints);
+			int center = readInt(ints + 4);
+			int frame = readInt(ints + 8);
+			int type = readInt(ints + 12);
+			int first = readInt(ints + 16);
+			int last = readInt(ints + 20);
+			if ((type != 2 && type != 3) || (frame != 1 && frame != 17)) continue;
+			if (first < 1 || last < first + 4 || (size_t)last * 8 > size)
+			{
+				throw std::runtime_error("corrupt segment of body " + std::to_string(target));
+			}
+
+			// the segment ends with the start and length of its records, doubles per record and record count
+			Segment segment;
+			segment.target = target;
+			segment.center = center;
+			segment.centerTarget = -1;
+			segment.equatorial = frame == 1;
+			segment.start = readDouble(summary);
+			segment.end = readDouble(summary + 1);
+			segment.initialTime = readDouble(last - 4);
+			segment.intervalLength = readDouble(last - 3);
+			segment.recordSize = (int)readDouble(last - 2);
+			segment.recordCount = (int)readDouble(last - 1);
+			segment.firstWord = first - 1;
+			int components = type == 2 ? 3 : 6;
+			segment.coefficientCount = (segment.recordSize - 2) / components;
+			if (segment.coefficientCount < 1 || segment.recordSize != 2 + segment.coefficientCount * components
+				|| segment.recordCount < 1 || !(segment.intervalLength > 0.0) || !(segment.start <= segment.end)
+				|| (size_t)segment.recordSize * segment.recordCount + 4 != (size_t)(last - first + 1))
+			{
+				throw std::runtime_error("corrupt segment of body " + std::to_string(target));
+			}
+			segments.push_back(segment);
+		}
+		record = next;
+	}
+}
+
+void SpkEphemeris::resolveChains()
+{
+	// one target per body, later segments take priority, segments relative to another center than
+	// the first one are skipped so every segment of a target continues on the same chain
+	for (int s = (int)segments.size() - 1; s >= 0; s--)
+	{
+		int idx = findTarget(segments[s].target);
+		if (idx == -1)
+		{
+			Target target;
+			target.naifId = segments[s].target;
+			target.segment = s;
+			target.stamp = -1;
+			auto it = std::lower_bound(targets.begin(), targets.end(), target.naifId,
+				[](const Target& t, int id) { return t.naifId < id; });
+			it = targets.insert(it, target);
+			idx = (int)(it - targets.begin());
+		}
+		std::vector<int>& targetSegments = targets[idx].segments;
+		if (targetSegments.empty() || segments[targetSegments[0]].center == segments[s].center) targetSegments.push_back(s);
+	}
+	for (int s = 0; s < segments.size(); s++) segments[s].centerTarget = findTarget(segments[s].center);
+
+	// root and coverage along the chain of centers
+	for (int t = 0; t < targets.size(); t++)
+	{
+		Target& target = targets[t];
+		target.start = -INFINITY;
+		target.end = INFINITY;
+		int idx = t;
+		int steps = 0;
+		while (idx != -1)
+		{
+			if (++steps > targets.size()) throw std::runtime_error("body " + std::to_string(target.naifId) + " is its own center");
+			double start = INFINITY;
+			double end = -INFINITY;
+			for (int s : targets[idx].segments)
+			{
+				start = std::min(start, segments[s].start);
+				end = std::max(end, segments[s].end);
+			}
+			target.start = std::max(target.start, start);
+			target.end = std::min(target.end, end);
+			target.root = segments[targets[idx].segments[0]].center;
+			idx = segments[targets[idx].segments[0]].centerTarget;
+		}
+	}
+}
+
+int SpkEphemeris::findTarget(int naifId)
+{
+	auto it = std::lower_bound(targets.begin(), targets.end(), naifId,
+		[](const Target& t, int id) { return t.naifId < id; });
+	return it != targets.end() && it->naifId == naifId ? (int)(it - targets.begin()) : -1;
+}
+
+int SpkEphemeris::getSegmentCount() { return (int)segments.size(); }
+bool SpkEphemeris::hasTarget(int naifId) { return findTarget(naifId) != -1; }
+
+bool SpkEphemeris::connect(int target, int center, int& targetIdx, int& centerIdx, double& start, double& end)
+{
+	targetIdx = findTarget(target);
+	centerIdx = findTarget(center);
+	if (targetIdx == -1) return false;
+	start = targets[targetIdx].start;
+	end = targets[targetIdx].end;
+	if (centerIdx == -1)
+	{
+		// the center has no segment, it has to be the root
+		if (targets[targetIdx].root != center) return false;
+	}
+	else
+	{
+		if (targets[targetIdx].root != targets[centerIdx].root) return false;
+		start = std::max(start, targets[centerIdx].start);
+		end = std::min(end, targets[centerIdx].end);
+	}
+	return start <= end;
+}
+
+bool SpkEphemeris::getCoverage(int target, int center, double& start, double& end)
+{
+	int targetIdx, centerIdx;
+	return connect(target, center, targetIdx, centerIdx, start, end);
+}
+
+glm::dvec3 SpkEphemeris::getPosition(int target, int center, double seconds)
+{
+	int targetIdx, centerIdx;
+	double start, end;
+	if (!connect(target, center, targetIdx, centerIdx, start, end))
+	{
+		throw std::runtime_error("no ephemeris of body " + std::to_string(target) + " relative to " + std::to_string(center));
+	}
+	seconds = std::min(std::max(seconds, start), end);
+	stamp++;
+	glm::dvec3 position = targetPosition(targetIdx, seconds);
+	if (centerIdx != -1) position -= targetPosition(centerIdx, seconds);
+	return position;
+}
+
+int SpkEphemeris::addBody(int target, int center, int orbitIdx, const glm::dmat3& transform)
+{
+	int targetIdx, centerIdx;
+	double start, end;
+	if (!connect(target, center, targetIdx, centerIdx, start, end)) return -1;
+	coverageStart = bodies.empty() ? start : std::max(coverageStart, start);
+	coverageEnd = bodies.empty() ? end : std::min(coverageEnd, end);
+
+	Body body;
+	body.target = targetIdx;
+	body.center = centerIdx;
+	body.orbitIdx = orbitIdx;
+	body.transform = transform;
+	bodies.push_back(body);
+	positions.push_back(glm::vec3(0.f));
+	orbitIndices.push_back(orbitIdx);
+	return (int)bodies.size() - 1;
+}
+
+void SpkEphemeris::clearBodies()
+{
+	bodies.clear();
+	positions.clear();
+	orbitIndices.clear();
+}
+
+int SpkEphemeris::getBodyCount() { return (int)bodies.size(); }
+
+void SpkEphemeris::setStartTime(double seconds)
+{
+	startTime = seconds;
+	epochSeconds = 0.0;
+}
+
+void SpkEphemeris::setTimeScale(double ephemerisSecondsPerSecond)
+{
+	startTime += (evaluatedSeconds - epochSeconds) * timeScale;
+	epochSeconds = evaluatedSeconds;
+	timeScale = ephemerisSecondsPerSecond;
+}
+
+void SpkEphemeris::evaluate(double simulationSeconds)
+{
+	evaluatedSeconds = simulationSeconds;
+	double seconds = startTime + (simulationSeconds - epochSeconds) * timeScale;
+	seconds = std::min(std::max(seconds, coverageStart), coverageEnd);
+
+	// bodies sharing targets (planets around the sun, the sun and barycenters on every chain)
+	// evaluate them once
+	stamp++;
+	for (int i = 0; i < bodies.size(); i++)
+	{
+		const Body& body = bodies[i];
+		glm::dvec3 position = targetPosition(body.target, seconds);
+		if (body.center != -1) position -= targetPosition(body.center, seconds);
+		positions[i] = glm::vec3(body.transform * position);
+	}
+}
+
+const glm::vec3* SpkEphemeris::getPositions() { return positions.data(); }
+const int* SpkEphemeris::getOrbitIndices() { return orbitIndices.data(); }
+
+const glm::dvec3& SpkEphemeris::targetPosition(int idx, double seconds)
+{
+	Target& target = targets[idx];
+	if (target.stamp == stamp) return target.position;
+
+	// last segment if it still covers the time, otherwise the first one that does (or the first one)
+	const Segment* segment = &segments[target.segment];
+	if (!(seconds >= segment->start && seconds <= segment->end))
+	{
+		target.segment = target.segments[0];
+		for (int s : target.segments)
+		{
+			if (seconds >= segments[s].start && seconds <= segments[s].end)
+			{
+				target.segment = s;
+				break;
+			}
+		}
+		segment = &segments[target.segment];
+	}
+
+	glm::dvec3 position = segmentPosition(*segment, seconds);
+	if (segment->centerTarget != -1) position += targetPosition(segment->centerTarget, seconds);
+	target.position = position;
+	target.stamp = stamp;
+	return target.position;
+}
+
+glm::dvec3 SpkEphemeris::segmentPosition(const Segment& segment, double seconds)
+{
+	// record by index, its coefficients are x, y, z chebyshev series over [mid - radius, mid + radius]
+	seconds = std::min(std::max(seconds, segment.start), segment.end);
+	int record = (int)floor((seconds - segment.initialTime) / segment.intervalLength);
+	record = std::min(std::max(record, 0), segment.recordCount - 1);
+	size_t word = segment.firstWord + (size_t)record * segment.recordSize;
+	double mid = readDouble(word);
+	double radius = readDouble(word + 1);
+	double x = radius > 0.0 ? std::min(std::max((seconds - mid) / radius, -1.0), 1.0) : 0.0;
+
+	// clenshaw recurrence, all three coordinates together
+	int n = segment.coefficientCount;
+	size_t cx = word + 2;
+	size_t cy = cx + n;
+	size_t cz = cy + n;
+	glm::dvec3 b1(0.0);
+	glm::dvec3 b2(0.0);
+	for (int k = n - 1; k >= 1; k--)
+	{
+		glm::dvec3 b = 2.0 * x * b1 - b2 + glm::dvec3(readDouble(cx + k), readDouble(cy + k), readDouble(cz + k));
+		b2 = b1;
+		b1 = b;
+	}
+	glm::dvec3 position = x * b1 - b2 + glm::dvec3(readDouble(cx), readDouble(cy), readDouble(cz));
+
+	if (segment.equatorial)
+	{
+		position = glm::dvec3(position.x, OBLIQUITY_COS * position.y + OBLIQUITY_SIN * position.z,
+			OBLIQUITY_COS * position.z - OBLIQUITY_SIN * position.y);
+	}
+	return position;
+}
+
+double SpkEphemeris::readDouble(size_t word)
+{
+	uint64_t bits;
+	memcpy(&bits, data + word * 8, 8);
+	if (swapBytes)
+	{
+		bits = ((bits & 0x00000000000000ffull) << 56) | ((bits & 0x000000000000ff00ull) << 40)
+			| ((bits & 0x0000000000ff0000ull) << 24) | ((bits & 0x00000000ff000000ull) << 8)
+			| ((bits & 0x000000ff00000000ull) >> 8) | ((bits & 0x0000ff0000000000ull) >> 24)
+			| ((bits & 0x00ff000000000000ull) >> 40) | ((bits & 0xff00000000000000ull) >> 56);
+	}
+	double value;
+	memcpy(&value, &bits, 8);
+	return value;
+}
+
+int32_t SpkEphemeris::readInt(size_t offset)
+{
+	uint32_t bits;
+	memcpy(&bits, data + offset, 4);
+	if (swapBytes)
+	{
+		bits = ((bits & 0x000000ffu) << 24) | ((bits & 0x0000ff00u) << 8) | ((bits & 0x00ff0000u) >> 8) | ((bits & 0xff000000u) >> 24);
+	}
+	return (int32_t)bits;
+}
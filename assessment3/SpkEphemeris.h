@@ -0,0 +1,137 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+// positions from a jpl spk ephemeris kernel (DAF/SPK binary file, e.g. de440.bsp)
+// the kernel is memory mapped and used in place, loading only reads the segment summaries and a
+// position only reads the chebyshev record of its time (records have a fixed length, so it is
+// found by index), so the os only pages in the records that are actually evaluated
+// segments of type 2 (chebyshev position) and 3 (chebyshev position and velocity) in the J2000 or
+// ECLIPJ2000 frame are used, others are skipped, positions are km in the ecliptic J2000 frame and
+// times are seconds past J2000 (TDB)
+// as a position source for the orbit system every added body is evaluated together at simulation
+// time, each target on their chains to the common center is evaluated once per time and keeps its
+// segment so the next time doesn't search
+class SpkEphemeris
+{
+public:
+
+	SpkEphemeris() {}
+	SpkEphemeris(const SpkEphemeris&) = delete;
+	SpkEphemeris& operator=(const SpkEphemeris&) = delete;
+
+	// map a kernel, throws std::runtime_error if it is missing or invalid
+	void load(const std::string& path);
+
+	// use a kernel in memory (8 byte aligned), data has to stay alive while it is used
+	void load(const void* data, size_t size);
+
+	int getSegmentCount();
+	bool hasTarget(int naifId);
+
+	// time range in which target can be evaluated relative to center, false if the kernel doesn't
+	// connect them
+	bool getCoverage(int target, int center, double& start, double& end);
+
+	// position of target relative to center, times outside the coverage are clamped to it
+	glm::dvec3 getPosition(int target, int center, double seconds);
+
+	// position source: orbit system body orbitIdx is moved to transform * position of target
+	// relative to center (e.g. scale and rotation into the parent's orbit frame)
+	// returns -1 if the kernel doesn't connect target and center
+	int addBody(int target, int center, int orbitIdx, const glm::dmat3& transform);
+	void clearBodies();
+	int getBodyCount();
+
+	// ephemeris time = start + simulation seconds * scale, a new scale is rebased to the last
+	// evaluated time so bodies don't jump
+	void setStartTime(double seconds);
+	void setTimeScale(double ephemerisSecondsPerSecond);
+
+	// evaluate every added body at simulation time in seconds (clamped to their common coverage)
+	void evaluate(double simulationSeconds);
+
+	// results of the last evaluate, by body index
+	const glm::vec3* getPositions();
+	const int* getOrbitIndices();
+
+private:
+
+	struct Segment
+	{
+		int target;
+		int center;
+		int centerTarget;			// index of the center's target, -1 if it has no segment (chain root)
+		bool equatorial;			// J2000 frame, turned into the ecliptic
+		double start;				// coverage
+		double end;
+		double initialTime;			// start of the first record
+		double intervalLength;		// seconds per record
+		size_t firstWord;			// double index of the first record
+		int recordSize;				// doubles per record
+		int recordCount;
+		int coefficientCount;		// per coordinate
+	};
+
+	// body with segments, in priority order (later segments in the file first), all relative to the
+	// center of the first one
+	struct Target
+	{
+		int naifId;
+		std::vector<int> segments;
+		int root;					// naif id at the end of its chain of centers
+		double start;				// coverage of the segments along its chain
+		double end;
+
+		// last evaluation
+		int segment;				// used for the last time, checked first
+		long long stamp;
+		glm::dvec3 position;		// relative to root
+	};
+
+	struct Body
+	{
+		int target;					// target indices
+		int center;					// -1 = the root
+		int orbitIdx;
+		glm::dmat3 transform;
+	};
+
+	MappedFile file;
+	const char* data = NULL;
+	size_t size = 0;
+	bool swapBytes = false;			// kernel written with the other byte order
+
+	std::vector<Segment> segments;
+	std::vector<Target> targets;	// sorted by naif id
+	long long stamp = 0;
+
+	std::vector<Body> bodies;
+	std::vector<glm::vec3> positions;
+	std::vector<int> orbitIndices;
+	double coverageStart = 0.0;		// common coverage of all bodies
+	double coverageEnd = 0.0;
+	double startTime = 0.0;
+	double timeScale = 1.0;
+	double epochSeconds = 0.0;		// simulation seconds at startTime
+	double evaluatedSeconds = 0.0;
+
+	void readSummaries(int firstRecord);
+	void resolveChains();
+	int findTarget(int naifId);
+
+	// target indices and common coverage of target and center, false if their chains don't meet
+	bool connect(int target, int center, int& targetIdx, int& centerIdx, double& start, double& end);
+
+	// position of a target relative to its chain root, evaluated once per stamp
+	const glm::dvec3& targetPosition(int idx, double seconds);
+	glm::dvec3 segmentPosition(const Segment& segment, double seconds);
+
+	double readDouble(size_t word);		// by double index
+	int32_t readInt(size_t offset);		// by byte offset
+};
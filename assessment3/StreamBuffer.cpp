@@ -0,0 +1,124 @@
+#include "StreamBuffer.h"
+#include <algorithm>
+
+// keeps region starts aligned for any uniform, storage or vertex offset requirement
+static size_t alignUp(size_t value, size_t alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+void StreamBuffer::init(size_t frameSize, bool persistent)
+{
+	this->persistent = persistent;
+	regionSize = alignUp(frameSize, 256);
+	createBuffer();
+}
+
+void StreamBuffer::createBuffer()
+{
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	if (persistent)
+	{
+		GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_COPY_WRITE_BUFFER, regionSize * REGION_COUNT, NULL, flags);
+		mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, regionSize * REGION_COUNT, flags);
+	}
+	else
+	{
+		glBufferData(GL_COPY_WRITE_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+		staging.resize(regionSize);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::beginFrame()
+{
+	cursor = 0;
+	if (!persistent) return;
+
+	region = (region + 1) % REGION_COUNT;
+	if (fences[region] != NULL)
+	{
+		// normally already signaled, only blocks when the cpu is REGION_COUNT frames ahead
+		while (glClientWaitSync(fences[region], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fences[region]);
+		fences[region] = NULL;
+	}
+}
+
+StreamAllocation StreamBuffer::allocate(size_t size, size_t alignment)
+{
+	size_t offset = alignUp(cursor, alignment);
+	if (offset + size > regionSize)
+	{
+		if (persistent)
+		{
+			grow(size + alignment);
+			offset = 0;
+		}
+		else
+		{
+			// staging only, the gl buffer is resized on the next flush
+			regionSize = alignUp(std::max(regionSize * 2, offset + size), 256);
+			staging.resize(regionSize);
+		}
+	}
+	cursor = offset + size;
+
+	StreamAllocation allocation;
+	allocation.buffer = buffer;
+	allocation.size = size;
+	if (persistent)
+	{
+		allocation.offset = region * regionSize + offset;
+		allocation.data = mapped + allocation.offset;
+	}
+	else
+	{
+		allocation.offset = offset;
+		allocation.data = staging.data() + offset;
+	}
+	return allocation;
+}
+
+void StreamBuffer::grow(size_t required)
+{
+	// frames in flight and this frame's earlier allocations still read the old buffer
+	retired.push_back(RetiredBuffer{ buffer, REGION_COUNT + 1 });
+	regionSize = alignUp(std::max(regionSize * 2, required), 256);
+	createBuffer();
+	cursor = 0;
+}
+
+void StreamBuffer::flush()
+{
+	// coherent mapping, writes are already visible
+	if (persistent || cursor == 0) return;
+
+	// orphan so the driver hands out fresh storage instead of waiting on previous frame
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+	glBufferData(GL_COPY_WRITE_BUFFER, regionSize, NULL, GL_STREAM_DRAW);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, 0, cursor, staging.data());
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void StreamBuffer::endFrame()
+{
+	if (persistent)
+	{
+		fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	for (int i = (int)retired.size() - 1; i >= 0; i--)
+	{
+		if (--retired[i].framesLeft > 0) continue;
+		glDeleteBuffers(1, &retired[i].buffer);		// also unmaps
+		retired.erase(retired.begin() + i);
+	}
+}
+
+bool StreamBuffer::isPersistent()
+{
+	return persistent;
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <stddef.h>
+#include <vector>
+#include "GLExtensions.h"
+
+// one sub allocation of a frame, data must be written before the next allocate()
+struct StreamAllocation
+{
+	void* data;				// cpu write pointer
+	unsigned int buffer;	// buffer object to bind
+	size_t offset;			// byte offset of the allocation in buffer
+	size_t size;
+};
+
+// ring buffer for per frame dynamic data (uniforms, instances, transforms)
+// persistent path: one persistently mapped coherent buffer split into REGION_COUNT frame
+//   regions, data is written straight into gpu visible memory and every region is guarded
+//   by a fence so it is only reused once the gpu finished the frame that read it
+// fallback path (no buffer storage): data is staged on the cpu and uploaded with one
+//   orphaning glBufferData + glBufferSubData in flush()
+class StreamBuffer
+{
+public:
+
+	static const int REGION_COUNT = 3;
+
+	// frameSize is the initial size of one frame region, grows when exceeded
+	void init(size_t frameSize, bool persistent);
+
+	// start writing a new frame, waits if the gpu still reads the next region
+	void beginFrame();
+
+	// reserve size bytes aligned to alignment (power of 2) in the current frame
+	StreamAllocation allocate(size_t size, size_t alignment = 16);
+
+	// make this frame's data visible to the gpu, call after the last allocate() and before drawing
+	void flush();
+
+	// fence the current region, call after the last draw reading this frame's data
+	void endFrame();
+
+	bool isPersistent();
+
+private:
+
+	struct RetiredBuffer
+	{
+		unsigned int buffer;
+		int framesLeft;
+	};
+
+	bool persistent = false;
+	unsigned int buffer = 0;
+	unsigned char* mapped = NULL;
+	size_t regionSize = 0;
+	int region = 0;
+	size_t cursor = 0;						// bytes used in current region
+	GLsync fences[REGION_COUNT] = {};
+	std::vector<unsigned char> staging;		// fallback path frame data
+	std::vector<RetiredBuffer> retired;		// outgrown buffers still read by frames in flight
+
+	void createBuffer();
+
+	// replace the persistent buffer by a larger one, frame data written so far stays in the old buffer
+	void grow(size_t required);
+};
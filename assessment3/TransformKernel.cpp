@@ -0,0 +1,112 @@
+#define _USE_MATH_DEFINES
+#include "TransformKernel.h"
+#include "SimdMath.h"
+#include <glm/glm/gtc/matrix_transform.hpp>
+#include <cmath>
+
+// compose up to 4 bodies starting at first, missing lanes repeat the first body and are not stored
+static void composeGroup(const TransformBatch& b, int first, int n)
+{
+	float parentsRotation[4], ascendingNode[4], tilt[4], spin[4], scale[4];
+	float px[4], py[4], pz[4], qx[4], qy[4], qz[4];
+	for (int k = 0; k < 4; k++)
+	{
+		int i = first + (k < n ? k : 0);
+		parentsRotation[k] = b.parentsRotation[i];
+		ascendingNode[k] = b.ascendingNode[i];
+		tilt[k] = b.tilt[i];
+		spin[k] = b.spin[i];
+		scale[k] = b.scale[i];
+		px[k] = b.parentOffset[i].x;
+		py[k] = b.parentOffset[i].y;
+		pz[k] = b.parentOffset[i].z;
+		qx[k] = b.position[i].x;
+		qy[k] = b.position[i].y;
+		qz[k] = b.position[i].z;
+	}
+
+	const __m128 toRadian = _mm_set1_ps((float)(M_PI / 180.0));
+	__m128 sa, ca, sb, cb, st, ct, ss, cs;
+	SimdMath::sincos4(_mm_mul_ps(_mm_loadu_ps(parentsRotation), toRadian), sa, ca);
+	SimdMath::sincos4(_mm_mul_ps(_mm_loadu_ps(ascendingNode), toRadian), sb, cb);
+	SimdMath::sincos4(_mm_mul_ps(_mm_loadu_ps(tilt), toRadian), st, ct);
+	SimdMath::sincos4(_mm_mul_ps(_mm_loadu_ps(spin), toRadian), ss, cs);
+	__m128 k = _mm_loadu_ps(scale);
+
+	// Ry(parentsRotation) * Ry(ascendingNode) = Ry(sum)
+	__m128 cc = _mm_sub_ps(_mm_mul_ps(ca, cb), _mm_mul_ps(sa, sb));
+	__m128 sc = _mm_add_ps(_mm_mul_ps(sa, cb), _mm_mul_ps(ca, sb));
+
+	// rotation and scale, Ry(sum) * Rz(tilt) * Ry(spin) * scale, one register per matrix element
+	__m128 ctcs = _mm_mul_ps(ct, cs);
+	__m128 ctss = _mm_mul_ps(ct, ss);
+	__m128 c0x = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cc, ctcs), _mm_mul_ps(sc, ss)), k);
+	__m128 c0y = _mm_mul_ps(_mm_mul_ps(st, cs), k);
+	__m128 c0z = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(_mm_mul_ps(sc, ctcs), _mm_mul_ps(cc, ss))), k);
+	__m128 c1x = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(cc, st)), k);
+	__m128 c1y = _mm_mul_ps(ct, k);
+	__m128 c1z = _mm_mul_ps(_mm_mul_ps(sc, st), k);
+	__m128 c2x = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cc, ctss), _mm_mul_ps(sc, cs)), k);
+	__m128 c2y = _mm_mul_ps(_mm_mul_ps(st, ss), k);
+	__m128 c2z = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cc, cs), _mm_mul_ps(sc, ctss)), k);
+
+	// translation, Ry(parentsRotation) * (parentOffset + Ry(ascendingNode) * position)
+	__m128 vqx = _mm_loadu_ps(qx);
+	__m128 vqz = _mm_loadu_ps(qz);
+	__m128 rx = _mm_add_ps(_mm_loadu_ps(px), _mm_add_ps(_mm_mul_ps(cb, vqx), _mm_mul_ps(sb, vqz)));
+	__m128 ry = _mm_add_ps(_mm_loadu_ps(py), _mm_loadu_ps(qy));
+	__m128 rz = _mm_add_ps(_mm_loadu_ps(pz), _mm_sub_ps(_mm_mul_ps(cb, vqz), _mm_mul_ps(sb, vqx)));
+	__m128 c3x = _mm_add_ps(_mm_mul_ps(ca, rx), _mm_mul_ps(sa, rz));
+	__m128 c3y = ry;
+	__m128 c3z = _mm_sub_ps(_mm_mul_ps(ca, rz), _mm_mul_ps(sa, rx));
+
+	// element registers to one column register per body
+	__m128 zero = _mm_setzero_ps();
+	__m128 one = _mm_set1_ps(1.f);
+	_MM_TRANSPOSE4_PS(c0x, c0y, c0z, zero);
+	__m128 zero1 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c1x, c1y, c1z, zero1);
+	__m128 zero2 = _mm_setzero_ps();
+	_MM_TRANSPOSE4_PS(c2x, c2y, c2z, zero2);
+	_MM_TRANSPOSE4_PS(c3x, c3y, c3z, one);
+	__m128 column0[4] = { c0x, c0y, c0z, zero };
+	__m128 column1[4] = { c1x, c1y, c1z, zero1 };
+	__m128 column2[4] = { c2x, c2y, c2z, zero2 };
+	__m128 column3[4] = { c3x, c3y, c3z, one };
+
+	for (int j = 0; j < n; j++)
+	{
+		int idx = b.indices != NULL ? b.indices[first + j] : first + j;
+		float* m = &b.world[idx][0][0];
+		_mm_storeu_ps(m + 0, column0[j]);
+		_mm_storeu_ps(m + 4, column1[j]);
+		_mm_storeu_ps(m + 8, column2[j]);
+		_mm_storeu_ps(m + 12, column3[j]);
+		if (b.worldPosition != NULL) b.worldPosition[idx] = glm::vec3(b.world[idx][3]);
+	}
+}
+
+void composeTransforms(const TransformBatch& batch)
+{
+	for (int i = 0; i < batch.count; i += 4)
+	{
+		int n = batch.count - i < 4 ? batch.count - i : 4;
+		composeGroup(batch, i, n);
+	}
+}
+
+glm::mat4 composeTransform(float parentsRotation, const glm::vec3& parentOffset, float ascendingNode,
+	const glm::vec3& position, float tilt, float spin, float scale)
+{
+	const glm::vec3 Yaxis = glm::vec3(0.f, 1.f, 0.f);
+	const glm::vec3 Zaxis = glm::vec3(0.f, 0.f, 1.f);
+
+	glm::mat4 model = glm::rotate(glm::mat4(1.f), glm::radians(parentsRotation), Yaxis);
+	model = glm::translate(model, parentOffset);
+	model = glm::rotate(model, glm::radians(ascendingNode), Yaxis);
+	model = glm::translate(model, position);
+	model = glm::rotate(model, glm::radians(tilt), Zaxis);
+	model = glm::rotate(model, glm::radians(spin), Yaxis);
+	model = glm::scale(model, glm::vec3(scale));
+	return model;
+}
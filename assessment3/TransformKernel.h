@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glm/glm/glm.hpp>
+
+// inputs and outputs of composeTransforms, angles in degrees, per body arrays of length count
+// the composed matrix is
+//   Ry(parentsRotation) * T(parentOffset) * Ry(ascendingNode) * T(position) * Rz(tilt) * Ry(spin) * S(scale)
+struct TransformBatch
+{
+	int count = 0;
+
+	const float* parentsRotation = NULL;
+	const float* ascendingNode = NULL;
+	const float* tilt = NULL;
+	const float* spin = NULL;
+	const float* scale = NULL;
+	const glm::vec3* parentOffset = NULL;
+	const glm::vec3* position = NULL;
+
+	// body i is written to world[indices[i]] (or world[i] without indices)
+	const int* indices = NULL;
+	glm::mat4* world = NULL;
+	glm::vec3* worldPosition = NULL;	// optional, translation of the world matrix
+};
+
+// builds the matrices in closed form 4 bodies at a time (sse), the two y rotations around the
+// parent merge into one so every body costs 4 sincos and no matrix multiplication
+void composeTransforms(const TransformBatch& batch);
+
+// reference version, chained glm calls
+glm::mat4 composeTransform(float parentsRotation, const glm::vec3& parentOffset, float ascendingNode,
+	const glm::vec3& position, float tilt, float spin, float scale);
@@ -0,0 +1,210 @@
+#define _USE_MATH_DEFINES
+#include "UpdateScheduler.h"
+#include "OrbitSystem.h"
+#include <algorithm>
+#include <cmath>
+
+const int UpdateScheduler::MAX_TIER;
+const int UpdateScheduler::RETIER_PER_TICK;
+const int UpdateScheduler::MAX_VISIBLE_SLOWDOWN;
+const int UpdateScheduler::MIN_BODIES;
+const int UpdateScheduler::WHEEL_SIZE;
+const int UpdateScheduler::HIDDEN_SLOWDOWN_LEAD;
+
+void UpdateScheduler::resize(int count)
+{
+	this->count = count;
+	pixelsPerUnit.reset(new std::atomic<float>[count]);
+	for (int i = 0; i < count; i++) pixelsPerUnit[i].store(0.f, std::memory_order_relaxed);
+	radius.assign(count, 0.f);
+	tiers.assign(count, 0);
+	onScreen.assign(count, 0);
+	tiered = false;
+	for (int k = 0; k <= MAX_TIER; k++)
+	{
+		tierCounts[0][k] = 0;
+		tierCounts[1][k] = 0;
+		nextPhase[k] = 0;
+	}
+	tierCounts[0][0] = count;
+	slowdown[0] = 0;
+	slowdown[1] = 0;
+	cursor = 0;
+	due.clear();
+	due.reserve(count);
+	wheel.assign(WHEEL_SIZE, std::vector<int>());
+	wheelSlot.assign(count, 0);
+	wheelPos.assign(count, -1);
+	dueNow.clear();
+	retieredBodies.clear();
+	retieredBodies.reserve(count);
+}
+
+int UpdateScheduler::getCount() { return count; }
+void UpdateScheduler::setBodyRadius(int idx, float radius) { this->radius[idx] = radius; }
+void UpdateScheduler::setTickSeconds(double seconds) { tickSeconds = seconds; }
+void UpdateScheduler::setBudget(int evaluationsPerTick) { budget = evaluationsPerTick; }
+int UpdateScheduler::getTier(int idx) { return tiers[idx]; }
+int UpdateScheduler::getTierCount(int tier) { return tierCounts[0][tier] + tierCounts[1][tier]; }
+int UpdateScheduler::getSlowdown() { return slowdown[0]; }
+int UpdateScheduler::getVisibleSlowdown() { return slowdown[1]; }
+
+void UpdateScheduler::setMaxError(float pixels, float orbitFraction)
+{
+	maxErrorPixels = pixels;
+	maxErrorFraction = orbitFraction;
+}
+
+void UpdateScheduler::setView(int idx, float pixelsPerUnit)
+{
+	this->pixelsPerUnit[idx].store(pixelsPerUnit, std::memory_order_relaxed);
+}
+
+float UpdateScheduler::getProjectionScale(float fovDegrees, int viewportHeight)
+{
+	return viewportHeight * 0.5f / tanf(fovDegrees * (float)(M_PI / 360.0));
+}
+
+int UpdateScheduler::chooseTier(OrbitSystem& orbits, int idx)
+{
+	// straight line extrapolation over t seconds drifts by about 0.5 * speed^2 * radius * t^2
+	float speed = orbits.getOrbitSpeed(idx);
+	float orbitRadius = orbits.getOrbitRadius(idx);
+	if (speed <= 0.f || orbitRadius <= 0.f) return MAX_TIER;
+	float drift = 0.5f * speed * speed * orbitRadius;		// world units after 1 second
+
+	float maxDrift = maxErrorFraction * orbitRadius;
+	float scale = pixelsPerUnit[idx].load(std::memory_order_relaxed);
+	if (scale > 0.f)
+	{
+		// a body smaller than a pixel can move further before it shows, up to 8 times
+		float sizePixels = radius[idx] * scale;
+		float allowed = maxErrorPixels * std::min(std::max(1.f / std::max(sizePixels, 1e-6f), 1.f), 8.f);
+		maxDrift = std::min(maxDrift, allowed / scale);
+	}
+
+	double ticks = sqrt(maxDrift / drift) / tickSeconds;
+	if (ticks < 2.0) return 0;
+	return std::min((int)log2(ticks), MAX_TIER);
+}
+
+void UpdateScheduler::updateSlowdown()
+{
+	// fewest extra tiers with sum(bodies in tier / period) within the budget, off screen bodies
+	// are slowed down first, up to HIDDEN_SLOWDOWN_LEAD tiers ahead of the on screen ones so
+	// they don't leave their orbit by more than 4^lead times the orbit error, past
+	// MAX_VISIBLE_SLOWDOWN on screen the budget is exceeded instead
+	slowdown[0] = 0;
+	slowdown[1] = 0;
+	if (budget <= 0) return;
+	auto perTick = [this]()
+	{
+		double evaluations = 0.0;
+		for (int screen = 0; screen < 2; screen++)
+		{
+			for (int k = 0; k <= MAX_TIER; k++)
+			{
+				evaluations += tierCounts[screen][k] / (double)(1 << std::min(k + tierSlowdown(screen, k), MAX_TIER));
+			}
+		}
+		return evaluations;
+	};
+	while (perTick() > budget)
+	{
+		if (slowdown[0] < slowdown[1] + HIDDEN_SLOWDOWN_LEAD) slowdown[0]++;
+		else if (slowdown[1] < MAX_VISIBLE_SLOWDOWN) slowdown[1]++;
+		else break;
+	}
+}
+
+int UpdateScheduler::tierSlowdown(int screen, int tier)
+{
+	// tier 0 includes bodies that drift too far within a single tick, slowed down their error
+	// would grow by more than 4 per tier, so on screen they stay at every tick
+	return screen == 1 && tier == 0 ? 0 : slowdown[screen];
+}
+
+int UpdateScheduler::getPeriod(int idx)
+{
+	return 1 << std::min(tiers[idx] + tierSlowdown(onScreen[idx], tiers[idx]), MAX_TIER);
+}
+
+void UpdateScheduler::insert(int idx, long long dueTick)
+{
+	int slot = (int)(dueTick & (WHEEL_SIZE - 1));
+	wheelSlot[idx] = (unsigned short)slot;
+	wheelPos[idx] = (int)wheel[slot].size();
+	wheel[slot].push_back(idx);
+}
+
+void UpdateScheduler::remove(int idx)
+{
+	// last body of the slot takes the place of the removed one
+	std::vector<int>& slot = wheel[wheelSlot[idx]];
+	int moved = slot.back();
+	slot[wheelPos[idx]] = moved;
+	wheelPos[moved] = wheelPos[idx];
+	slot.pop_back();
+	wheelPos[idx] = -1;
+}
+
+const std::vector<int>& UpdateScheduler::schedule(OrbitSystem& orbits, long long tick)
+{
+	due.clear();
+	retieredBodies.clear();
+
+	// every body on the first tick, a fixed number per tick after that
+	if (!tiered)
+	{
+		for (int k = 0; k <= MAX_TIER; k++) tierCounts[0][k] = 0;
+		for (int idx = 0; idx < count; idx++)
+		{
+			tiers[idx] = (unsigned char)chooseTier(orbits, idx);
+			onScreen[idx] = pixelsPerUnit[idx].load(std::memory_order_relaxed) > 0.f;
+			tierCounts[onScreen[idx]][tiers[idx]]++;
+			retieredBodies.push_back(idx);
+		}
+		updateSlowdown();
+		tiered = true;
+	}
+	else
+	{
+		for (int n = 0; n < std::min(count, RETIER_PER_TICK); n++)
+		{
+			int idx = cursor;
+			cursor = cursor + 1 < count ? cursor + 1 : 0;
+			int tier = chooseTier(orbits, idx);
+			unsigned char screen = pixelsPerUnit[idx].load(std::memory_order_relaxed) > 0.f;
+			if (tier == tiers[idx] && screen == onScreen[idx]) continue;
+
+			tierCounts[onScreen[idx]][tiers[idx]]--;
+			tierCounts[screen][tier]++;
+			tiers[idx] = (unsigned char)tier;
+			onScreen[idx] = screen;
+			remove(idx);
+			retieredBodies.push_back(idx);
+		}
+		updateSlowdown();
+	}
+
+	// bodies due on this tick go back into the wheel one period later
+	dueNow.swap(wheel[tick & (WHEEL_SIZE - 1)]);
+	for (int n = 0; n < dueNow.size(); n++)
+	{
+		int idx = dueNow[n];
+		due.push_back(idx);
+		insert(idx, tick + getPeriod(idx));
+	}
+	dueNow.clear();
+
+	// new and retiered bodies are evaluated now as well, so they are never extrapolated for longer
+	// than their new period, consecutive phases spread a tier evenly over its period
+	for (int n = 0; n < retieredBodies.size(); n++)
+	{
+		int idx = retieredBodies[n];
+		int period = getPeriod(idx);
+		due.push_back(idx);
+		insert(idx, tick + 1 + (nextPhase[tiers[idx]]++ & (period - 1)));
+	}
+	return due;
+}
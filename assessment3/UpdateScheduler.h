@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+class OrbitSystem;
+
+// picks which orbit system bodies get a closed form evaluation on a tick, the others are
+// extrapolated (OrbitSystem::evaluateScheduled)
+// every body sits in a tier, tier k is evaluated every 2^k ticks with bodies of a tier spread
+// over the ticks; the tier is the slowest one whose extrapolation error stays below a fraction of
+// the orbit radius and, while the body is on screen, below a number of pixels (allowed to grow
+// for bodies smaller than a pixel), so it follows angular speed, distance and screen size
+// the tier of a body is recomputed every few ticks, a fixed number of bodies per tick, and if
+// the tiers need more evaluations per tick than the budget the tiers are slowed down, off screen
+// bodies first, on screen ones only when that is not enough and by MAX_VISIBLE_SLOWDOWN tiers at
+// most, so the closed form work per tick stays around budget + RETIER_PER_TICK unless the on
+// screen bodies alone need more, then the pixel error wins over the budget
+// bodies wait in a wheel of due lists by the tick they are due on, so scheduling a tick only
+// touches the retiered and the due bodies
+// only the closed form work is bounded, every body is still extrapolated on every tick (one pass
+// over all of them), culling, picking and physics read every position so none is left stale
+class UpdateScheduler
+{
+public:
+
+	static const int MAX_TIER = 15;				// every 32768 ticks
+	static const int RETIER_PER_TICK = 4096;
+	static const int MAX_VISIBLE_SLOWDOWN = 1;		// on screen pixel error up to 4^n times the set one (tier 0 is never slowed down)
+
+	// below this many bodies evaluating every body is as fast as scheduling (--benchmark), the
+	// application only sets up a scheduler above it
+	static const int MIN_BODIES = 250000;
+
+	// number of bodies (orbit system bodies), tiered on the first schedule
+	void resize(int count);
+	int getCount();
+
+	void setBodyRadius(int idx, float radius);		// bounding radius in world units
+	void setTickSeconds(double seconds);
+	void setBudget(int evaluationsPerTick);		// 0 = no limit
+	void setMaxError(float pixels, float orbitFraction);
+
+	// how big the body appears, pixels per world unit at its distance from the camera (0 when it
+	// is not visible), may be called from any thread at any time
+	void setView(int idx, float pixelsPerUnit);
+	static float getProjectionScale(float fovDegrees, int viewportHeight);		// pixels per unit at distance 1
+
+	// on the thread that evaluates the orbit system, once per tick with consecutive ticks: retiers
+	// the next bodies and returns the bodies due for a closed form evaluation on this tick
+	const std::vector<int>& schedule(OrbitSystem& orbits, long long tick);
+
+	int getTier(int idx);
+	int getTierCount(int tier);
+	int getSlowdown();			// tiers added to off screen bodies to meet the budget
+	int getVisibleSlowdown();	// tiers added to on screen bodies, up to MAX_VISIBLE_SLOWDOWN
+
+private:
+
+	static const int WHEEL_SIZE = 1 << MAX_TIER;	// longest period
+	static const int HIDDEN_SLOWDOWN_LEAD = 2;		// extra tiers off screen bodies are slowed down first
+
+	int count = 0;
+	double tickSeconds = 1.0 / 120.0;
+	int budget = 0;
+	float maxErrorPixels = 0.5f;
+	float maxErrorFraction = 0.002f;
+
+	std::unique_ptr<std::atomic<float>[]> pixelsPerUnit;	// written by the render thread
+	std::vector<float> radius;
+	std::vector<unsigned char> tiers;
+	std::vector<unsigned char> onScreen;	// when the tier was chosen
+	bool tiered = false;					// every body got its tier once
+	int tierCounts[2][MAX_TIER + 1];		// off screen, on screen
+	unsigned short nextPhase[MAX_TIER + 1];	// spreads retiered bodies over their period
+	int slowdown[2] = { 0, 0 };
+	int cursor = 0;
+	std::vector<int> due;
+
+	// due lists by tick modulo WHEEL_SIZE, every body is in exactly one
+	std::vector<std::vector<int>> wheel;
+	std::vector<unsigned short> wheelSlot;	// slot and position of every body
+	std::vector<int> wheelPos;
+	std::vector<int> dueNow;				// slot of this tick, swapped out of the wheel
+	std::vector<int> retieredBodies;		// tier changed on this tick, not in the wheel
+
+	int chooseTier(OrbitSystem& orbits, int idx);
+	void updateSlowdown();
+	int tierSlowdown(int screen, int tier);
+	int getPeriod(int idx);
+	void insert(int idx, long long dueTick);
+	void remove(int idx);
+};
@@ -7,16 +7,40 @@
 #include <iostream>
 #include <vector>
 #include <map>
+#include <algorithm>
+#include <atomic>
 #include <stdlib.h>
+#include <string.h>
 #include "stb_image.h"
 #include "shader.h"
 #include "window.h"
 #include "modelReader.h"
 #include "shapes.h"
-#include "OrbitAnimator.h"
+#include "OrbitSystem.h"
 #include "SceneState.h"
 #include "PlanetMath.h"
 #include "GeneralCamera.h"
+#include "FrameUniforms.h"
+#include "RenderQueue.h"
+#include "InstanceBatcher.h"
+#include "FrustumCuller.h"
+#include "IndirectRenderer.h"
+#include "StreamBuffer.h"
+#include "FramePacer.h"
+#include "SimulationThread.h"
+#include "UpdateScheduler.h"
+#include "Benchmark.h"
+#include "SceneGraph.h"
+#include "SphereBvh.h"
+#include "AllocCounter.h"
+#include "BodyStore.h"
+#include "JobSystem.h"
+#include "NBodySystem.h"
+#include "SceneFile.h"
+#include "SceneCompiler.h"
+#include "SceneGenerator.h"
+#include "SceneSetup.h"
+#include "SpkEphemeris.h"
 
 // debug
 //#include <glm/glm/gtx/string_cast.hpp>
@@ -28,11 +52,23 @@ using namespace std;
 // IO function
 void processKeyboard(GLFWwindow* window);
 void processMouse(GLFWwindow* window, double x, double y);
+void processMouseButton(GLFWwindow* window, int button, int action, int mods);
+void processKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods);
+void processWindowRefresh(GLFWwindow* window);
+
+// on demand rendering, safe to call from any thread (e.g. when an asset finished loading)
+void requestRedraw();
 
 // animation keyboard interaction
-void updateAnimatorsDelays();
+void updateAnimatorsDelays(float earthDelay);
 void randomizeOrbitAngles();
 
+// switch model view camera to a body
+void selectBody(int idx);
+
+// refit the body bvh to the last frame's positions before a query
+void updateBodyBvh();
+
 // load function
 unsigned int loadCubemap(vector<string> filename);
 unsigned int loadTexture(const char* filename);
@@ -40,12 +76,6 @@ unsigned int loadTexture(const char* filename);
 // opengl helper
 void glSetupVertexObject(unsigned int& VAO, unsigned int& VBO, vector<float>& data, vector<int> attribLayout);
 void glDrawVertexTriangles(unsigned int VAO, GLuint texture, int numberOfVertex);
-void glSetModelViewProjection(unsigned int shaderProgram, glm::mat4 model, glm::mat4 view, glm::mat4 projection);
-void glSetLightingConfig(unsigned int shaderProgram, glm::vec3 lightPos, GeneralCamera camPos, int torch);
-
-// helper
-glm::vec3 vecToVec3(vector<float> vec);
-vector<float> vec3ToVec(glm::vec3 vec3);
 
 // opengl code dump
 void displayLoadingScreen(GLFWwindow* window);
@@ -58,7 +88,14 @@ void displaySkyBox(unsigned int& VAO, GLuint texture, unsigned int shaderProgram
 int WINDOW_WIDTH = 1280;
 int WINDOW_HEIGHT = 800;
 float targetFPS = 144.f;
-DelayTrigger frameTrigger = DelayTrigger(1.f / targetFPS);
+FramePacer framePacer;
+DelayTrigger vTrigger;
+DelayTrigger nTrigger;
+
+// on demand rendering (scene paused and no input)
+std::atomic<bool> redrawRequested(true);
+int keysHeld = 0;				// keys currently down, held keys keep rendering continuously
+double idleWaitTimeout = 1.0;	// seconds, upper bound of a single idle wait
 
 // camera and camera control
 GeneralCamera camera;
@@ -67,14 +104,41 @@ float prevMouseX;
 float prevMouseY;
 
 // scene 
-int sunIdx = 0;		// THIS MUST BE CHANGED WHENEVER THE CONFIGURATION MATRIX IS CHANGED
-int earthIdx = 4;   // THIS MUST BE CHANGED WHENEVER THE CONFIGURATION MATRIX IS CHANGED
+string scenePath = "resources/scenes/solar_system.scene";	// "--scene file", text or compiled scene
+SceneFile scene;
+int sunIdx = -1;	// light source body of the scene (-1 if none)
+int earthIdx = 0;	// reference body, scale and orbit delays are relative to it
 float earthOrbitDelay = 3600;
 glm::vec3 lightPos = glm::vec3(0.0f, 0.0f, 0.0f);
 PlanetMath m;
 vector<RenderedBody> renderedBodies;
 vector<BodyConst> bodyConstants;
-vector<OrbitAnimator> animators;
+OrbitSystem orbitSystem;				// owned by the simulation thread once started
+SimulationThread simulation;
+double simulationTickRate = 120.0;		// fixed animation ticks per second
+vector<BodyState> bodyStates;			// interpolated simulation state, indexed by animator
+UpdateScheduler updateScheduler;		// how often each animator is evaluated exactly, extrapolated in between
+NBodySystem nbodySystem;				// gravity of physics bodies, stepped by the simulation thread
+float openingAngle = 0.5f;				// "--opening-angle x", barnes hut accuracy (0 = exact pairs, up to 1)
+bool yoshidaIntegrator = false;			// "--yoshida", 4th order steps instead of leapfrog
+double physicsTickRate = 60.0;			// "--physics-rate x", particle steps per second, at most one per tick
+SpkEphemeris spkEphemeris;				// positions of bodies with a naif id, owned by the simulation thread once started
+string ephemerisPath;					// "--ephemeris file.bsp", jpl spk kernel (e.g. de440.bsp)
+int updateBudget = 16384;				// exact orbit evaluations per tick at most
+SceneGraph sceneGraph;					// world transforms of renderedBodies, parent first
+BodyStore bodyStore;					// per frame body components by archetype, indexed like renderedBodies
+JobSystem jobSystem;					// worker threads for animation, transforms, culling and packets
+int jobThreads = 0;						// "--threads n", 0 uses every hardware thread
+FrameUniforms frameUniforms;
+StreamBuffer frameStream;		// per frame uniforms, instances and transforms
+RenderQueue renderQueue;
+InstanceBatcher instanceBatcher;
+FrustumCuller frustumCuller;
+SphereBvh bodyBvh;						// bounding spheres for picking and nearest body queries
+vector<unsigned char> bodySelectable;	// bodies that can be picked for model view
+vector<int> nearestBodies;				// nearest body query results
+IndirectRenderer indirectRenderer;
+bool gpuCulling = false;	// "--gpu-culling", compute culling and multi draw indirect (OpenGL 4.3)
 
 // camera mode 
 DelayTrigger fTrigger;
@@ -110,13 +174,82 @@ int main(int argc, char** argv)
 
 	// ======================= SETUP ======================	
 
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--gpu-culling") == 0) gpuCulling = true;
+		if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) jobThreads = atoi(argv[++i]);
+		if (strcmp(argv[i], "--scene") == 0 && i + 1 < argc) scenePath = argv[++i];
+		if (strcmp(argv[i], "--opening-angle") == 0 && i + 1 < argc) openingAngle = (float)atof(argv[++i]);
+		if (strcmp(argv[i], "--yoshida") == 0) yoshidaIntegrator = true;
+		if (strcmp(argv[i], "--physics-rate") == 0 && i + 1 < argc) physicsTickRate = atof(argv[++i]);
+		if (strcmp(argv[i], "--ephemeris") == 0 && i + 1 < argc) ephemerisPath = argv[++i];
+		if (strcmp(argv[i], "--compile-scene") == 0 && i + 2 < argc)
+		{
+			try
+			{
+				SceneCompiler().compileFile(argv[i + 1], argv[i + 2]);
+			}
+			catch (const std::exception& e)
+			{
+				cerr << e.what() << endl;
+				return 1;
+			}
+			cout << "Compiled " << argv[i + 1] << " to " << argv[i + 2] << endl;
+			return 0;
+		}
+		if (strcmp(argv[i], "--generate-scene") == 0 && i + 2 < argc)
+		{
+			// out bodies [depth [moons per planet [debris]]]
+			GeneratorSettings settings;
+			settings.bodyCount = atoi(argv[i + 2]);
+			if (i + 3 < argc && argv[i + 3][0] != '-') settings.depth = atoi(argv[i + 3]);
+			if (i + 4 < argc && argv[i + 4][0] != '-') settings.moonsPerPlanet = atoi(argv[i + 4]);
+			if (i + 5 < argc && argv[i + 5][0] != '-') settings.debrisCount = atoi(argv[i + 5]);
+			try
+			{
+				SceneGenerator().writeFile(settings, argv[i + 1]);
+			}
+			catch (const std::exception& e)
+			{
+				cerr << e.what() << endl;
+				return 1;
+			}
+			cout << "Generated " << argv[i + 1] << " with " << settings.bodyCount << " bodies" << endl;
+			return 0;
+		}
+		if (strcmp(argv[i], "--benchmark") == 0)
+		{
+			return runBenchmarks() ? 0 : 1;
+		}
+		if (strcmp(argv[i], "--benchmark-scaling") == 0)
+		{
+			int maxBodyCount = i + 1 < argc && argv[i + 1][0] != '-' ? atoi(argv[i + 1]) : 1000000;
+			return benchmarkSceneScaling(maxBodyCount, jobThreads) ? 0 : 1;
+		}
+	}
+
 	srand((int)time(NULL));
-	GLFWwindow* window = myCreateWindow(
-		WINDOW_WIDTH, WINDOW_HEIGHT, "Space Scene");	// create window
+	GLFWwindow* window = NULL;
+	if (gpuCulling)
+	{
+		window = myCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Space Scene", 4, 3);
+	}
+	if (window == NULL)
+	{
+		window = myCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, "Space Scene");	// create window
+	}
 	mySetWindowCenter(window);							// adjust window position
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED); // disable mouse
 	glfwSetCursorPosCallback(window, processMouse);		// set mouse event callback
+	glfwSetMouseButtonCallback(window, processMouseButton);
+	glfwSetKeyCallback(window, processKeyEvent);		// wake on demand rendering
+	glfwSetWindowRefreshCallback(window, processWindowRefresh);
 	gladLoadGLLoader((GLADloadproc)glfwGetProcAddress); // init glad
+	if (gpuCulling && !loadGLExtensions((GLADloadproc)glfwGetProcAddress))
+	{
+		cout << "OpenGL 4.3 not available, falling back to cpu culling\n";
+		gpuCulling = false;
+	}
 	
 
 	// ====================== OPENGL ======================		
@@ -125,24 +258,40 @@ int main(int argc, char** argv)
 	int startLoadingTime = (int)glfwGetTime(); // to calculate loading time
 
 
+	// ========= load scene =========
+
+	// bodies, meshes and textures come from the scene file, text scenes are compiled (and
+	// cached next to them) first, the compiled file is memory mapped
+	cout << "Loading Scene...\n";
+	try
+	{
+		string sceneBinaryPath = scenePath;
+		if (scenePath.size() >= 6 && scenePath.compare(scenePath.size() - 6, 6, ".scene") == 0)
+		{
+			sceneBinaryPath = SceneCompiler().compileIfOutdated(scenePath);
+		}
+		scene.load(sceneBinaryPath);
+	}
+	catch (const std::exception& e)
+	{
+		cerr << "Fail to load scene file\n";
+		cerr << e.what() << endl;
+		return -1;
+	}
+	cout << "Scene Loaded (" << scene.getBodyCount() << " bodies)\n\n";
+
+
 	// ========= load objects =========
 
 	ObjFileReader ofr;
-	ObjectFileData sphereObj, ufoObj, rocket2Obj, saturnRingObj, uranusRingObj, astroid1Obj, 
-		commandModuleObj, electronRocketObj, satelite1Obj, superHeavyRocketObj;
+	vector<ObjectFileData> meshObjects(scene.getMeshCount());
 	cout << "Loading Objects...\n";
 	try
 	{
-		sphereObj = ofr.read("resources/solar_system/sphere.obj");
-		ufoObj = ofr.read("resources/ufo_1/ufo_1.obj");
-		rocket2Obj = ofr.read("resources/rocket_2/rocket_2.obj");
-		saturnRingObj = ofr.read("resources/solar_system/ring_huge.obj");
-		uranusRingObj = ofr.read("resources/solar_system/ring_small.obj");
-		astroid1Obj = ofr.read("resources/astroid_1/astroid_1.obj");
-		commandModuleObj = ofr.read("resources/command_module/command_module.obj");
-		electronRocketObj = ofr.read("resources/electron/electron.obj");
-		satelite1Obj = ofr.read("resources/satelite_1/satelite_1.obj");
-		superHeavyRocketObj = ofr.read("resources/super_heavy/super_heavy.obj");
+		for (int v = 0; v < meshObjects.size(); v++)
+		{
+			meshObjects[v] = ofr.read(scene.getString(scene.getMesh(v).path));
+		}
 	}
 	catch (const std::exception& e)
 	{
@@ -151,31 +300,36 @@ int main(int argc, char** argv)
 		return -1;
 	}
 	vector<float> skyboxVert = getSkyboxCube();
-	vector<float>& sphereVert = sphereObj.subObjects[0].expandedVertices;
-	vector<float>& ufoVert = ufoObj.subObjects[0].expandedVertices;
-	vector<float>& rocket2Vert = rocket2Obj.subObjects[0].expandedVertices;
-	vector<float>& saturnRingVert = saturnRingObj.subObjects[0].expandedVertices;
-	vector<float>& uranusRingVert = uranusRingObj.subObjects[0].expandedVertices;
-	vector<float>& astroid1Vert = astroid1Obj.subObjects[0].expandedVertices;
-	vector<float>& commandModuleVert = commandModuleObj.subObjects[0].expandedVertices;
-	vector<float>& electronRocketVert = electronRocketObj.subObjects[0].expandedVertices;
-	vector<float>& satelite1Vert = satelite1Obj.subObjects[0].expandedVertices;
-	vector<float>& superHeavyRocketVert = superHeavyRocketObj.subObjects[0].expandedVertices;
 	cout << "Objects Loaded\n\n";
 
 
 	// ======== load shaders =========
 
 	cout << "Loading Shaders...\n";
-	unsigned int illumShaderProgram = LoadShader("shaders/illuminated.vert", "shaders/illuminated.frag");
+	unsigned int instancedShaderProgram = LoadShader("shaders/instanced.vert", "shaders/instanced.frag");
 	unsigned int earthShaderProgram = LoadShader("shaders/earth.vert", "shaders/earth.frag");
-	unsigned int basicShaderProgram = LoadShader("shaders/basic.vert", "shaders/basic.frag");
 	unsigned int skyShaderProgram = LoadShader("shaders/sky.vert", "shaders/sky.frag");
+	unsigned int cullShaderProgram = 0;
+	unsigned int indirectShaderProgram = 0;
+	if (gpuCulling)
+	{
+		cullShaderProgram = LoadComputeShader("shaders/cull.comp");
+		indirectShaderProgram = LoadShader("shaders/indirect.vert", "shaders/instanced.frag");
+	}
 	cout << "Shaders Loaded\n\n";
 
+	// per frame dynamic data, persistently mapped when buffer storage is available
+	frameStream.init(64 * 1024, loadBufferStorage((GLADloadproc)glfwGetProcAddress));
+	cout << "Frame Streaming: " << (frameStream.isPersistent() ? "persistent mapping" : "buffer orphaning") << "\n";
+
+	// shared per frame camera and lighting uniform blocks
+	frameUniforms.init();
+	frameUniforms.bindProgram(instancedShaderProgram);
+	frameUniforms.bindProgram(earthShaderProgram);
+	if (gpuCulling) frameUniforms.bindProgram(indirectShaderProgram);
+
 	vector<unsigned int> shaders{
-		basicShaderProgram,
-		illumShaderProgram,
+		instancedShaderProgram,
 		earthShaderProgram,
 	};
 
@@ -183,29 +337,15 @@ int main(int argc, char** argv)
 	// ======= load all textures =======
 
 	cout << "Loading Textures...\n";
-	GLuint sunTexture = loadTexture("resources/solar_system/textures/2k_sun.jpg");
-	GLuint mercuryTexture = loadTexture("resources/solar_system/textures/2k_mercury.jpg");
-	GLuint venusTexture = loadTexture("resources/solar_system/textures/2k_venus_surface.jpg");
-	//GLuint venusAtmosphereTexture = loadTexture("resources/solar_system/textures/2k_venus_atmosphere.jpg");
-	GLuint earthTexture = loadTexture("resources/solar_system/textures/2k_earth_daymap.jpg");
-	GLuint earthNightTexture = loadTexture("resources/solar_system/textures/8k_earth_nightmap.jpg");
-	GLuint earthCloudsTexture = loadTexture("resources/solar_system/textures/2k_earth_clouds.jpg");
-	GLuint moonTexture = loadTexture("resources/solar_system/textures/2k_moon.jpg");
-	GLuint marsTexture = loadTexture("resources/solar_system/textures/2k_mars.jpg");
-	GLuint jupiterTexture = loadTexture("resources/solar_system/textures/2k_jupiter.jpg");
-	GLuint saturnTexture = loadTexture("resources/solar_system/textures/2k_saturn.jpg");
-	GLuint saturnRingTexture = loadTexture("resources/solar_system/textures/saturn_ring_2.png");
-	GLuint uranusTexture = loadTexture("resources/solar_system/textures/2k_uranus.jpg");
-	GLuint uranusRingTexture = loadTexture("resources/solar_system/textures/uranus_ring_2.png");
-	GLuint neptuneTexture = loadTexture("resources/solar_system/textures/2k_neptune.jpg");
-	GLuint plutoTexture = loadTexture("resources/solar_system/textures/pluto.jpg");
-	GLuint ufoTexture = loadTexture("resources/ufo_1/ufo_kd.jpg");
-	GLuint rocket2Texture = loadTexture("resources/rocket_2/rocket.jpg");
-	GLuint astroid1Texture = loadTexture("resources/astroid_1/astroid_1.jpg");
-	GLuint commandModuleTexture = loadTexture("resources/command_module/command_module.png");
-	GLuint electronRocketTexture = loadTexture("resources/electron/electron.png");
-	GLuint satelite1Texture = loadTexture("resources/satelite_1/satelite_1.jpg");
-	GLuint superHeavyRocketTexture = loadTexture("resources/super_heavy/super_heavy.png");
+	vector<vector<GLuint>> textures(scene.getTextureCount());
+	for (int t = 0; t < textures.size(); t++)
+	{
+		const SceneTexture& sceneTexture = scene.getTexture(t);
+		for (int p = 0; p < sceneTexture.pathCount; p++)
+		{
+			textures[t].push_back(loadTexture(scene.getTexturePath(sceneTexture, p)));
+		}
+	}
 	vector<string> files = {
 		"resources/milkyway/right.png",
 		"resources/milkyway/left.png",
@@ -217,82 +357,30 @@ int main(int argc, char** argv)
 	GLuint skyTexture = loadCubemap(files);
 	cout << "Textures Loaded\n\n";
 
-	vector<vector<GLuint>> textures{
-		{ sunTexture },
-		{ mercuryTexture },
-		{ venusTexture },
-		{ earthTexture, earthCloudsTexture, earthNightTexture},
-		{ marsTexture },
-		{ jupiterTexture },
-		{ saturnTexture },
-		{ uranusTexture },
-		{ neptuneTexture },
-		{ plutoTexture },
-		{ moonTexture },
-		{ ufoTexture },
-		{ rocket2Texture },
-		{ saturnRingTexture },
-		{ uranusRingTexture },
-		{ astroid1Texture },
-		{ commandModuleTexture },
-		{ electronRocketTexture },
-		{ satelite1Texture },
-		{ superHeavyRocketTexture },
-	};
-
 
 	// ======= prepre scene rendering =======
 
 	cout << "Setting Up Scene...\n";
 	// gen buffers
-	unsigned int sphereVAO, sphereVBO;
-	glSetupVertexObject(sphereVAO, sphereVBO, sphereVert, vector<int>{3, 2, 3});
-	unsigned int ufoVAO, ufoVBO;
-	glSetupVertexObject(ufoVAO, ufoVBO, ufoVert, vector<int>{3, 2, 3});
-	unsigned int rocket2VAO, rocket2VBO;
-	glSetupVertexObject(rocket2VAO, rocket2VBO, rocket2Vert, vector<int>{3,2,3});
-	unsigned int saturnRingVAO, saturnRingVBO;
-	glSetupVertexObject(saturnRingVAO, saturnRingVBO, saturnRingVert, vector<int>{3, 2, 3});
-	unsigned int uranusRingVAO, uranusRingVBO;
-	glSetupVertexObject(uranusRingVAO, uranusRingVBO, uranusRingVert, vector<int>{3, 2, 3});
-	unsigned int astroid1VAO, astroid1VBO;
-	glSetupVertexObject(astroid1VAO, astroid1VBO, astroid1Vert, vector<int>{3, 2, 3});
-	unsigned int commandModuleVAO, commandModuleVBO;
-	glSetupVertexObject(commandModuleVAO, commandModuleVBO, commandModuleVert, vector<int>{3, 2, 3});
-	unsigned int electronRocketVAO, electronRocketVBO;
-	glSetupVertexObject(electronRocketVAO, electronRocketVBO, electronRocketVert, vector<int>{3, 2, 3});
-	unsigned int satelite1VAO, satelite1VBO;
-	glSetupVertexObject(satelite1VAO, satelite1VBO, satelite1Vert, vector<int>{3, 2, 3});
-	unsigned int superHeavyRocketVAO, superHeavyRocketVBO;
-	glSetupVertexObject(superHeavyRocketVAO, superHeavyRocketVBO, superHeavyRocketVert, vector<int>{3, 2, 3});
+	vector<unsigned int> VAOs(meshObjects.size());
+	vector<unsigned int> VBOs(meshObjects.size());
+	vector<int> vertexSize(meshObjects.size());
+	vector<vector<float>*> meshVertices(meshObjects.size());
+	for (int v = 0; v < meshObjects.size(); v++)
+	{
+		meshVertices[v] = &meshObjects[v].subObjects[0].expandedVertices;
+		vertexSize[v] = (int)meshVertices[v]->size() / 8;
+		glSetupVertexObject(VAOs[v], VBOs[v], *meshVertices[v], vector<int>{3, 2, 3});
+	}
 	unsigned int skyVAO, skyVBO;
 	glSetupVertexObject(skyVAO, skyVBO, skyboxVert, vector<int>{3});
 
-	vector<unsigned int> VAOs{
-		sphereVAO,
-		ufoVAO,
-		rocket2VAO,
-		saturnRingVAO,
-		uranusRingVAO,
-		astroid1VAO,
-		commandModuleVAO,
-		electronRocketVAO,
-		satelite1VAO,
-		superHeavyRocketVAO,
-	};
-
-	vector<int> vertexSize{
-		(int)sphereVert.size() / 8,
-		(int)ufoVert.size() / 8,
-		(int)rocket2Vert.size() / 8,
-		(int)saturnRingVert.size() / 8,
-		(int)uranusRingVert.size() / 8,
-		(int)astroid1Vert.size() / 8,
-		(int)commandModuleVert.size() / 8,
-		(int)electronRocketVert.size() / 8,
-		(int)satelite1Vert.size() / 8,
-		(int)superHeavyRocketVert.size() / 8,
-	};
+	// bounding sphere radius of every mesh, scaled per body for culling
+	vector<float> meshRadius;
+	for (int v = 0; v < meshVertices.size(); v++)
+	{
+		meshRadius.push_back(FrustumCuller::computeMeshRadius(*meshVertices[v], 8));
+	}
 
 	// remove binding
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -304,286 +392,182 @@ int main(int argc, char** argv)
 
 	// =========== MODEL & ANIMATION CONFIG ==============
 
+	// scale, orbit layout, delays and animators of every body, linear in the number of bodies
+	SceneSettings sceneSettings;
+	sceneSettings.earthOrbitDelay = earthOrbitDelay;
+	setupScene(scene, sceneSettings, renderedBodies, bodyConstants, sceneGraph, orbitSystem);
+	sunIdx = scene.getLightBody();
+	earthIdx = scene.getReferenceBody();
+	if (sunIdx != -1) sceneGraph.setLocal(sunIdx, lightPos, 0.f);
 
-	// model constants
-	float SPHERE_OBJECT_RADIUS = 2;		// 3d vertex sphere radius (do not change)
-
-	// model hyper params				(tweak these to adjust scene)
-
-	float distanceModifier = 240;		// master distance margin scale
-	float earthScale = 200;				// master scale
-
-	// all these values have to change if customization structure is changed
-	int attributeCount = 10;
-	vector<float> bodiesCustomization{
-
-		// esthetic
-		// a. is animated boolean 
-		// s. scale
-		// m. margin, the distance between the previous orbiting planet and 
-		//		current planet
-		// ov. oval ratio, major minor axis ratio
-		// rd. randomize spin angle boolean (this is the switch to enable fixed spin 
-		//		angle initialization relative to orbit angle, as some object have to be 
-		//		parpendicular to other object to make sense)
-		// 
-		// resource linking
-		// pr. parent index (-1: not orbiting, * > -1: orbiting pr when a == 1, 
-		//		following pr when a == 0) [refer to this array]
-		// bc. body constant index [refer to "bodyConstants" array]
-		// vao. VAO and vertex size index [refer to "vertexSize" & "VAOs" array]
-		// tx. texture index [refer to "textures" array]
-		// mv. model view boolean to disable model view option of certain objects
-		//
-		// rules: orbited object must come before orbiting object as some calculations 
-		//			are depending on their primary object
-		// earthIdx MUST BE CHANGED WHENEVER THE CONFIGURATION MATRIX IS CHANGED
-		// sunIdx MUST BE CHANGED WHENEVER THE CONFIGURATION MATRIX IS CHANGED
-		// 
-		//  a		s		m		ov		rd		pr*		bc		vao		tx		mv
-			0.f,	0.3f,	0.f,	1.f,	1.f,	-1.f,	0.f,	0.f,	0.f,	1.f, // 0. sun
-			1.f,	1.f,	20.f,	1.f,	1.f,	0.f,	1.f,	0.f,	1.f,	1.f, // 1. mercury
-			1.f,	1.f,	20.f,	1.f,	1.f,	0.f,	2.f,	0.f,	2.f,	1.f, // 2. venus
-			1.f,	0.6f,	5.f,	1.2f,	0.f,	2.f,	19.f,	7.f,	17.f,	1.f, // 3. electron rocket
-			1.f,	1.f,	20.f,	1.f,	1.f,	0.f,	3.f,	0.f,	3.f,	1.f, // 4. earth
-			1.f,	0.6f,	3.f,	1.2f,	1.f,	4.f,	17.f,	6.f,	16.f,	1.f, // 5. apollo 11 command module
-			1.f,	0.2f,	2.f,	1.f,	1.f,	4.f,	20.f,	8.f,	18.f,	1.f, // 5. satelite 1
-			1.f,	1.f,	5.f,	1.f,	0.f,	4.f,	10.f,	0.f,	10.f,	1.f, // 6. moon
-			1.f,	0.5f,	2.f,	1.f,	1.f,	7.f,	11.f,	1.f,	11.f,	1.f, // 7. ufo 
-			1.f,	0.5f,	0.3f,	1.05f,	1.f,	7.f,	12.f,	1.f,	11.f,	1.f, // 8. ufo 
-			1.f,	0.5f,	0.5f,	1.f,	1.f,	8.f,	12.f,	1.f,	11.f,	1.f, // 9. ufo 
-			1.f,	1.f,	20.f,	1.f,	1.f,	0.f,	4.f,	0.f,	4.f,	1.f, // 10. mars
-			1.f,	0.5f,	3.f,	1.f,	0.f,	11.f,	13.f,	2.f,	12.f,	1.f, // 11. rocket 2
-			1.f,	1.f,	5.f,	1.f,	1.f,	0.f,	16.f,	5.f,	15.f,	1.f, // 12. astroid 1
-			1.f,	1.f,	55.f,	1.f,	1.f,	0.f,	5.f,	0.f,	5.f,	1.f, // 13. jupiter
-			1.f,	1.f,	60.f,	1.f,	1.f,	0.f,	6.f,	0.f,	6.f,	1.f, // 14. saturn
-			0.f,	0.9,	0.f,	1.f,	1.f,	15.f,	14.f,	3.f,	13.f,	0.f, // 15. saturn ring
-			1.f,	1.f,	20.f,	1.5f,	0.f,	15.f,	18.f,	9.f,	19.f,	1.f, // 16. super heavy rocket
-			1.f,	1.f,	100.f,	1.f,	1.f,	0.f,	7.f,	0.f,	7.f,	1.f, // 17. uranus
-			0.f,	0.9,	0.f,	1.f,	1.f,	18.f,	15.f,	4.f,	14.f,	0.f, // 18. uranus ring
-			1.f,	1.f,	80.f,	1.f,	1.f,	0.f,	8.f,	0.f,	8.f,	1.f, // 19. neptune
-			1.f,	1.f,	40.f,	1.f,	1.f,	0.f,	9.f,	0.f,	9.f,	1.f, // 20. pluto
-	};
-	// TODO: add as much model as possible
-	// TODO: earth use multi textures, night city lights
-
-	renderedBodies.resize(bodiesCustomization.size() / attributeCount);
-	renderedBodies[sunIdx].position = vec3ToVec(lightPos);
-
-	// get predefined body constants for solar system
-	bodyConstants = m.getSolarSystemConstants();
-
-	// add additional custom made body constants for additional objects
-	// this part is just pure creativity nothing technical
-	BodyConst customBc;
-
-	// 11 ufo
-	customBc.ascendingNode = 0;									// adjust orbit ascending starting point (degree)
-	customBc.axialTilt = 180;									// adjust axial tilt relative to orbit plane (degree)
-	customBc.inclination = 180 + 30;							// adjust orbit inclination angle (degree)
-	customBc.localOrbitalPeriod = 30;							// number of spins per orbit
-	customBc.orbitalPeriod = PConst::MOON_ORBITAL_PERIOD / 8;	// orbit duration
-	customBc.radius = 400;										// object size (will be scaled relative to earth)
-	bodyConstants.push_back(customBc);
-
-	// 12 ufo
-	customBc.axialTilt += 10;
-	customBc.inclination += 10;
-	customBc.ascendingNode = 90;
-	customBc.orbitalPeriod = PConst::MOON_ORBITAL_PERIOD / 10;
-	bodyConstants.push_back(customBc);
-
-	// 13 rocket 2
-	customBc.ascendingNode = 0;	
-	customBc.axialTilt = 0;		
-	customBc.inclination = 20;	
-	customBc.localOrbitalPeriod = 1;						
-	customBc.orbitalPeriod = 30;
-	customBc.radius = 50;	
-	customBc.defaultSpinAngle = 90;	 // spin angle relative to orbit angle (make rocket perpendicular to orbit center)
-	bodyConstants.push_back(customBc);
-
-	// 14 ring
-	customBc.ascendingNode = 0;
-	customBc.axialTilt = 2;
-	customBc.inclination = 0;
-	customBc.radius = PConst::SATURN_RADIUS;
-	bodyConstants.push_back(customBc);
-
-	// 15 ring
-	customBc.ascendingNode = 0;
-	customBc.axialTilt = PConst::URANUS_AXIAL_TILT;
-	customBc.inclination = 0;
-	customBc.radius = PConst::URANUS_RADIUS;
-	customBc.defaultSpinAngle = 0;
-	bodyConstants.push_back(customBc);
-
-	// 16 astroid
-	customBc.ascendingNode = 10;
-	customBc.axialTilt = 10;
-	customBc.inclination = 5;
-	customBc.localOrbitalPeriod = 1;
-	customBc.orbitalPeriod = 600;
-	customBc.radius = PConst::MARS_RADIUS / 2;
-	bodyConstants.push_back(customBc);
-
-	// 17 command module
-	customBc.ascendingNode = 40;
-	customBc.axialTilt = 70;
-	customBc.inclination = 40;
-	customBc.localOrbitalPeriod = 0.1;
-	customBc.orbitalPeriod = 30;
-	customBc.radius = 500;
-	bodyConstants.push_back(customBc);
-
-	// 18 super heavy rocket
-	customBc.ascendingNode = 70;
-	customBc.axialTilt = 0;
-	customBc.inclination = 35;
-	customBc.localOrbitalPeriod = 1;
-	customBc.orbitalPeriod = 60;
-	customBc.radius = 500;
-	customBc.defaultSpinAngle = 90;
-	bodyConstants.push_back(customBc);
-
-	// 19 electron
-	customBc.ascendingNode = 20;
-	customBc.axialTilt = 10;
-	customBc.inclination = 35;
-	customBc.localOrbitalPeriod = 1;
-	customBc.orbitalPeriod = 30;
-	customBc.radius = 500;
-	customBc.defaultSpinAngle = 90;
-	bodyConstants.push_back(customBc);
-
-	// 20 satelite 1
-	customBc.ascendingNode = 0;
-	customBc.axialTilt = 20;
-	customBc.inclination = 70;
-	customBc.localOrbitalPeriod = 0.0001;
-	customBc.orbitalPeriod = 30;
-	customBc.radius = 500;
-	customBc.defaultSpinAngle = 90;
-	bodyConstants.push_back(customBc);
-
-	// ========== math section ============
-
-	// parse configurations
-	int animIndexCount = 0;
-	for (int i = 0; i < renderedBodies.size(); i++)
+	randomizeOrbitAngles();
+
+	// physics bodies start from their orbit at time 0 and fall from there
+	orbitSystem.evaluate(0.0);
+	setupPhysics(scene, sceneSettings, renderedBodies, bodyConstants, sceneGraph, orbitSystem, nbodySystem);
+	nbodySystem.setOpeningAngle(openingAngle);
+	nbodySystem.setIntegrator(yoshidaIntegrator ? NBodySystem::YOSHIDA4 : NBodySystem::LEAPFROG);
+
+	// bodies with a naif id follow the ephemeris instead of their kepler orbit, the kernel is mapped
+	// and only the records of the current time are read
+	if (!ephemerisPath.empty())
 	{
-		if ((bool)bodiesCustomization[i * attributeCount])
+		try
 		{
-			renderedBodies[i].animatorIdx = animIndexCount;
-			animIndexCount++;
+			spkEphemeris.load(ephemerisPath);
 		}
-		else
+		catch (const std::exception& e)
 		{
-			renderedBodies[i].animatorIdx = -1;
+			cerr << "Fail to load ephemeris\n";
+			cerr << e.what() << endl;
+			return -1;
 		}
-		renderedBodies[i].scaleModifier = bodiesCustomization[i * attributeCount + 1];
-		renderedBodies[i].distanceMargin = bodiesCustomization[i * attributeCount + 2];
-		renderedBodies[i].ovalRatio = bodiesCustomization[i * attributeCount + 3];
-		renderedBodies[i].randomSpinAngle = (bool)bodiesCustomization[i * attributeCount + 4];
-		renderedBodies[i].orbitParentIdx = bodiesCustomization[i * attributeCount + 5];
-		renderedBodies[i].bodyConstantIdx = bodiesCustomization[i * attributeCount + 6];
-		renderedBodies[i].VAOIdx = bodiesCustomization[i * attributeCount + 7];
-		renderedBodies[i].textureIdx = bodiesCustomization[i * attributeCount + 8];
-		renderedBodies[i].modelViewed = (bool)bodiesCustomization[i * attributeCount + 9];
+		int ephemerisBodies = setupEphemeris(sceneSettings, renderedBodies, bodyConstants, earthIdx, spkEphemeris);
+		cout << "Ephemeris: " << ephemerisBodies << " bodies from " << spkEphemeris.getSegmentCount() << " segments\n\n";
 	}
 
-	// compute scale relative to earth
+	// group bodies sharing a mesh into instanced batches, one per mesh and texture size, each body
+	// gets a layer in its batch texture array (earth keeps its own multi texture shader)
+	vector<int> meshBatcherIdx(VAOs.size(), -1);
+	vector<int> meshTextures(renderedBodies.size(), 0);		// index into the textures of the body's mesh
+	for (int v = 0; v < VAOs.size(); v++)
+	{
+		vector<int> batchTextureIdx;
+		bool transparent = false;
+		for (int i = 0; i < renderedBodies.size(); i++)
+		{
+			RenderedBody& rb = renderedBodies[i];
+			if (i == earthIdx || rb.VAOIdx != v) continue;
+
+			auto found = find(batchTextureIdx.begin(), batchTextureIdx.end(), rb.textureIdx);
+			meshTextures[i] = (int)(found - batchTextureIdx.begin());
+			if (found == batchTextureIdx.end()) batchTextureIdx.push_back(rb.textureIdx);
+			transparent = transparent || rb.transparent;
+		}
+		if (batchTextureIdx.empty()) continue;
+
+		vector<GLuint> batchTextures;
+		for (int t = 0; t < batchTextureIdx.size(); t++)
+		{
+			batchTextures.push_back(textures[batchTextureIdx[t]][0]);
+		}
+		meshBatcherIdx[v] = instanceBatcher.addMesh(VAOs[v], vertexSize[v], batchTextures, transparent);
+	}
+	vector<int> batchBodyCounts(instanceBatcher.getBatchCount(), 0);
 	for (int i = 0; i < renderedBodies.size(); i++)
 	{
 		if (i == earthIdx) continue;
-		renderedBodies[i].scale = m.getRelativeValue(bodyConstants[renderedBodies[i].bodyConstantIdx].radius,
-			PConst::EARTH_RADIUS, earthScale, renderedBodies[i].scaleModifier);
+		int batchIdx, layer;
+		instanceBatcher.getTextureSlot(meshBatcherIdx[renderedBodies[i].VAOIdx], meshTextures[i], batchIdx, layer);
+		batchBodyCounts[batchIdx]++;
 	}
-	renderedBodies[earthIdx].scale = earthScale; // set earth scale
-
-	// compute sphere radius for orbit radius calculation
-	vector<float> sphereRadius;
-	for (int i = 0; i < renderedBodies.size(); i++)
+	for (int b = 0; b < batchBodyCounts.size(); b++)
 	{
-		sphereRadius.push_back(renderedBodies[i].scale * SPHERE_OBJECT_RADIUS);
+		instanceBatcher.reserve(b, batchBodyCounts[b]);
 	}
 
-	// calculate orbit radius distance for individual bodies
-	for (int i = 0; i < renderedBodies.size(); i++)
+	// gpu driven path takes every opaque body except earth (multi texture shader), 
+	// all of them share one mesh buffer and one texture array per texture size
+	vector<int> gpuObjectIdx(renderedBodies.size(), -1);
+	if (gpuCulling)
 	{
-		// TODO following object
-		if (renderedBodies[i].orbitParentIdx == -1) continue;
-
-		// find last previous orbiting body that has the same parent 
-		// if doesn't exist use current body parent index (next section)
-		int preIdx = -1;
-		for (int j = i - 1; j > -1; j--)
+		vector<int> indirectMeshIdx(VAOs.size(), -1);
+		vector<int> gpuTextureIdx;
+		vector<int> bodyGpuTexture(renderedBodies.size(), -1);
+		for (int i = 0; i < renderedBodies.size(); i++)
 		{
-			if (renderedBodies[i].orbitParentIdx == renderedBodies[j].orbitParentIdx)
+			RenderedBody& rb = renderedBodies[i];
+			if (i == earthIdx || rb.transparent) continue;
+
+			if (indirectMeshIdx[rb.VAOIdx] == -1)
 			{
-				preIdx = j;
-				break;
+				indirectMeshIdx[rb.VAOIdx] = indirectRenderer.addMesh(*meshVertices[rb.VAOIdx]);
 			}
+
+			auto found = find(gpuTextureIdx.begin(), gpuTextureIdx.end(), rb.textureIdx);
+			bodyGpuTexture[i] = (int)(found - gpuTextureIdx.begin());
+			if (found == gpuTextureIdx.end()) gpuTextureIdx.push_back(rb.textureIdx);
 		}
 
-		// calculate orbit radius, if this body is the first object that orbits it's parent then do this
-		if (preIdx == -1)
+		vector<GLuint> gpuTextures;
+		for (int t = 0; t < gpuTextureIdx.size(); t++)
 		{
-			renderedBodies[i].orbitRadius =
-				sphereRadius[renderedBodies[i].orbitParentIdx] + sphereRadius[i] +
-				(renderedBodies[i].distanceMargin * distanceModifier);
+			gpuTextures.push_back(textures[gpuTextureIdx[t]][0]);
 		}
-		// else use previous neighbour's values to calculate orbit radius
-		else
+
+		// layers limited to the planet texture size to keep the arrays reasonably small
+		vector<unsigned int> gpuTextureArrays;
+		vector<int> gpuArrayOf, gpuLayerOf;
+		InstanceBatcher::buildTextureArrays(gpuTextures, gpuTextureArrays, gpuArrayOf, gpuLayerOf, 2048, 1024);
+
+		for (int i = 0; i < renderedBodies.size(); i++)
 		{
-			renderedBodies[i].orbitRadius =
-				renderedBodies[preIdx].orbitRadius + sphereRadius[preIdx] + sphereRadius[i] +
-				(renderedBodies[i].distanceMargin * distanceModifier);
+			int t = bodyGpuTexture[i];
+			if (t == -1) continue;
+
+			RenderedBody& rb = renderedBodies[i];
+			int flags = 0;
+			if (i == sunIdx) flags |= IndirectRenderer::FLAG_UNLIT;
+			gpuObjectIdx[i] = indirectRenderer.addObject(indirectMeshIdx[rb.VAOIdx], meshRadius[rb.VAOIdx], 
+				gpuArrayOf[t], gpuLayerOf[t], flags);
 		}
+		indirectRenderer.build(cullShaderProgram, indirectShaderProgram, gpuTextureArrays);
+		cout << "GPU Culling: " << indirectRenderer.getObjectCount() << " objects, " 
+			<< indirectRenderer.getMeshCount() << " meshes\n";
 	}
 
-	// calculate delays relative to earth orbiting period
-	vector<float> delays;
+	// per frame components, every body is culled, the rest depends on how it is animated and drawn
 	for (int i = 0; i < renderedBodies.size(); i++)
 	{
-		if (renderedBodies[i].animatorIdx == -1) continue;
-		if (i == earthIdx) // use delay specified by user
+		RenderedBody& rb = renderedBodies[i];
+		uint32_t mask = BodyStore::maskOf(COMPONENT_BOUNDS);
+		if (rb.animatorIdx != -1) mask |= BodyStore::maskOf(COMPONENT_ORBIT);
+		if (gpuObjectIdx[i] != -1) mask |= BodyStore::maskOf(COMPONENT_GPU);
+		else if (i == earthIdx) mask |= BodyStore::maskOf(COMPONENT_PACKET);
+		else mask |= BodyStore::maskOf(COMPONENT_INSTANCE);
+
+		int body = bodyStore.addBody(mask);
+		bodyStore.get<BoundsComponent>(body).radius = rb.scale * meshRadius[rb.VAOIdx];
+		if (rb.animatorIdx != -1) bodyStore.get<OrbitComponent>(body).animatorIdx = rb.animatorIdx;
+		if (bodyStore.has(body, COMPONENT_GPU)) bodyStore.get<GpuComponent>(body).objectIdx = gpuObjectIdx[i];
+		if (bodyStore.has(body, COMPONENT_PACKET))
 		{
-			delays.push_back(earthOrbitDelay);
+			PacketComponent& packet = bodyStore.get<PacketComponent>(body);
+			packet.VAOIdx = rb.VAOIdx;
+			packet.textureIdx = rb.textureIdx;
+			packet.transparent = rb.transparent;
 		}
-		else // use delay relative to earth delay
+		if (bodyStore.has(body, COMPONENT_INSTANCE))
 		{
-			delays.push_back(m.getRelativeValue(
-				bodyConstants[renderedBodies[i].bodyConstantIdx].orbitalPeriod,
-				bodyConstants[renderedBodies[earthIdx].bodyConstantIdx].orbitalPeriod, earthOrbitDelay));
+			InstanceComponent& instance = bodyStore.get<InstanceComponent>(body);
+			instanceBatcher.getTextureSlot(meshBatcherIdx[rb.VAOIdx], meshTextures[i], instance.batchIdx, instance.textureLayer);
+			instance.flags = i == sunIdx ? InstanceBatcher::FLAG_UNLIT : 0;	// light source skips lighting
 		}
 	}
 
-	// calculate sum of all parents ascending node angle and sum of all inlinations including it's own
-	for (int i = 0; i < renderedBodies.size(); i++)
+	// slow, distant and tiny bodies are evaluated less often, starts in the fastest tier (only
+	// from UpdateScheduler::MIN_BODIES bodies, below that evaluating every body each tick is faster)
+	bool scheduleUpdates = orbitSystem.getBodyCount() >= UpdateScheduler::MIN_BODIES;
+	if (scheduleUpdates)
 	{
-		// not animated and not following other object
-		if (renderedBodies[i].animatorIdx == -1 && renderedBodies[i].orbitParentIdx == -1) continue; 
-		int parentIndex = renderedBodies[i].orbitParentIdx;
-		renderedBodies[i].parentsAscendingNodeSum = m.sumAllAscendingNodes(
-			renderedBodies, bodyConstants, parentIndex);
-		renderedBodies[i].allInclinationSum = m.sumAllInclinations(
-			renderedBodies, bodyConstants, i);
+		updateScheduler.resize(orbitSystem.getBodyCount());
+		updateScheduler.setTickSeconds(1.0 / simulationTickRate);
+		updateScheduler.setBudget(updateBudget);
+		for (int i = 0; i < renderedBodies.size(); i++)
+		{
+			RenderedBody& rb = renderedBodies[i];
+			if (rb.animatorIdx != -1) updateScheduler.setBodyRadius(rb.animatorIdx, rb.scale * meshRadius[rb.VAOIdx]);
+		}
 	}
 
-	// initialize animators
+	frustumCuller.resize((int)renderedBodies.size());
+	bodyBvh.resize((int)renderedBodies.size());
 	for (int i = 0; i < renderedBodies.size(); i++)
 	{
-		if (renderedBodies[i].animatorIdx == -1) continue; // not animated
-		int animatorIndex = renderedBodies[i].animatorIdx;
-		int bodyConstantIndex = renderedBodies[i].bodyConstantIdx;
-		animators.push_back(
-			OrbitAnimator(delays[animatorIndex], bodyConstants[bodyConstantIndex].localOrbitalPeriod,
-				renderedBodies[i].ovalRatio, renderedBodies[i].orbitRadius,	renderedBodies[i].allInclinationSum)
-		);
+		bodySelectable.push_back(renderedBodies[i].modelViewed);
 	}
-
-	randomizeOrbitAngles();
+	nearestBodies.reserve(1);
+	renderQueue.reserve((int)renderedBodies.size());	// at most one packet per body, frames never allocate
 
 	cout << "Scene Set up\n";
 	cout << "\nLoading Time: " << (int)glfwGetTime() - startLoadingTime << "s\n\n";
@@ -594,83 +578,120 @@ int main(int argc, char** argv)
 	glUseProgram(skyShaderProgram);
 	glUniform1i(glGetUniformLocation(skyShaderProgram, "skybox"), 0); // set texture to 0
 
+	glUseProgram(instancedShaderProgram);
+	glUniform1i(glGetUniformLocation(instancedShaderProgram, "Textures"), 0);
+
+	if (gpuCulling)
+	{
+		glUseProgram(indirectShaderProgram);
+		glUniform1i(glGetUniformLocation(indirectShaderProgram, "Textures"), 0);
+	}
+
 	glUseProgram(earthShaderProgram);
 	glUniform1i(glGetUniformLocation(earthShaderProgram, "Texture1"), 0);
 	glUniform1i(glGetUniformLocation(earthShaderProgram, "Texture2"), 1);
 	glUniform1i(glGetUniformLocation(earthShaderProgram, "Texture3"), 2);
-
-	sceneState.addSPlayTime(glfwGetTime());		// add asset loading time to paused time (rectify animation time)
-	//sceneState.pauseScene(glfwGetTime(), true);
-
-	glm::vec3 Xaxis = glm::vec3(1.f, 0.f, 0.f);
-	glm::vec3 Yaxis = glm::vec3(0.f, 1.f, 0.f);
-	glm::vec3 Zaxis = glm::vec3(0.f, 0.f, 1.f);
+	glUniform1f(glGetUniformLocation(earthShaderProgram, "sunAmbientStrength"), 0.06f);
+
+	// animation runs on its own thread from here on, the orbit system is changed through simulation.post
+	// only gl calls have to stay on this thread, everything before submission is split into jobs
+	jobSystem.start(jobThreads);
+	simulation.setCommandCallback(requestRedraw);
+	if (scheduleUpdates) simulation.setScheduler(&updateScheduler);
+	if (nbodySystem.getParticleCount() > 0)
+	{
+		int physicsInterval = physicsTickRate > 0.0 ? (int)(simulationTickRate / physicsTickRate + 0.5) : 1;
+		simulation.setNBody(&nbodySystem, physicsInterval);
+	}
+	if (spkEphemeris.getBodyCount() > 0) simulation.setEphemeris(&spkEphemeris);
+	simulation.start(&orbitSystem, simulationTickRate, &jobSystem);
 
 	float ptime = glfwGetTime();
 	float ftime = ptime;
 	int fpsCount = 0;
+	int visibleSum = 0;
+	long long allocationSum = 0;	// heap allocations of the render thread, steady state should be 0
+	long long allocationMax = 0;
+
+	framePacer.init(PacingMode::CAPPED, targetFPS);
 
 	while (!glfwWindowShouldClose(window))
 	{
+		// nothing can change while paused without input, block until an event arrives
+		// instead of redrawing the same frame (continuous again once animation resumes)
+		if (sceneState.getPause() && keysHeld == 0 && !redrawRequested)
+		{
+			glfwWaitEventsTimeout(idleWaitTimeout);
+			if (!redrawRequested && keysHeld == 0) continue;
+			framePacer.resync();
+		}
+		redrawRequested = false;
+
+		// sleep until next frame (capped) or let swap buffers wait for vsync
+		framePacer.waitForNextFrame();
+		long long frameAllocationStart = getThreadAllocationCount();
+
 		// input
 		processKeyboard(window);
 
-		// cap fps 
-		if (!frameTrigger.toggle(glfwGetTime()))
-		{
-			continue;
-		}
 		ftime = glfwGetTime();
 		if ((ftime - ptime) >= 10.f)
 		{
-			cout << "Avg FPS: " << fpsCount / (ftime - ptime) << endl;
+			// visible bodies are the ones drawn through the render queue, the gpu culled ones are
+			// never read back so they only count as objects
+			cout << "Avg FPS: " << fpsCount / (ftime - ptime) << ", Draw Calls: " << renderQueue.getDrawCount() 
+				<< ", Avg Visible Bodies: " << (float)visibleSum / (fpsCount > 0 ? fpsCount : 1) << "/" 
+				<< renderedBodies.size() - indirectRenderer.getObjectCount() << endl;
+			if (gpuCulling)
+			{
+				cout << "GPU Culled Objects: " << indirectRenderer.getObjectCount() << " (visible count not read back), Multi Draws: " 
+					<< indirectRenderer.getMultiDrawCount() << endl;
+			}
+			cout << "Pacing: " << framePacer.getModeName() << ", Frame Time: " << framePacer.getAverageFrameTime() 
+				<< "ms, Jitter: " << framePacer.getFrameTimeJitter() << "ms, Max: " << framePacer.getMaxFrameTime() << "ms" << endl;
+			cout << "Heap Allocations: " << (float)allocationSum / (fpsCount > 0 ? fpsCount : 1) << "/frame, Max: " << allocationMax << endl;
+			if (nbodySystem.getParticleCount() > 0)
+			{
+				cout << "Physics: " << nbodySystem.getParticleCount() << " particles, " << NBodySystem::getIntegratorName(yoshidaIntegrator
+					? NBodySystem::YOSHIDA4 : NBodySystem::LEAPFROG) << ", Energy Drift: " << simulation.getPhysicsEnergyDrift() << endl;
+			}
+			framePacer.resetStats();
 			ptime = ftime;
 			fpsCount = 0;
+			visibleSum = 0;
+			allocationSum = 0;
+			allocationMax = 0;
 		}
 		else
 		{
 			fpsCount++;
 		}
 
-		// animate animated objects (some object might just require rendering but not animating)
-		if (sceneState.getCanUpdateAnimation())
+		// latest animation state, interpolated between the last two simulation ticks
+		// the scheduler gets each body's on screen scale from the previous frame's transforms and culling
+		if (simulation.sample(bodyStates))
 		{
-			float ms_time = (float)sceneState.getMsPlayTime(glfwGetTime()); // get animation time
-
-			// animate all objects
-			for (int i = 0; i < renderedBodies.size(); i++)
+			float projectionScale = UpdateScheduler::getProjectionScale(camera.getFOV(), WINDOW_HEIGHT);
+			glm::vec3 viewPos = camera.getPosition();
+			bodyStore.forEach(BodyStore::maskOf(COMPONENT_ORBIT), [projectionScale, viewPos, scheduleUpdates](BodyArchetype& archetype)
 			{
-				// if object is not aniamated and not orbiting anithing then skip
-				if (renderedBodies[i].animatorIdx == -1) continue;
-
-				// if object is not animated but orbiting something then it must be following it
-				if (renderedBodies[i].animatorIdx == -1 && renderedBodies[i].orbitParentIdx != -1)
-				{
-					renderedBodies[i].position = renderedBodies[renderedBodies[i].orbitParentIdx].position;
-					continue;
-				}
-
-				// current orbiting object's parent index
-				int parentIdx = renderedBodies[i].orbitParentIdx;
-				int animatorIdx = renderedBodies[i].animatorIdx;
-
-				// parent must update its animated position before the child is, thus parent index < child index
-				if (parentIdx > i)
+				const int* bodies = archetype.getBodies();
+				const OrbitComponent* orbits = archetype.column<OrbitComponent>();
+				const glm::vec3* worldPositions = sceneGraph.getWorldPositions();
+				jobSystem.parallelFor(archetype.getCount(), 1024, [&](int begin, int end)
 				{
-					cout << "revolved celestial bodies must be animated before the it's children\n";
-					exit(-1);
-				}
-
-				// animate orbit of current object with a origin of parent's position
-				animators[animatorIdx].animate(ms_time, 5, 5, sceneState.getJustStarted());
-
-				// retrieve position
-				renderedBodies[i].position = animators[animatorIdx].getOrbitPosition();
-				renderedBodies[i].rotation = animators[animatorIdx].getSpinAngle();
-
-			}
-
-			sceneState.setJustStarted(false);
+					for (int r = begin; r < end; r++)
+					{
+						int body = bodies[r];
+						const BodyState& state = bodyStates[orbits[r].animatorIdx];
+						sceneGraph.setLocal(body, state.position, state.rotation);
+
+						if (!scheduleUpdates) continue;
+						float distance = glm::max(glm::length(worldPositions[body] - viewPos), 1.f);
+						updateScheduler.setView(orbits[r].animatorIdx, frustumCuller.isVisible(body) ? projectionScale / distance : 0.f);
+					}
+				});
+			});
 		}
 
 		// render
@@ -679,104 +700,105 @@ int main(int argc, char** argv)
 		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 
 		// view and perspective
-		glm::mat4 model = glm::mat4(1.f);
 		glm::mat4 view = glm::mat4(1.f);
 		glm::mat4 projection = glm::mat4(1.f);
 		view = glm::lookAt(camera.getPosition(), camera.getPosition() + camera.getFront(), camera.getUp());
 		projection = glm::perspective(glm::radians(camera.getFOV()),
 			(float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 10.f, 400000.f);
 
-		for (int i = 0; i < renderedBodies.size(); i++)
-		{
-			int bcIdx = renderedBodies[i].bodyConstantIdx;
-			int txIdx = renderedBodies[i].textureIdx;
-			BodyConst& bc = bodyConstants[bcIdx];
-			RenderedBody& rb = renderedBodies[i];
+		// upload shared camera and lighting data once for all programs
+		frameStream.beginFrame();
+		frameUniforms.update(view, projection, camera, lightPos, fTrigger.getValue(), frameStream);
 
-			// if object is not animated and not following any other object
-			if (renderedBodies[i].animatorIdx == -1 && renderedBodies[i].orbitParentIdx == -1)
+		// model matrices and bounding spheres of every body, only moved subtrees are recomposed
+		sceneGraph.update(&jobSystem);
+		const glm::mat4* bodyModels = sceneGraph.getWorlds();
+		const glm::vec3* bodyPositions = sceneGraph.getWorldPositions();
+		bodyStore.forEach(BodyStore::maskOf(COMPONENT_BOUNDS), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const BoundsComponent* bounds = archetype.column<BoundsComponent>();
+			jobSystem.parallelFor(archetype.getCount(), 1024, [&](int begin, int end)
 			{
-				// if object is light source use different shader, default to illum shader
-				unsigned int shaderProg = illumShaderProgram;
-				if (i == sunIdx) shaderProg = basicShaderProgram;
-
-				glUseProgram(shaderProg);
-				model = glm::mat4(1.f);
-				model = glm::translate(model, vecToVec3(rb.position)); // sum all position
-				model = glm::rotate(model, glm::radians(bc.axialTilt), Zaxis);
-				model = glm::scale(model, glm::vec3(rb.scale));
-				glSetModelViewProjection(shaderProg, model, view, projection);
-				glDrawVertexTriangles(VAOs[rb.VAOIdx], textures[txIdx][0], vertexSize[rb.VAOIdx]);
-
-			}
-			// if object is animated or following animated object
-			else
+				for (int r = begin; r < end; r++) frustumCuller.setSphere(bodies[r], bodyPositions[bodies[r]], bounds[r].radius);
+			});
+		});
+		bodyStore.forEach(BodyStore::maskOf(COMPONENT_GPU), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const GpuComponent* gpu = archetype.column<GpuComponent>();
+			jobSystem.parallelFor(archetype.getCount(), 1024, [&](int begin, int end)
 			{
-				RenderedBody& pr = renderedBodies[rb.orbitParentIdx];
-				
-				// use special shader for earth
-				if (i == earthIdx) glUseProgram(earthShaderProgram);
-				else glUseProgram(illumShaderProgram);
-
-				model = glm::mat4(1.f);
-
-				// rotate using parents' ascending node to rectify orbit shift due to parent's shift of their own ascending node angle
-				model = glm::rotate(model, glm::radians(rb.parentsAscendingNodeSum), Yaxis);
-
-				// move world centered orbit to body centered orbit (such as moon orbiting sun translate to moon orbiting earth)
-				model = glm::translate(model, vecToVec3(m.sumAllPositions(renderedBodies, rb.orbitParentIdx)));
-
-				// rotate whole orbit to change orbit ascending starting point
-				model = glm::rotate(model, glm::radians(bc.ascendingNode), Yaxis);
-
-				// move orbit to world centered orbit position
-				model = glm::translate(model, vecToVec3(rb.position));
-
-				// create sphere tilt and add // TODO all parents' inclidnations
-				model = glm::rotate(model, glm::radians(bc.axialTilt + rb.allInclinationSum), Zaxis);
-
-				// create sphere spin
-				model = glm::rotate(model, glm::radians(rb.rotation), Yaxis);
-				
-				// scale to correct size
-				model = glm::scale(model, glm::vec3(rb.scale));			
-
-				// store actual position for model view camera
-				glm::vec4 actualPos = model * glm::vec4(0, 0, 0, 1);
-				rb.finalPosition = vec3ToVec(
-					glm::vec3(
-						actualPos[0]/actualPos[3], 
-						actualPos[1]/actualPos[3], 
-						actualPos[2]/actualPos[3]
-					)
-				);
-
-				// for earth use special shader
-				if (i == earthIdx)
-				{
-					glSetLightingConfig(earthShaderProgram, lightPos, camera, fTrigger.getValue());
-					glUniform1f(glGetUniformLocation(earthShaderProgram, "light[0].ambientStrength"), 0.06f);
-					glSetModelViewProjection(earthShaderProgram, model, view, projection);
-					glBindVertexArray(VAOs[rb.VAOIdx]);
-					glActiveTexture(GL_TEXTURE0);
-					glBindTexture(GL_TEXTURE_2D, textures[txIdx][0]);
-					glActiveTexture(GL_TEXTURE1);
-					glBindTexture(GL_TEXTURE_2D, textures[txIdx][1]);
-					glActiveTexture(GL_TEXTURE2);
-					glBindTexture(GL_TEXTURE_2D, textures[txIdx][2]);
-					glDrawArrays(GL_TRIANGLES, 0, vertexSize[rb.VAOIdx]);
-				}
-				else
+				for (int r = begin; r < end; r++) indirectRenderer.setTransform(gpu[r].objectIdx, bodyModels[bodies[r]]);
+			});
+		});
+
+		// drop bodies outside of the view frustum, the flat simd test beats refitting the bvh and
+		// culling through it every frame (--benchmark), the bvh is only refitted for queries
+		frustumCuller.setFrustum(projection, view);
+		frustumCuller.cull(&jobSystem);
+
+		// collect draw packets, they are sorted by state before submission
+		renderQueue.clear();
+		instanceBatcher.begin();
+		glm::vec3 camPos = camera.getPosition();
+
+		// bodies drawn by the gpu have neither component and are skipped, instances are collected
+		// in parallel ranges and merged in body order
+		bodyStore.forEach(BodyStore::maskOf(COMPONENT_INSTANCE), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const InstanceComponent* instances = archetype.column<InstanceComponent>();
+			instanceBatcher.addParallel(archetype.getCount(), [&](int begin, int end, const auto& add)
+			{
+				for (int r = begin; r < end; r++)
 				{
-					glSetLightingConfig(illumShaderProgram, lightPos, camera, fTrigger.getValue());
-					glSetModelViewProjection(illumShaderProgram, model, view, projection);
-					glDrawVertexTriangles(VAOs[rb.VAOIdx], textures[txIdx][0], vertexSize[rb.VAOIdx]);
+					int i = bodies[r];
+					if (!frustumCuller.isVisible(i)) continue;
+					float viewDepth = glm::length(bodyPositions[i] - camPos);
+					add(instances[r].batchIdx, bodyModels[i], instances[r].textureLayer, instances[r].flags, viewDepth);
 				}
+			}, &jobSystem);
+		});
+
+		// for earth use special shader with day, cloud and night textures
+		bodyStore.forEach(BodyStore::maskOf(COMPONENT_PACKET), [&](BodyArchetype& archetype)
+		{
+			const int* bodies = archetype.getBodies();
+			const PacketComponent* packets = archetype.column<PacketComponent>();
+			for (int r = 0; r < archetype.getCount(); r++)
+			{
+				int i = bodies[r];
+				if (!frustumCuller.isVisible(i)) continue;
+				const PacketComponent& pc = packets[r];
+				DrawPacket packet;
+				packet.shaderProgram = earthShaderProgram;
+				packet.VAO = VAOs[pc.VAOIdx];
+				packet.count = vertexSize[pc.VAOIdx];
+				packet.model = bodyModels[i];
+				packet.textureCount = 3;
+				packet.textures[0] = textures[pc.textureIdx][0];
+				packet.textures[1] = textures[pc.textureIdx][1];
+				packet.textures[2] = textures[pc.textureIdx][2];
+				renderQueue.push(packet, glm::length(bodyPositions[i] - camPos), pc.transparent);
+				visibleSum++;
 			}
-		}
+		});
+		visibleSum += instanceBatcher.getInstanceCount();
+
+		// one instanced draw per mesh, then sort by program, VAO and texture and draw
+		instanceBatcher.flush(renderQueue, instancedShaderProgram, frameStream, &jobSystem);
+		if (gpuCulling) indirectRenderer.upload(frameStream);
+		frameStream.flush();
+		renderQueue.sort();
+
+		// opaque gpu culled bodies go before the queue so its transparent pass blends over them
+		if (gpuCulling) indirectRenderer.draw(frustumCuller.getPlanes());
+		renderQueue.submit();
 
 		// skybox (contains gl code)
 		displaySkyBox(skyVAO, skyTexture, skyShaderProgram, view, projection);
+		frameStream.endFrame();
 
 		// return errors if there's any
 		GLenum err;
@@ -784,8 +806,14 @@ int main(int argc, char** argv)
 
 		glfwSwapBuffers(window);
 		glfwPollEvents();
+
+		long long frameAllocations = getThreadAllocationCount() - frameAllocationStart;
+		allocationSum += frameAllocations;
+		if (frameAllocations > allocationMax) allocationMax = frameAllocations;
 	}
 
+	simulation.stop();
+	jobSystem.stop();
 	glfwTerminate();
 	return 0;
 }
@@ -888,8 +916,7 @@ void processKeyboard(GLFWwindow* window)
 			float stepSize = powf(10, log10f(camera.getModelViewDistance()) - 1) * 0.05 * cTrigger.getDiffRatio();
 			camera.decreaseModelViewDistance(stepSize);
 		}
-		camera.moveAndOrientCamera(
-			vecToVec3(renderedBodies[modelSelection].finalPosition), x, y);
+		camera.moveAndOrientCamera(sceneGraph.getWorldPosition(modelSelection), x, y);
 	}
 
 	// general camera
@@ -901,11 +928,29 @@ void processKeyboard(GLFWwindow* window)
 		
 	// pausing
 	if (glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS) 
+	{
 		sceneState.pauseScene(glfwGetTime());
+		simulation.setPaused(sceneState.getPause());
+	}
 	
 	// toggle player torch light
 	if ((glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS))
 		fTrigger.toggle(glfwGetTime());
+
+	// jump to the body closest to the camera
+	if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS && nTrigger.toggle(glfwGetTime()))
+	{
+		updateBodyBvh();
+		bodyBvh.nearest(camera.getPosition(), 1, nearestBodies, bodySelectable.data());
+		if (!nearestBodies.empty()) selectBody(nearestBodies[0]);
+	}
+
+	// cycle frame pacing mode
+	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS && vTrigger.toggle(glfwGetTime()))
+	{
+		framePacer.cycleMode();
+		cout << "Frame Pacing: " << framePacer.getModeName() << "\n";
+	}
 	
 	// speed up
 	if (glfwGetKey(window, GLFW_KEY_PERIOD) == GLFW_PRESS && commaTrigger.toggle(glfwGetTime()))
@@ -915,7 +960,7 @@ void processKeyboard(GLFWwindow* window)
 		if (newValue > 0.01)
 		{
 			earthOrbitDelay = newValue;
-			updateAnimatorsDelays();
+			simulation.post([newValue]() { updateAnimatorsDelays(newValue); });
 			cout << "Earth 1yr = " << earthOrbitDelay << "s\n";
 		}
 	}
@@ -927,7 +972,7 @@ void processKeyboard(GLFWwindow* window)
 		if (newValue < 86401)
 		{
 			earthOrbitDelay = newValue;
-			updateAnimatorsDelays();
+			simulation.post([newValue]() { updateAnimatorsDelays(newValue); });
 			cout << "Earth 1yr = " << earthOrbitDelay << "s\n";
 		}
 	}
@@ -938,7 +983,7 @@ void processKeyboard(GLFWwindow* window)
 		// if toggled then trigger (the internal state doesn't matter)
 		if (rTrigger.toggle(glfwGetTime()))
 		{
-			randomizeOrbitAngles();
+			simulation.post(randomizeOrbitAngles);
 		}
 	}
 }
@@ -962,6 +1007,57 @@ void processMouse(GLFWwindow* window, double x, double y)
 	{
  		camera.orientCamera(dX, dY);
 	}
+	redrawRequested = true;
+}
+
+void selectBody(int idx)
+{
+	modelSelection = idx;
+	if (!cameraMode) camera.setYaw(camera.getYaw() - 180.f); // fix camera flip 180
+	cameraMode = true;
+	cout << "Model View: " << scene.getString(scene.getBody(idx).name) << "\n";
+}
+
+void updateBodyBvh()
+{
+	const glm::vec3* bodyPositions = sceneGraph.getWorldPositions();
+	bodyStore.forEach(BodyStore::maskOf(COMPONENT_BOUNDS), [bodyPositions](BodyArchetype& archetype)
+	{
+		const int* bodies = archetype.getBodies();
+		const BoundsComponent* bounds = archetype.column<BoundsComponent>();
+		for (int r = 0; r < archetype.getCount(); r++) bodyBvh.setSphere(bodies[r], bodyPositions[bodies[r]], bounds[r].radius);
+	});
+	bodyBvh.refit(&jobSystem);
+}
+
+void processMouseButton(GLFWwindow* window, int button, int action, int mods)
+{
+	// cursor is captured, so the body in the middle of the screen is picked
+	if (button != GLFW_MOUSE_BUTTON_LEFT || action != GLFW_PRESS || cameraMode) return;
+	updateBodyBvh();
+	int idx = bodyBvh.raycast(camera.getPosition(), glm::normalize(camera.getFront()), bodySelectable.data());
+	if (idx != -1) selectBody(idx);
+	redrawRequested = true;
+}
+
+void processKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	// keyboard itself is polled in processKeyboard, this only tracks activity
+	if (action == GLFW_PRESS) keysHeld++;
+	if (action == GLFW_RELEASE && keysHeld > 0) keysHeld--;
+	redrawRequested = true;
+}
+
+void processWindowRefresh(GLFWwindow* window)
+{
+	// window uncovered or restored, contents need to be drawn again
+	redrawRequested = true;
+}
+
+void requestRedraw()
+{
+	redrawRequested = true;
+	glfwPostEmptyEvent();	// wake glfwWaitEventsTimeout
 }
 
 unsigned int loadTexture(const char* path)
@@ -1046,31 +1142,16 @@ unsigned int loadCubemap(vector<string> faces)
 
 // ============ animation calculations ================
 
-void updateAnimatorsDelays()
+void updateAnimatorsDelays(float earthDelay)
 {
-	// calculate delays relative to earth orbiting period
+	// delays relative to earth orbiting period, one per animator
 	vector<float> delays;
-	for (int i = 0; i < renderedBodies.size(); i++)
+	computeOrbitDelays(renderedBodies, bodyConstants, earthIdx, earthDelay, delays);
+	for (int i = 0; i < delays.size(); i++)
 	{
-		if (renderedBodies[i].animatorIdx == -1) continue;
-		if (i == earthIdx) // use delay specified by user
-		{
-			delays.push_back(earthOrbitDelay);
-		}
-		else // use delay relative to earth delay
-		{
-			delays.push_back(m.getRelativeValue(
-				bodyConstants[renderedBodies[i].bodyConstantIdx].orbitalPeriod,
-				bodyConstants[renderedBodies[earthIdx].bodyConstantIdx].orbitalPeriod, earthOrbitDelay));
-		}
-	}
-
-	for (int i = 0; i < renderedBodies.size(); i++)
-	{
-		if (renderedBodies[i].animatorIdx == -1) continue; // not animated
-		int animatorIndex = renderedBodies[i].animatorIdx;
-		animators[animatorIndex].setOrbitalDelay(delays[animatorIndex]);
+		orbitSystem.setOrbitalDelay(i, delays[i]);
 	}
+	spkEphemeris.setTimeScale(getEphemerisTimeScale(renderedBodies, bodyConstants, earthIdx, earthDelay));
 }
 
 void randomizeOrbitAngles()
@@ -1079,17 +1160,18 @@ void randomizeOrbitAngles()
 	{
 		if (renderedBodies[i].animatorIdx == -1) continue; // not animated
 		int animatorIndex = renderedBodies[i].animatorIdx;
+		const BodyConst& bc = bodyConstants[renderedBodies[i].bodyConstantIdx];
 		int randAngle1 = rand() % 360;
 		int randAngle2 = rand() % 360;
-		animators[animatorIndex].setOrbitAngle(randAngle1); // randomize initial orbit angle
+		float orbitAngle = isnan(bc.meanAnomaly) ? randAngle1 : bc.meanAnomaly; // mean anomaly of the constant if given
+		orbitSystem.setOrbitAngle(animatorIndex, orbitAngle); // randomize initial orbit angle
 		if (renderedBodies[i].randomSpinAngle)
 		{
-			animators[animatorIndex].setSpinAngle(randAngle2);
+			orbitSystem.setSpinAngle(animatorIndex, randAngle2);
 		}
 		else
 		{
-			animators[animatorIndex].setSpinAngle(
-				randAngle1 + bodyConstants[renderedBodies[i].bodyConstantIdx].defaultSpinAngle);
+			orbitSystem.setSpinAngle(animatorIndex, orbitAngle + bc.defaultSpinAngle);
 		}
 	}
 }
@@ -1166,47 +1248,3 @@ void glDrawVertexTriangles(unsigned int VAO, GLuint texture, int numberOfVertex)
 	glDrawArrays(GL_TRIANGLES, 0, numberOfVertex);
 }
 
-void glSetModelViewProjection(unsigned int shaderProgram, glm::mat4 model, glm::mat4 view, glm::mat4 projection)
-{
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "view"), 1, GL_FALSE, glm::value_ptr(view));
-	glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-}
-
-void glSetLightingConfig(unsigned int shaderProgram, glm::vec3 lightPos, GeneralCamera cam, int torch)
-{
-	glUniform3fv(glGetUniformLocation(shaderProgram, "light[0].position"), 1, &lightPos[0]);
-	glUniform3f(glGetUniformLocation(shaderProgram, "light[0].color"), 1.f, 1.f, 1.f);
-	glUniform3fv(glGetUniformLocation(shaderProgram, "light[0].camPos"), 1, &cam.getPosition()[0]);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].ambientStrength"), 0.15f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].specularStrength"), 0.3f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].shininess"), 16.f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].constant"), 1.0f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].linear"), 0.000000014f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[0].quadratic"), 0.00000000007f);
-
-	glUniform1i(glGetUniformLocation(shaderProgram, "torchLight"), torch);
-	glUniform3fv(glGetUniformLocation(shaderProgram, "light[1].direction"), 1, &cam.getFront()[0]);
-	glUniform3fv(glGetUniformLocation(shaderProgram, "light[1].position"), 1, &cam.getPosition()[0]);
-	glUniform3f(glGetUniformLocation(shaderProgram, "light[1].color"), 1.f, 1.f, 1.f);
-	glUniform3fv(glGetUniformLocation(shaderProgram, "light[1].camPos"), 1, &cam.getPosition()[0]);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].ambientStrength"), 0.f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].specularStrength"), 0.3f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].shininess"), 16.f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].constant"), 1.0f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].linear"), 0.0000005f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].quadratic"), 0.000000015f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].phi"), 25.f);
-	glUniform1f(glGetUniformLocation(shaderProgram, "light[1].gamma"), 35.f);
-}
-
-glm::vec3 vecToVec3(vector<float> vec)
-{
-	return glm::vec3(vec[0], vec[1], vec[2]);
-}
-
-vector<float> vec3ToVec(glm::vec3 vec3)
-{
-	return vector<float>{vec3.x, vec3.y, vec3.z};
-}
-
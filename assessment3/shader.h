@@ -1,6 +1,7 @@
 #pragma once
 #include <glad/glad.h>
 #include "util.h"
+#include "GLExtensions.h"
 
 unsigned int LoadShader(const char* vertexShaderFile, const char* fragmentShaderFile)
 {
@@ -59,5 +60,32 @@ unsigned int LoadShader(const char* vertexShaderFile, const char* fragmentShader
 	glDeleteShader(vertexShader);
 	glDeleteShader(fragmentShader);
 
+	return shaderProgram;
+}
+
+// compute shader program (requires OpenGL 4.3, see GLExtensions.h)
+unsigned int LoadComputeShader(const char* computeShaderFile)
+{
+	int success;
+	char infoLog[512];
+
+	unsigned int computeShader = glCreateShader(GL_COMPUTE_SHADER);
+	char* computeShaderSource = read_file(computeShaderFile);
+	glShaderSource(computeShader, 1, &computeShaderSource, NULL);
+	glCompileShader(computeShader);
+	glGetShaderiv(computeShader, GL_COMPILE_STATUS, &success);
+	if (!success)
+	{
+		glGetShaderInfoLog(computeShader, 512, NULL, infoLog);
+		std::cout << "ERROR::SHADER::COMPUTE::COMPILATION_FAILED\n" << infoLog << std::endl;
+	}
+
+	unsigned int shaderProgram = glCreateProgram();
+	glAttachShader(shaderProgram, computeShader);
+	glLinkProgram(shaderProgram);
+
+	free(computeShaderSource);
+	glDeleteShader(computeShader);
+
 	return shaderProgram;
 }
\ No newline at end of file
@@ -7,33 +7,42 @@ in vec3 fragPos;
 uniform sampler2D Texture1; // base texture
 uniform sampler2D Texture2; // cloud
 uniform sampler2D Texture3; // night light
-uniform bool torchLight;
+uniform float sunAmbientStrength; // overrides shared sun ambient, keeps night side dark
 
 struct Lighting {    
 
-	// light source
+	// light source (vec3 + float share one std140 slot)
 	vec3 position;
-    vec3 direction;
+	float ambientStrength;
+	vec3 direction;
+	float specularStrength;
 	vec3 color;
-  
-	// camera
-	vec3 camPos;
-
-	// phong
-    float ambientStrength;
-    float specularStrength;
 	float shininess;
 
 	// attenuation
 	float constant;
-    float linear;
-    float quadratic;
+	float linear;
+	float quadratic;
 
 	// spot light
 	float phi;		// inner cone
 	float gamma;	// outer cone
 };
-uniform Lighting light[2];
+
+// per frame data shared by all programs (binding point 0)
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 camPos;
+};
+
+// per frame data shared by all lit programs (binding point 1)
+layout(std140) uniform Lights
+{
+	Lighting light[2];
+	bool torchLight;
+};
 
 out vec4 fragCol;
 
@@ -53,15 +62,18 @@ void main()
 	
 	//float phong = directionalIllumination(lighting, nor, fragPos);
 	//float phong = spotIllumination(lighting, nor, fragPos);
-	float phong = positionalIllumination(light[0], nor, fragPos);
-	float darkness = positionalDarkness(light[0], nor, fragPos);
+	Lighting sun = light[0];
+	sun.ambientStrength = sunAmbientStrength;
+
+	float phong = positionalIllumination(sun, nor, fragPos);
+	float darkness = positionalDarkness(sun, nor, fragPos);
 	if (torchLight) 
 	{
 		phong += spotIllumination(light[1], nor, fragPos);
 		darkness *= spotDarkness(light[1], nor, fragPos);
 	}
 
-	vec4 baseColor = phong * (baseTexCol + secondaryTexCol) * vec4(light[0].color, 1.f);
+	vec4 baseColor = phong * (baseTexCol + secondaryTexCol) * vec4(sun.color, 1.f);
 	vec4 darkColor = darkness * darkTexCol;
 
 	fragCol = baseColor + darkColor;
@@ -77,7 +89,7 @@ float directionalIllumination(Lighting l, vec3 normals, vec3 fragPosition)
 	float diffuse = max( dot(norm, toLightDir), 0.0);
 
 	// calcualte specular
-	vec3 toCamDir = normalize(l.camPos - fragPosition);
+	vec3 toCamDir = normalize(camPos.xyz - fragPosition);
 	vec3 refDir = reflect(-toLightDir, norm);
 	float specular = pow(max(dot(toCamDir, refDir), 0.0), l.shininess) * l.specularStrength;
 
@@ -94,7 +106,7 @@ float positionalIllumination(Lighting l, vec3 normals, vec3 fragPosition)
 	float diffuse = max( dot(norm, toLightDir), 0.0);
 
 	// calcualte specular
-	vec3 toCamDir = normalize(l.camPos - fragPosition);
+	vec3 toCamDir = normalize(camPos.xyz - fragPosition);
 	vec3 refDir = reflect(-toLightDir, norm);
 	float specular = pow(max(dot(toCamDir, refDir), 0.0), l.shininess) * l.specularStrength;
 
@@ -4,9 +4,16 @@ layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aTex;
 layout(location = 2) in vec3 aNor;
 
+// per frame data shared by all programs (binding point 0)
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 camPos;
+};
+
+// per object data
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 
 out vec2 tex;
 out vec3 nor;
@@ -0,0 +1,42 @@
+#version 430 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aTex;
+layout(location = 2) in vec3 aNor;
+
+// per instance, index of the object written by the cull pass
+layout(location = 3) in uint aObjectIdx;
+
+struct Object
+{
+	vec4 bounds;
+	ivec4 info;		// x: draw command index, y: texture layer, z: flags, w: texture array index
+};
+
+layout(std430, binding = 0) readonly buffer Transforms { mat4 models[]; };
+layout(std430, binding = 1) readonly buffer Objects { Object objects[]; };
+
+// per frame data shared by all programs (binding point 0)
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 camPos;
+};
+
+out vec2 tex;
+out vec3 nor;
+out vec3 fragPos;
+flat out int layer;
+flat out int flags;
+
+void main()
+{
+	mat4 model = models[aObjectIdx];
+	gl_Position = projection * view * model * vec4(aPos, 1.f);
+	tex = aTex.xy;
+	fragPos = vec3(model * vec4(aPos, 1.f)); // world space position
+	nor = mat3(transpose(inverse(model))) * aNor; // to fix non uniform scaling
+	layer = objects[aObjectIdx].info.y;
+	flags = objects[aObjectIdx].info.z;
+}
@@ -3,35 +3,48 @@
 in vec2 tex;
 in vec3 nor;
 in vec3 fragPos;
+flat in int layer;
+flat in int flags;
 
-uniform sampler2D Texture;
-uniform bool torchLight;
+uniform sampler2DArray Textures; // one layer per instance
+
+// instance flags
+const int FLAG_UNLIT = 1; // emissive, no lighting (e.g. sun)
 
 struct Lighting {    
 
-	// light source
+	// light source (vec3 + float share one std140 slot)
 	vec3 position;
-    vec3 direction;
+	float ambientStrength;
+	vec3 direction;
+	float specularStrength;
 	vec3 color;
-  
-	// camera
-	vec3 camPos;
-
-	// phong
-    float ambientStrength;
-    float specularStrength;
 	float shininess;
 
 	// attenuation
 	float constant;
-    float linear;
-    float quadratic;
+	float linear;
+	float quadratic;
 
 	// spot light
 	float phi;		// inner cone
 	float gamma;	// outer cone
 };
-uniform Lighting light[2];
+
+// per frame data shared by all programs (binding point 0)
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 camPos;
+};
+
+// per frame data shared by all lit programs (binding point 1)
+layout(std140) uniform Lights
+{
+	Lighting light[2];
+	bool torchLight;
+};
 
 out vec4 fragCol;
 
@@ -43,21 +56,22 @@ float calculateAttenuation(Lighting l, vec3 fragPosition);
 
 void main()
 {
-	vec4 texCol = texture(Texture,tex);
-	
-	// create alpha segmentation
-//	if (texCol.a < 0.3)
-//		discard;
-
-	//float phong = directionalIllumination(lighting, nor, fragPos);
-	//float phong = spotIllumination(lighting, nor, fragPos);
+	vec4 texCol = texture(Textures, vec3(tex, layer));
+
+	if ((flags & FLAG_UNLIT) != 0)
+	{
+		fragCol = texCol;
+		return;
+	}
+
 	float phong = positionalIllumination(light[0], nor, fragPos);
 	if (torchLight) 
 	{
 		phong += spotIllumination(light[1], nor, fragPos);
 	}
 
-	fragCol = phong * texCol * vec4(light[0].color, 1.f);
+	// keep texture alpha so blended bodies (rings) are not faded by lighting
+	fragCol = vec4(phong * texCol.rgb * light[0].color, texCol.a);
 }
 
 float directionalIllumination(Lighting l, vec3 normals, vec3 fragPosition)
@@ -70,7 +84,7 @@ float directionalIllumination(Lighting l, vec3 normals, vec3 fragPosition)
 	float diffuse = max( dot(norm, toLightDir), 0.0);
 
 	// calcualte specular
-	vec3 toCamDir = normalize(l.camPos - fragPosition);
+	vec3 toCamDir = normalize(camPos.xyz - fragPosition);
 	vec3 refDir = reflect(-toLightDir, norm);
 	float specular = pow(max(dot(toCamDir, refDir), 0.0), l.shininess) * l.specularStrength;
 
@@ -87,7 +101,7 @@ float positionalIllumination(Lighting l, vec3 normals, vec3 fragPosition)
 	float diffuse = max( dot(norm, toLightDir), 0.0);
 
 	// calcualte specular
-	vec3 toCamDir = normalize(l.camPos - fragPosition);
+	vec3 toCamDir = normalize(camPos.xyz - fragPosition);
 	vec3 refDir = reflect(-toLightDir, norm);
 	float specular = pow(max(dot(toCamDir, refDir), 0.0), l.shininess) * l.specularStrength;
 
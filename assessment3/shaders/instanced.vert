@@ -0,0 +1,33 @@
+#version 330 core
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aTex;
+layout(location = 2) in vec3 aNor;
+
+// per instance data
+layout(location = 3) in mat4 aModel;		// occupies locations 3 to 6
+layout(location = 7) in ivec2 aInstance;	// x: texture layer, y: flags
+
+// per frame data shared by all programs (binding point 0)
+layout(std140) uniform Camera
+{
+	mat4 view;
+	mat4 projection;
+	vec4 camPos;
+};
+
+out vec2 tex;
+out vec3 nor;
+out vec3 fragPos;
+flat out int layer;
+flat out int flags;
+
+void main()
+{
+	gl_Position = projection * view * aModel * vec4(aPos, 1.f);
+	tex = aTex.xy;
+	fragPos = vec3(aModel * vec4(aPos, 1.f)); // world space position
+	nor = mat3(transpose(inverse(aModel))) * aNor; // to fix non uniform scaling
+	layer = aInstance.x;
+	flags = aInstance.y;
+}
@@ -6,14 +6,15 @@ void framebuffer_size_callback(GLFWwindow* window, int w, int h)
 	glViewport(0, 0, w, h);
 }
 
-GLFWwindow* myCreateWindow(int w, int h, const char* title)
+// returns NULL if a context of the requested version can not be created
+GLFWwindow* myCreateWindow(int w, int h, const char* title, int major = 3, int minor = 3)
 {
 	// init glfw to initialize a window
 	glfwInit();
 
 	// specify OpenGL version
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, major);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, minor);
 
 	// we don't need deprecated functions, so instead of 
 	// compatibility profile, we use core profile
@@ -27,6 +28,7 @@ GLFWwindow* myCreateWindow(int w, int h, const char* title)
 
 	// create window
 	GLFWwindow* window = glfwCreateWindow(w, h, title, NULL, NULL);
+	if (window == NULL) return NULL;
 	
 	// specify this in order to draw things
 	glfwMakeContextCurrent(window);